@@ -11,9 +11,16 @@
 #include <Lights/AmbientLight.h>
 
 #include <PoseStreamer.h>
+#include <PosePredictor.h>
 #include <VideoTexture.h>
+#include <StreamRecorder.h>
+#include <StreamReplayer.h>
+#include <StreamTap.h>
 
-#include <shaders_common.h>
+#include <UniformBuffer.h>
+#include <ClientShaders.h>
+
+#define ATW_VIEWS_BINDING_POINT 4
 
 using namespace quasar;
 
@@ -26,20 +33,53 @@ private:
     std::string videoFormat = "mpegts";
     glm::uvec2 videoSize = glm::uvec2(2048, 1024);
 
+    // Hand the video to the runtime as its own projection layer (posed with the server's stereo poses)
+    // instead of warping it here. The runtime's timewarp then reprojects it in one step.
+    bool runtimeLayerMode = false;
+
+    // Send the head pose extrapolated to when the streamed frame will be displayed, rather than the current one
+    bool predictPoses = true;
+
 public:
-    ATWClient(GraphicsAPI_Type apiType) : OpenXRApp(apiType) {}
+    ATWClient(GraphicsAPI_Type apiType) : OpenXRApp(apiType) {
+        // The ATW pass is a full screen pass and leaves the depth buffer unwritten
+        submitDepthLayer = false;
+    }
     ~ATWClient() = default;
 
 private:
     void CreateResources() override {
         scene->backgroundColor = glm::vec4(0.17f, 0.17f, 0.17f, 1.0f);
 
+        // VideoTexture opens its own socket, so recordings are taken and replayed through a loopback tap
+        std::string receiverVideoURL = videoURL;
+        std::string senderPoseURL = poseURL;
+        std::string capturePath = streamCapture.getPath("ATWClient");
+        if (streamCapture.mode == StreamCapture::Mode::RECORD) {
+            streamRecorder = std::make_unique<StreamRecorder>(capturePath);
+            videoTap = std::make_unique<StreamTap>(StreamTap::Protocol::UDP, videoURL, *streamRecorder, StreamChannel::VIDEO);
+            receiverVideoURL = videoTap->getLocalURL();
+        }
+        else if (streamCapture.mode == StreamCapture::Mode::REPLAY) {
+            streamReplayer = std::make_unique<StreamReplayer>(capturePath, streamCapture.replay);
+            videoTap = std::make_unique<StreamTap>(StreamTap::Protocol::UDP);
+            streamReplayer->setSink(StreamChannel::VIDEO, [this](const std::vector<char> &data) { videoTap->deliver(data); });
+            receiverVideoURL = videoTap->getLocalURL();
+            // There is no server to send poses to
+            senderPoseURL = "127.0.0.1" + poseURL.substr(poseURL.rfind(':'));
+        }
+
         atwShader = new Shader({
-            .vertexCodeData = SHADER_BUILTIN_POSTPROCESS_VERT,
-            .vertexCodeSize = SHADER_BUILTIN_POSTPROCESS_VERT_len,
-            .fragmentCodeData = SHADER_COMMON_ATW_FRAG,
-            .fragmentCodeSize = SHADER_COMMON_ATW_FRAG_len
+            .vertexCodeData = SHADER_CLIENT_ATW_MULTIVIEW_VERT,
+            .vertexCodeSize = SHADER_CLIENT_ATW_MULTIVIEW_VERT_len,
+            .fragmentCodeData = SHADER_CLIENT_ATW_MULTIVIEW_FRAG,
+            .fragmentCodeSize = SHADER_CLIENT_ATW_MULTIVIEW_FRAG_len,
+            .extensions = {
+                "#extension GL_OVR_multiview2 : require"
+            }
         });
+        atwViewsBuffer = std::make_unique<UniformBuffer<ATWViewsBlock>>(ATW_VIEWS_BINDING_POINT);
+        atwViewsBuffer->attach(*atwShader, "ATWViews");
 
         videoTexture = new VideoTexture({
             .width = videoSize.x,
@@ -51,9 +91,10 @@ private:
             .wrapT = GL_CLAMP_TO_EDGE,
             .minFilter = GL_LINEAR,
             .magFilter = GL_LINEAR
-        }, videoURL, videoFormat);
+        }, receiverVideoURL, videoFormat);
 
-        poseStreamer = std::make_unique<PoseStreamer>(cameras.get(), poseURL);
+        predictedCameras = std::make_unique<VRCamera>();
+        poseStreamer = std::make_unique<PoseStreamer>(predictPoses ? predictedCameras.get() : cameras.get(), senderPoseURL);
 
         // Add the hand nodes.
         Model* leftControllerMesh = new Model({
@@ -83,7 +124,95 @@ private:
         screen->setPosition(glm::vec3(0.0f, 0.0f, -2.0f));
         screen->setScale(glm::vec3(1.0f, 0.5f, 0.05f));
         screen->frustumCulled = false;
+        screen->visible = !runtimeLayerMode;
         scene->addChildNode(screen);
+
+        if (runtimeLayerMode) {
+            // The app only draws the controllers on top of the video layer, everything else stays transparent
+            scene->backgroundColor = glm::vec4(0.0f, 0.0f, 0.0f, 0.0f);
+            CreateVideoLayer();
+        }
+    }
+
+    void CreateVideoLayer() {
+        // One array layer per eye, each half of the side by side video
+        XrSwapchainCreateInfo swapchainCI{XR_TYPE_SWAPCHAIN_CREATE_INFO};
+        swapchainCI.createFlags = 0;
+        swapchainCI.usageFlags = XR_SWAPCHAIN_USAGE_SAMPLED_BIT | XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT;
+        swapchainCI.format = m_colorSwapchainInfo.swapchainFormat;
+        swapchainCI.sampleCount = 1;
+        swapchainCI.width = videoSize.x / 2;
+        swapchainCI.height = videoSize.y;
+        swapchainCI.faceCount = 1;
+        swapchainCI.arraySize = 2;
+        swapchainCI.mipCount = 1;
+        OPENXR_CHECK(xrCreateSwapchain(m_session, &swapchainCI, &videoSwapchain), "Failed to create Video Swapchain");
+
+        uint32_t imageCount = 0;
+        OPENXR_CHECK(xrEnumerateSwapchainImages(videoSwapchain, 0, &imageCount, nullptr), "Failed to enumerate Video Swapchain Images.");
+        XrSwapchainImageBaseHeader* images = m_graphicsAPI->AllocateSwapchainImageData(videoSwapchain, GraphicsAPI::SwapchainType::COLOR, imageCount);
+        OPENXR_CHECK(xrEnumerateSwapchainImages(videoSwapchain, imageCount, &imageCount, images), "Failed to enumerate Video Swapchain Images.");
+
+        glGenFramebuffers(1, &videoReadFramebuffer);
+        glGenFramebuffers(1, &videoDrawFramebuffer);
+
+        for (int i = 0; i < 2; i++) {
+            videoLayerViews[i] = { XR_TYPE_COMPOSITION_LAYER_PROJECTION_VIEW };
+            videoLayerViews[i].subImage.swapchain = videoSwapchain;
+            videoLayerViews[i].subImage.imageRect.offset = { 0, 0 };
+            videoLayerViews[i].subImage.imageRect.extent = { static_cast<int32_t>(swapchainCI.width), static_cast<int32_t>(swapchainCI.height) };
+            videoLayerViews[i].subImage.imageArrayIndex = i;
+        }
+        videoLayer.layerFlags = 0;
+        videoLayer.space = m_localSpace;
+        videoLayer.viewCount = 2;
+        videoLayer.views = videoLayerViews;
+    }
+
+    // Copies the latest decoded frame into the video layer swapchain and poses the layer where the server rendered it.
+    void UpdateVideoLayer(const Pose &framePose) {
+        uint32_t imageIndex = 0;
+        XrSwapchainImageAcquireInfo acquireInfo{XR_TYPE_SWAPCHAIN_IMAGE_ACQUIRE_INFO};
+        OPENXR_CHECK(xrAcquireSwapchainImage(videoSwapchain, &acquireInfo, &imageIndex), "Failed to acquire Image from the Video Swapchain");
+        XrSwapchainImageWaitInfo waitInfo{XR_TYPE_SWAPCHAIN_IMAGE_WAIT_INFO};
+        waitInfo.timeout = XR_INFINITE_DURATION;
+        OPENXR_CHECK(xrWaitSwapchainImage(videoSwapchain, &waitInfo), "Failed to wait for Image from the Video Swapchain");
+
+        GLuint image = (GLuint)(uint64_t)m_graphicsAPI->GetSwapchainImage(videoSwapchain, imageIndex);
+        GLint eyeWidth = videoSize.x / 2;
+        GLint eyeHeight = videoSize.y;
+
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, videoReadFramebuffer);
+        glFramebufferTexture2D(GL_READ_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, videoTexture->ID, 0);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, videoDrawFramebuffer);
+        for (int i = 0; i < 2; i++) {
+            glFramebufferTextureLayer(GL_DRAW_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, image, 0, i);
+            glBlitFramebuffer(i * eyeWidth, 0, (i + 1) * eyeWidth, eyeHeight,
+                              0, 0, eyeWidth, eyeHeight,
+                              GL_COLOR_BUFFER_BIT, GL_NEAREST);
+        }
+        glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+        glBindFramebuffer(GL_DRAW_FRAMEBUFFER, 0);
+
+        XrSwapchainImageReleaseInfo releaseInfo{XR_TYPE_SWAPCHAIN_IMAGE_RELEASE_INFO};
+        OPENXR_CHECK(xrReleaseSwapchainImage(videoSwapchain, &releaseInfo), "Failed to release Image back to the Video Swapchain");
+
+        // The server's views include cameraPositionOffset, the layer is posed in local space
+        const glm::mat4 remoteViews[2] = { framePose.stereo.viewL, framePose.stereo.viewR };
+        const glm::mat4 remoteProjections[2] = { framePose.stereo.projL, framePose.stereo.projR };
+        for (int i = 0; i < 2; i++) {
+            glm::mat4 eyeTransform = glm::inverse(remoteViews[i]);
+            eyeTransform[3] -= glm::vec4(cameraPositionOffset, 0.0f);
+            videoLayerViews[i].pose = gxi::toXr(eyeTransform);
+            videoLayerViews[i].fov = gxi::toXrFov(remoteProjections[i]);
+        }
+        hasVideoLayer = true;
+    }
+
+    void AddBackgroundLayers(std::vector<XrCompositionLayerBaseHeader*> &layers) override {
+        if (runtimeLayerMode && hasVideoLayer) {
+            layers.push_back(reinterpret_cast<XrCompositionLayerBaseHeader*>(&videoLayer));
+        }
     }
 
     void CreateActionSet() override {
@@ -164,68 +293,158 @@ private:
     }
 
     void OnRender(double now, double dt) override {
+        if (streamReplayer) {
+            streamReplayer->update(dt);
+        }
+
         // Send pose
+        if (predictPoses) {
+            posePredictor.update(now, *cameras);
+            posePredictor.predict(*cameras, *predictedCameras);
+        }
         poseStreamer->sendPose();
+        if (streamRecorder) {
+            streamRecorder->writeSentPose(predictPoses ? *predictedCameras : *cameras);
+        }
 
         // Render video to VideoTexture
         videoTexture->bind();
         poseID = videoTexture->draw();
 
-        // Set uniforms for both eyes
-        atwShader->bind();
+        double elapsedTime = 0.0;
+        if (poseID != prevPoseID && getFramePose(poseID, &currentFramePose, &elapsedTime)) {
+            if (runtimeLayerMode) {
+                UpdateVideoLayer(currentFramePose);
+            }
+            atwViews.remoteProjection[0] = currentFramePose.stereo.projL;
+            atwViews.remoteProjection[1] = currentFramePose.stereo.projR;
+            poseStreamer->removePosesLessThan(poseID);
+            posePredictor.addLatencySample(elapsedTime);
+        }
 
-        atwShader->setBool("atwEnabled", atwEnabled);
+        if (runtimeLayerMode) {
+            // No app-side warp: just the controllers, over a transparent background
+            m_graphicsAPI->drawObjects(*scene.get(), *cameras.get());
+        }
+        else {
+            DrawATW();
+        }
 
-        atwShader->setMat4("projectionInverseLeft", glm::inverse(cameras->left.getProjectionMatrix()));
-        atwShader->setMat4("projectionInverseRight", glm::inverse(cameras->right.getProjectionMatrix()));
+        prevPoseID = poseID;
 
-        atwShader->setMat4("viewInverseLeft", glm::inverse(cameras->left.getViewMatrix()));
-        atwShader->setMat4("viewInverseRight", glm::inverse(cameras->right.getViewMatrix()));
+        if (logStatsThisFrame && glm::abs(elapsedTime) > 1e-5f) {
+            spdlog::info("E2E Latency: {:.3f}ms", elapsedTime);
+        }
+        if (predictPoses && logStatsThisFrame) {
+            const PosePredictor::Stats &predictionStats = posePredictor.stats;
+            spdlog::info("Pose prediction ({:.1f}ms ahead): {:.1f}mm, {:.2f}deg error ({:.1f}mm, {:.2f}deg unpredicted)",
+                         predictionStats.latencyMs,
+                         predictionStats.positionErrorMm, predictionStats.rotationErrorDeg,
+                         predictionStats.unpredictedPositionErrorMm, predictionStats.unpredictedRotationErrorDeg);
+        }
+    }
 
-        double elapsedTime;
-        if (poseID != prevPoseID && poseStreamer->getPose(poseID, &currentFramePose, &elapsedTime)) {
-            atwShader->setMat4("remoteProjectionLeft", currentFramePose.stereo.projL);
-            atwShader->setMat4("remoteProjectionRight", currentFramePose.stereo.projR);
+    // The pose a streamed frame was rendered for. Replays look it up in the recording, which is where it was sent from.
+    bool getFramePose(pose_id_t id, Pose* pose, double* elapsedTimeMs) {
+        if (streamReplayer) {
+            return streamReplayer->getPose(id, pose, elapsedTimeMs);
+        }
+        if (!poseStreamer->getPose(id, pose, elapsedTimeMs)) {
+            return false;
+        }
+        if (streamRecorder) {
+            streamRecorder->writePoseAck(id, *pose, *elapsedTimeMs);
+        }
+        return true;
+    }
 
-            atwShader->setMat4("remoteViewLeft", currentFramePose.stereo.viewL);
-            atwShader->setMat4("remoteViewRight", currentFramePose.stereo.viewR);
+    void DrawATW() {
+        // Warp to the newest head pose: everything above ran after the views were first located
+        LateLatchViews();
 
-            poseStreamer->removePosesLessThan(poseID);
+        // Per-view uniforms for both eyes, uploaded as one block
+        const PerspectiveCamera* eyes[2] = { &cameras->left, &cameras->right };
+        const glm::mat4 remoteViews[2] = { currentFramePose.stereo.viewL, currentFramePose.stereo.viewR };
+        for (int i = 0; i < 2; i++) {
+            // The eye projections only change if the runtime changes the fov, so only invert them then
+            const glm::mat4 &projection = eyes[i]->getProjectionMatrix();
+            if (projection != cachedProjections[i]) {
+                cachedProjections[i] = projection;
+                atwViews.projectionInverse[i] = glm::inverse(projection);
+            }
+            // Rotation only: the inverse of the local view rotation is its transpose
+            atwViews.remoteFromLocal[i] = glm::mat4(glm::mat3(remoteViews[i]) * glm::transpose(glm::mat3(eyes[i]->getViewMatrix())));
         }
+        atwViews.flags.x = atwEnabled ? 1 : 0;
+        atwViewsBuffer->update(atwViews);
+
+        atwShader->bind();
         atwShader->setTexture("videoTexture", *videoTexture, 0);
+        atwViewsBuffer->bind();
 
         // Draw both eyes in a single pass
+        GPUProfiler::Scope atwScope(*m_graphicsAPI->gpuProfiler, "ATW");
         m_graphicsAPI->drawToScreen(*atwShader);
 
-        prevPoseID = poseID;
-
         // Draw objects (uncomment to debug)
         // M_graphicsAPI->drawObjects(*scene.get(), *cameras.get(), GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
-
-        if (glm::abs(elapsedTime) > 1e-5f) {
-            XR_LOG("E2E Latency: " << elapsedTime << "ms");
-        }
-
-        spdlog::info("Rendering time: {:.3f}ms", timeutils::secondsToMillis(dt));
     }
 
     void DestroyResources() override {
         delete videoTexture;
         delete atwShader;
+        atwViewsBuffer.reset();
+
+        // The tap writes into the recorder
+        videoTap.reset();
+        streamRecorder.reset();
+        streamReplayer.reset();
+
+        if (videoSwapchain != XR_NULL_HANDLE) {
+            glDeleteFramebuffers(1, &videoReadFramebuffer);
+            glDeleteFramebuffers(1, &videoDrawFramebuffer);
+            m_graphicsAPI->FreeSwapchainImageData(videoSwapchain);
+            OPENXR_CHECK(xrDestroySwapchain(videoSwapchain), "Failed to destroy Video Swapchain");
+        }
     }
 
     // Shader for the ATW effect.
     Shader* atwShader;
     bool atwEnabled = true;
 
+    // Matches the ATWViews block in SHADER_CLIENT_ATW_MULTIVIEW_FRAG (std140)
+    struct ATWViewsBlock {
+        glm::mat4 projectionInverse[2];
+        glm::mat4 remoteFromLocal[2];
+        glm::mat4 remoteProjection[2];
+        glm::ivec4 flags;
+    } atwViews{};
+    std::unique_ptr<UniformBuffer<ATWViewsBlock>> atwViewsBuffer;
+    glm::mat4 cachedProjections[2] = { glm::mat4(0.0f), glm::mat4(0.0f) };
+
     VideoTexture* videoTexture;
 
+    // Runtime layer mode
+    XrSwapchain videoSwapchain = XR_NULL_HANDLE;
+    GLuint videoReadFramebuffer = 0;
+    GLuint videoDrawFramebuffer = 0;
+    XrCompositionLayerProjection videoLayer{XR_TYPE_COMPOSITION_LAYER_PROJECTION};
+    XrCompositionLayerProjectionView videoLayerViews[2];
+    bool hasVideoLayer = false;
+
     // Pose streaming.
     pose_id_t poseID = -1;
     pose_id_t prevPoseID = -1;
     std::unique_ptr<PoseStreamer> poseStreamer;
+    PosePredictor posePredictor;
+    std::unique_ptr<VRCamera> predictedCameras;
     Pose currentFramePose;
 
+    // Stream recording and replay (OpenXRApp::streamCapture)
+    std::unique_ptr<StreamRecorder> streamRecorder;
+    std::unique_ptr<StreamReplayer> streamReplayer;
+    std::unique_ptr<StreamTap> videoTap;
+
     // Actions.
     XrAction m_clickAction;
     // The realtime states of these actions.
@@ -2,6 +2,11 @@
 #define MESHWARP_CLIENT_H
 
 #include <OpenXRApp.h>
+#include <FencedRing.h>
+#include <TileCuller.h>
+#include <VertexPacker.h>
+#include <UniformLocation.h>
+#include <StereoCameraBuffer.h>
 
 #include <Primitives/Mesh.h>
 #include <Primitives/Cube.h>
@@ -13,11 +18,19 @@
 
 #include <VideoTexture.h>
 #include <BC4DepthVideoTexture.h>
+#include <BC4DeltaDepthReceiver.h>
 #include <PoseStreamer.h>
+#include <PosePredictor.h>
+#include <QualityGovernor.h>
+#include <QualityRequestStreamer.h>
+#include <StreamRecorder.h>
+#include <StreamReplayer.h>
+#include <StreamTap.h>
 
 #include <shaders_common.h>
 
 #define THREADS_PER_LOCALGROUP 16
+#define NUM_MESH_BUFFERS 3
 
 using namespace quasar;
 
@@ -27,6 +40,7 @@ private:
     std::string poseURL = serverIP + ":54321";
     std::string videoURL = "0.0.0.0:12345";
     std::string depthURL = serverIP + ":65432";
+    std::string qualityURL = serverIP + ":54322";
 
     unsigned int surfelSize = 1;
     unsigned int depthFactor = 4;
@@ -35,10 +49,48 @@ private:
 
     bool meshWarpEnabled = true;
 
+    // Server streams depth with the lossless temporal BC4 codec (BC4DeltaEncoder) instead of raw BC4 frames
+    bool depthDeltaCodec = false;
+
+    // Draw the mesh from packed vertices (half float positions around the remote camera, unorm16 texture coordinates)
+    // to cut vertex fetch bandwidth. The mesh is generated into a float scratch mesh and packed after.
+    bool packVertices = false;
+
+    // Send the head pose extrapolated to when the streamed frame will be displayed, rather than the current one
+    bool predictPoses = true;
+
+    // Lower the streaming quality when frames run over budget and raise it back when there is headroom (QualityGovernor).
+    // The surfel size is applied here; the frame rate is requested from the server, which has to listen on qualityURL.
+    bool qualityGovernorEnabled = false;
+    struct QualityLevel {
+        // Multiplies surfelSize, which the mesh buffers are sized for
+        unsigned int surfelScale;
+        // Of the display refresh rate
+        float frameRateScale;
+    };
+    const std::vector<QualityLevel> qualityLevels = {
+        { 1, 1.0f },
+        { 2, 1.0f },
+        { 2, 0.5f },
+        { 4, 0.5f }
+    };
+
 public:
-    MeshWarpClient(GraphicsAPI_Type apiType) : OpenXRApp(apiType), remoteCamera(videoSize.x, videoSize.y) {}
+    MeshWarpClient(GraphicsAPI_Type apiType) : OpenXRApp(apiType), remoteCamera(videoSize.x, videoSize.y) {
+        // Replay delivery and quality updates run in OnPrepareFrame, while the next frame is waited for
+        pipelinedFrameLoop = true;
+    }
     ~MeshWarpClient() = default;
 
+    // Frame-drop concealment. Can be changed before Run().
+    struct ConcealmentParams {
+        // A frame is treated as late and concealed when its pose is this much older than the recent frames'
+        // (the smoothed latency), so a connection with steady high latency still updates the mesh
+        double maxFrameLatenessMs = 150.0;
+        // Weight of each new frame's latency in the smoothed latency
+        double latencySmoothing = 0.1;
+    } concealmentParams;
+
 private:
     void CreateResources() override {
         scene->backgroundColor = glm::vec4(0.17f, 0.17f, 0.17f, 1.0f);
@@ -48,6 +100,39 @@ private:
         });
         scene->setAmbientLight(ambientLight);
 
+        // VideoTexture and BC4DepthVideoTexture open their own sockets, so their streams are recorded and replayed
+        // through loopback taps. BC4DeltaDepthReceiver is handed its packets directly.
+        std::string receiverVideoURL = videoURL;
+        std::string receiverDepthURL = depthURL;
+        std::string senderPoseURL = poseURL;
+        std::string capturePath = streamCapture.getPath("MeshWarpClient");
+        if (streamCapture.mode == StreamCapture::Mode::RECORD) {
+            streamRecorder = std::make_unique<StreamRecorder>(capturePath);
+            videoTap = std::make_unique<StreamTap>(StreamTap::Protocol::UDP, videoURL, *streamRecorder, StreamChannel::VIDEO);
+            receiverVideoURL = videoTap->getLocalURL();
+            if (!depthDeltaCodec) {
+                depthTap = std::make_unique<StreamTap>(StreamTap::Protocol::TCP, depthURL, *streamRecorder, StreamChannel::DEPTH_STREAM);
+                receiverDepthURL = depthTap->getLocalURL();
+            }
+        }
+        else if (streamCapture.mode == StreamCapture::Mode::REPLAY) {
+            streamReplayer = std::make_unique<StreamReplayer>(capturePath, streamCapture.replay);
+            videoTap = std::make_unique<StreamTap>(StreamTap::Protocol::UDP);
+            streamReplayer->setSink(StreamChannel::VIDEO, [this](const std::vector<char> &data) { videoTap->deliver(data); });
+            receiverVideoURL = videoTap->getLocalURL();
+            if (depthDeltaCodec) {
+                receiverDepthURL = "";
+                streamReplayer->setSink(StreamChannel::DEPTH_PACKETS, [this](const std::vector<char> &data) { depthReceiver->receive(data); });
+            }
+            else {
+                depthTap = std::make_unique<StreamTap>(StreamTap::Protocol::TCP);
+                streamReplayer->setSink(StreamChannel::DEPTH_STREAM, [this](const std::vector<char> &data) { depthTap->deliver(data); });
+                receiverDepthURL = depthTap->getLocalURL();
+            }
+            // There is no server to send poses to
+            senderPoseURL = "127.0.0.1" + poseURL.substr(poseURL.rfind(':'));
+        }
+
         // Initialize video texture for color stream
         videoTextureColor = new VideoTexture({
             .width = videoSize.x,
@@ -59,20 +144,28 @@ private:
             .wrapT = GL_CLAMP_TO_EDGE,
             .minFilter = GL_LINEAR,
             .magFilter = GL_LINEAR
-        }, videoURL);
-
-        // Initialize BC4 depth texture
-        videoTextureDepth = new BC4DepthVideoTexture({
-            .width = videoSize.x / depthFactor,
-            .height = videoSize.y / depthFactor,
-            .internalFormat = GL_R32F,
-            .format = GL_RED,
-            .type = GL_FLOAT,
-            .wrapS = GL_CLAMP_TO_EDGE,
-            .wrapT = GL_CLAMP_TO_EDGE,
-            .minFilter = GL_NEAREST,
-            .magFilter = GL_NEAREST
-        }, depthURL);
+        }, receiverVideoURL);
+
+        // Initialize BC4 depth stream
+        depthSize = videoSize / depthFactor;
+        if (depthDeltaCodec) {
+            depthReceiver = new BC4DeltaDepthReceiver(depthSize, receiverDepthURL, *jobSystem, streamRecorder.get());
+            depthBlocksBuffer = &depthReceiver->bc4CompressedBuffer;
+        }
+        else {
+            videoTextureDepth = new BC4DepthVideoTexture({
+                .width = depthSize.x,
+                .height = depthSize.y,
+                .internalFormat = GL_R32F,
+                .format = GL_RED,
+                .type = GL_FLOAT,
+                .wrapS = GL_CLAMP_TO_EDGE,
+                .wrapT = GL_CLAMP_TO_EDGE,
+                .minFilter = GL_NEAREST,
+                .magFilter = GL_NEAREST
+            }, receiverDepthURL);
+            depthBlocksBuffer = &videoTextureDepth->bc4CompressedBuffer;
+        }
 
         // Remote camera
         remoteCamera.setFovyDegrees(fov);
@@ -94,30 +187,69 @@ private:
         m_handNodes[1].setEntity(rightControllerMesh);
 
         // Initialize pose streamer
-        poseStreamer = new PoseStreamer(cameras.get(), poseURL);
+        predictedCameras = std::make_unique<VRCamera>();
+        poseStreamer = new PoseStreamer(predictPoses ? predictedCameras.get() : cameras.get(), senderPoseURL);
+
+        if (qualityGovernorEnabled) {
+            qualityGovernor = std::make_unique<QualityGovernor>(QualityGovernor::Params{
+                .numLevels = static_cast<uint32_t>(qualityLevels.size())
+            });
+            // Replays can't change what was recorded, so only the surfel size follows the governor
+            if (streamCapture.mode != StreamCapture::Mode::REPLAY) {
+                qualityRequestStreamer = std::make_unique<QualityRequestStreamer>(qualityURL);
+            }
+        }
 
         // Setup scene and mesh
-        glm::uvec2 adjustedvideoSize = videoSize / surfelSize;
-        unsigned int maxVertices = adjustedvideoSize.x * adjustedvideoSize.y;
-        unsigned int numTriangles = (adjustedvideoSize.x-1) * (adjustedvideoSize.y-1) * 2;
-        unsigned int maxIndices = numTriangles * 3;
-
-        mesh = new Mesh({
-            .maxVertices = maxVertices,
-            .maxIndices = maxIndices,
-            .material = new UnlitMaterial({ .baseColorTexture = videoTextureColor }),
-            .usage = GL_DYNAMIC_DRAW
-        });
-        node = new Node(mesh);
-        node->frustumCulled = false;
-        scene->addChildNode(node);
-
-        nodeWireframe = new Node(mesh);
-        nodeWireframe->frustumCulled = false;
-        nodeWireframe->wireframe = true;
-        nodeWireframe->visible = false;
-        nodeWireframe->overrideMaterial = new UnlitMaterial({ .baseColor = glm::vec4(1.0f, 1.0f, 0.0f, 1.0f) });
-        scene->addChildNode(nodeWireframe);
+        unsigned int maxVertices, maxIndices;
+        getMeshSize(surfelSize, maxVertices, maxIndices);
+        currentSurfelSize = surfelSize;
+        maxMeshVertices = maxVertices;
+        maxMeshIndices = maxIndices;
+
+        // Ring of mesh buffer sets, so the compute pass for the next frame never writes into buffers
+        // that the previous frame's draw is still reading from
+        // The meshes and wireframe nodes of every set share these, which are owned (and deleted) here
+        meshMaterial = new UnlitMaterial({ .baseColorTexture = videoTextureColor });
+        wireframeMaterial = new UnlitMaterial({ .baseColor = glm::vec4(1.0f, 1.0f, 0.0f, 1.0f) });
+        if (packVertices) {
+            // Only read within the frame it is generated in, so one is enough for the whole ring
+            unpackedMesh = new Mesh({
+                .maxVertices = maxVertices,
+                .maxIndices = maxIndices,
+                .material = meshMaterial,
+                .usage = GL_DYNAMIC_DRAW,
+                .indirectDraw = true
+            });
+            vertexPacker = new VertexPacker(sizeof(Vertex), Vertex::getVertexInputAttributes(), VertexSemantics::forVertex());
+        }
+        numMeshVertices = maxVertices;
+        for (size_t i = 0; i < meshBuffers.size(); i++) {
+            MeshBufferSet &meshSet = meshBuffers[i];
+
+            meshSet.mesh = new Mesh({
+                .maxVertices = maxVertices,
+                .maxIndices = maxIndices,
+                .vertexSize = packVertices ? vertexPacker->getVertexSize() : (uint)sizeof(Vertex),
+                .attributes = packVertices ? vertexPacker->getAttributes() : Vertex::getVertexInputAttributes(),
+                .material = meshMaterial,
+                .usage = GL_DYNAMIC_DRAW,
+                .indirectDraw = true
+            });
+            meshSet.tileCuller = new TileCuller(maxIndices, sizeof(Vertex));
+            meshSet.numIndices = maxIndices;
+            meshSet.node = new Node(meshSet.mesh);
+            meshSet.node->frustumCulled = false;
+            meshSet.node->visible = false;
+            scene->addChildNode(meshSet.node);
+
+            meshSet.nodeWireframe = new Node(meshSet.mesh);
+            meshSet.nodeWireframe->frustumCulled = false;
+            meshSet.nodeWireframe->wireframe = true;
+            meshSet.nodeWireframe->visible = false;
+            meshSet.nodeWireframe->overrideMaterial = wireframeMaterial;
+            scene->addChildNode(meshSet.nodeWireframe);
+        }
 
         // // add a screen for the video.
         // Cube* videoScreen = new Cube({
@@ -136,6 +268,20 @@ private:
                 "#define THREADS_PER_LOCALGROUP " + std::to_string(THREADS_PER_LOCALGROUP)
             }
         });
+        genMeshUniforms.surfelSize = UniformLocation(*genMeshFromBC4Shader, "surfelSize");
+        genMeshUniforms.viewColor = UniformLocation(*genMeshFromBC4Shader, "viewColor");
+        genMeshUniforms.viewInverseDepth = UniformLocation(*genMeshFromBC4Shader, "viewInverseDepth");
+
+        // The remote camera and depth size are fixed for the session
+        genMeshFromBC4Shader->bind();
+        genMeshFromBC4Shader->setBool("unlinearizeDepth", true);
+        genMeshFromBC4Shader->setVec2("depthMapSize", glm::vec2(depthSize));
+        genMeshFromBC4Shader->setMat4("projection", remoteCamera.getProjectionMatrix());
+        genMeshFromBC4Shader->setMat4("projectionInverse", glm::inverse(remoteCamera.getProjectionMatrix()));
+        genMeshFromBC4Shader->setFloat("near", remoteCamera.getNear());
+        genMeshFromBC4Shader->setFloat("far", remoteCamera.getFar());
+
+        cameraBuffer = std::make_unique<StereoCameraBuffer>();
     }
 
     void CreateActionSet() override {
@@ -202,7 +348,7 @@ private:
                 // XR_LOG("Click action triggered for hand: " << i);
                 m_buzz[i] = 0.5f;
 
-                nodeWireframe->visible = !nodeWireframe->visible;
+                wireframeVisible = !wireframeVisible;
             }
 
             if (m_thumbstickState[i].isActive == XR_TRUE && m_thumbstickState[i].changedSinceLastSync == XR_TRUE) {
@@ -217,9 +363,28 @@ private:
         }
     }
 
+    void OnPrepareFrame() override {
+        // Hand recorded packets to the receivers early, so they are decoded on their threads during the wait
+        if (streamReplayer) {
+            streamReplayer->update(frameTiming.getDeltaTime());
+        }
+
+        // Only needs the last frame's timings, and requests the new quality from the server before this frame
+        if (qualityGovernor) {
+            updateQuality();
+        }
+    }
+
     void OnRender(double now, double dt) override {
         // Update pose and stream it
+        if (predictPoses) {
+            posePredictor.update(now, *cameras);
+            posePredictor.predict(*cameras, *predictedCameras);
+        }
         poseStreamer->sendPose();
+        if (streamRecorder) {
+            streamRecorder->writeSentPose(predictPoses ? *predictedCameras : *cameras);
+        }
 
         // Get latest video frames
         videoTextureColor->bind();
@@ -227,83 +392,326 @@ private:
         videoTextureColor->unbind();
 
         // Get latest depth frames
-        videoTextureDepth->bind();
-        poseIdDepth = videoTextureDepth->draw(poseIdColor);
-        spdlog::info("poseIdColor: {}, poseIdDepth: {}", poseIdColor, poseIdDepth);
-
-        // Set shader uniforms
-        genMeshFromBC4Shader->bind();
-        {
-            genMeshFromBC4Shader->setBool("unlinearizeDepth", true);
-            genMeshFromBC4Shader->setVec2("depthMapSize", glm::vec2(videoTextureDepth->width, videoTextureDepth->height));
-            genMeshFromBC4Shader->setInt("surfelSize", surfelSize);
+        if (depthDeltaCodec) {
+            poseIdDepth = depthReceiver->draw(poseIdColor);
         }
-        {
-            genMeshFromBC4Shader->setMat4("projection", remoteCamera.getProjectionMatrix());
-            genMeshFromBC4Shader->setMat4("projectionInverse", glm::inverse(remoteCamera.getProjectionMatrix()));
-            if (poseStreamer->getPose(poseIdColor, &currentColorFramePose, &elapsedTimeColor)) {
-                genMeshFromBC4Shader->setMat4("viewColor", currentColorFramePose.mono.view);
+        else {
+            videoTextureDepth->bind();
+            poseIdDepth = videoTextureDepth->draw(poseIdColor);
+        }
+        if (logStatsThisFrame) {
+            spdlog::info("poseIdColor: {}, poseIdDepth: {}", poseIdColor, poseIdDepth);
+        }
+
+        // Only regenerate the mesh from a fresh color/depth pair. Otherwise keep drawing the last good mesh,
+        // which is in world space and so stays correct under head motion.
+        bool hasColorPose = getFramePose(poseIdColor, &currentColorFramePose, &elapsedTimeColor);
+        bool hasDepthPose = getFramePose(poseIdDepth, &currentDepthFramePose, &elapsedTimeDepth);
+        bool repeatedFrame = poseIdColor == lastPoseIdColor && poseIdDepth == lastPoseIdDepth;
+        bool staleFrame = false;
+        if (hasColorPose && hasDepthPose && !repeatedFrame) {
+            // Each new pair updates the baseline once, whether or not it is used, so the baseline follows
+            // a lasting change in latency instead of rejecting every frame after it
+            double frameLatencyMs = std::max(elapsedTimeColor, elapsedTimeDepth);
+            bool newPair = poseIdColor != lastSeenPoseIdColor || poseIdDepth != lastSeenPoseIdDepth;
+            if (newPair) {
+                smoothedFrameLatencyMs = (smoothedFrameLatencyMs < 0.0) ? frameLatencyMs :
+                    smoothedFrameLatencyMs + concealmentParams.latencySmoothing * (frameLatencyMs - smoothedFrameLatencyMs);
+                lastSeenPoseIdColor = poseIdColor;
+                lastSeenPoseIdDepth = poseIdDepth;
             }
-            if (poseStreamer->getPose(poseIdDepth, &currentDepthFramePose, &elapsedTimeDepth)) {
-                genMeshFromBC4Shader->setMat4("viewInverseDepth", glm::inverse(currentDepthFramePose.mono.view));
+            // Re-tested every frame; a rejected pair isn't consumed, only a generated one is (lastPoseId*)
+            staleFrame = frameLatencyMs > smoothedFrameLatencyMs + concealmentParams.maxFrameLatenessMs;
+        }
+        bool freshPair = hasColorPose && hasDepthPose && !repeatedFrame && !staleFrame;
+
+        concealmentStats.framesTotal++;
+        if (freshPair) {
+            posePredictor.addLatencySample(std::max(elapsedTimeColor, elapsedTimeDepth));
+            generateMesh();
+            lastPoseIdColor = poseIdColor;
+            lastPoseIdDepth = poseIdDepth;
+            concealmentStats.currentRun = 0;
+        }
+        else {
+            concealmentStats.framesConcealed++;
+            if (!hasColorPose || !hasDepthPose) concealmentStats.missingPose++;
+            else if (repeatedFrame) concealmentStats.repeatedFrames++;
+            else concealmentStats.staleFrames++;
+            concealmentStats.currentRun++;
+            concealmentStats.longestRun = std::max(concealmentStats.longestRun, concealmentStats.currentRun);
+        }
+
+        poseStreamer->removePosesLessThan(std::min(poseIdColor, poseIdDepth));
+
+        // Show only the last good set (if any has been generated yet)
+        for (size_t i = 0; i < meshBuffers.size(); i++) {
+            bool isLastGood = hasGoodMesh && (i == meshBuffers.currentIndex());
+            meshBuffers[i].node->visible = isLastGood;
+            meshBuffers[i].nodeWireframe->visible = isLastGood && wireframeVisible;
+        }
+
+        // Decoding and mesh generation ran with the views located at the start of the frame; draw with newer ones
+        LateLatchViews();
+
+        // Only draw the tiles of the mesh that either eye can see. Concealed frames are culled
+        // against the current head pose too, since the mesh is in world space. Their set was drawn
+        // last frame and may still be in flight, so the cull waits for that draw on the GPU.
+        cameraBuffer->update(*cameras);
+        if (hasGoodMesh) {
+            MeshBufferSet &meshSet = meshBuffers.current();
+            meshBuffers.waitCurrent();
+            meshSet.tileCuller->cull(*meshSet.mesh, *cameraBuffer);
+        }
+
+        // Render
+        renderStats = m_graphicsAPI->drawObjects(*scene.get(), *cameras.get());
+
+        // Fence the set so it is not regenerated until this frame's draw has retired
+        if (hasGoodMesh) {
+            meshBuffers.release();
+        }
+
+        if (logStatsThisFrame) {
+            spdlog::info("Concealed frames: {}/{} (repeated: {}, stale: {}, missing pose: {}, longest run: {}, latency {:.1f}ms)",
+                         concealmentStats.framesConcealed, concealmentStats.framesTotal,
+                         concealmentStats.repeatedFrames, concealmentStats.staleFrames,
+                         concealmentStats.missingPose, concealmentStats.longestRun, smoothedFrameLatencyMs);
+            if (depthDeltaCodec) {
+                BC4DeltaDepthReceiver::Stats depthStats = depthReceiver->getStats();
+                spdlog::info("Depth codec: {} decoded, {} dropped, ratio {:.2f}x, decode {:.2f}ms",
+                             depthStats.framesDecoded, depthStats.framesDropped,
+                             depthStats.compressionRatio, depthStats.timeToDecodeMs);
             }
+        }
 
-            genMeshFromBC4Shader->setFloat("near", remoteCamera.getNear());
-            genMeshFromBC4Shader->setFloat("far", remoteCamera.getFar());
+        if (logStatsThisFrame && glm::abs(elapsedTimeColor) > 1e-5f) {
+            spdlog::info("E2E Latency (RGB): {:.3f}ms", elapsedTimeColor);
+        }
+        if (logStatsThisFrame && glm::abs(elapsedTimeDepth) > 1e-5f) {
+            spdlog::info("E2E Latency (D): {:.3f}ms", elapsedTimeDepth);
         }
+        if (predictPoses && logStatsThisFrame) {
+            const PosePredictor::Stats &predictionStats = posePredictor.stats;
+            spdlog::info("Pose prediction ({:.1f}ms ahead): {:.1f}mm, {:.2f}deg error ({:.1f}mm, {:.2f}deg unpredicted)",
+                         predictionStats.latencyMs,
+                         predictionStats.positionErrorMm, predictionStats.rotationErrorDeg,
+                         predictionStats.unpredictedPositionErrorMm, predictionStats.unpredictedRotationErrorDeg);
+        }
+    }
+
+    void updateQuality() {
+        QualityGovernor::Sample sample;
+        const FrameTiming::Frame &lastFrame = frameTiming.getLastFrame();
+        sample.cpuTimeMs = lastFrame.workTimeMs;
+        sample.missedFrames = lastFrame.missedFrames;
+        // Left negative on frames without a new GPU result, which the governor skips
+        m_graphicsAPI->gpuProfiler->getLatestMs("frame", sample.gpuTimeMs);
+        if (depthDeltaCodec) {
+            sample.decodeTimeMs = depthReceiver->getStats().timeToDecodeMs;
+        }
+
+        double frameBudgetMs = m_renderLayerInfo.predictedDisplayPeriod / 1e+6; // Convert nanoseconds to milliseconds.
+        if (!qualityGovernor->update(sample, frameBudgetMs)) {
+            return;
+        }
+
+        const QualityGovernor::Stats &governorStats = qualityGovernor->stats;
+        spdlog::info("Quality level {} (load {:.2f}: CPU {:.2f}ms, GPU {:.2f}ms, decode {:.2f}ms, budget {:.2f}ms)",
+                     qualityGovernor->getLevel(), governorStats.load,
+                     governorStats.smoothedCPUTimeMs, governorStats.smoothedGPUTimeMs, governorStats.smoothedDecodeTimeMs,
+                     frameBudgetMs);
+
+        // Takes effect from the next generated mesh
+        const QualityLevel &quality = qualityLevels[qualityGovernor->getLevel()];
+        currentSurfelSize = surfelSize * quality.surfelScale;
+
+        QualityRequest request;
+        request.level = qualityGovernor->getLevel();
+        request.videoWidth = videoSize.x;
+        request.videoHeight = videoSize.y;
+        request.depthFactor = depthFactor;
+        request.frameRate = static_cast<float>(quality.frameRateScale * 1000.0 / frameBudgetMs);
+        if (qualityRequestStreamer) {
+            qualityRequestStreamer->send(request);
+        }
+    }
+
+    // The pose a streamed frame was rendered for. Replays look it up in the recording, which is where it was sent from.
+    bool getFramePose(pose_id_t id, Pose* pose, double* elapsedTimeMs) {
+        if (streamReplayer) {
+            return streamReplayer->getPose(id, pose, elapsedTimeMs);
+        }
+        if (!poseStreamer->getPose(id, pose, elapsedTimeMs)) {
+            return false;
+        }
+        if (streamRecorder) {
+            streamRecorder->writePoseAck(id, *pose, *elapsedTimeMs);
+        }
+        return true;
+    }
+
+    // Vertices and indices of the mesh generated from a depth frame with the given surfel size.
+    // The mesh has a vertex per surfel of the depth map, which is what generateMesh dispatches over.
+    void getMeshSize(unsigned int meshSurfelSize, unsigned int &numVertices, unsigned int &numIndices) const {
+        glm::uvec2 adjustedDepthSize = depthSize / meshSurfelSize;
+        numVertices = adjustedDepthSize.x * adjustedDepthSize.y;
+        unsigned int numTriangles = (adjustedDepthSize.x-1) * (adjustedDepthSize.y-1) * 2;
+        numIndices = numTriangles * 3;
+    }
+
+    void generateMesh() {
+        GPUProfiler::Scope meshGenScope(*m_graphicsAPI->gpuProfiler, "meshGen");
+
+        // Set shader uniforms
+        genMeshFromBC4Shader->bind();
         {
-            genMeshFromBC4Shader->setBuffer(GL_SHADER_STORAGE_BUFFER, 0, mesh->vertexBuffer);
-            genMeshFromBC4Shader->setBuffer(GL_SHADER_STORAGE_BUFFER, 1, mesh->indexBuffer);
-            genMeshFromBC4Shader->setBuffer(GL_SHADER_STORAGE_BUFFER, 2, videoTextureDepth->bc4CompressedBuffer);
+            genMeshUniforms.surfelSize.set(static_cast<int>(currentSurfelSize));
+            genMeshUniforms.viewColor.set(currentColorFramePose.mono.view);
+            genMeshUniforms.viewInverseDepth.set(glm::inverse(currentDepthFramePose.mono.view));
+        }
+        // Pick a mesh buffer set the GPU is no longer drawing from
+        MeshBufferSet &meshSet = meshBuffers[meshBuffers.acquire()];
+        // Coarser surfels write fewer vertices and indices, so only cull and pack those. Indices past the count
+        // are left over from a finer level and never drawn, since the culler only builds the draw from the count.
+        getMeshSize(currentSurfelSize, numMeshVertices, meshSet.numIndices);
+        numMeshVertices = std::min(numMeshVertices, maxMeshVertices);
+        meshSet.numIndices = std::min(meshSet.numIndices, maxMeshIndices);
+        Mesh* outputMesh = packVertices ? unpackedMesh : meshSet.mesh;
+        {
+            genMeshFromBC4Shader->setBuffer(GL_SHADER_STORAGE_BUFFER, 0, outputMesh->vertexBuffer);
+            genMeshFromBC4Shader->setBuffer(GL_SHADER_STORAGE_BUFFER, 1, outputMesh->indexBuffer);
+            genMeshFromBC4Shader->setBuffer(GL_SHADER_STORAGE_BUFFER, 2, *depthBlocksBuffer);
         }
 
         // Dispatch compute shader to generate vertices and indices for both main and wireframe meshes
         genMeshFromBC4Shader->dispatch(
-                ((videoTextureDepth->width / surfelSize) + THREADS_PER_LOCALGROUP - 1) / THREADS_PER_LOCALGROUP,
-                ((videoTextureDepth->height / surfelSize) + THREADS_PER_LOCALGROUP - 1) / THREADS_PER_LOCALGROUP,
+                ((depthSize.x / currentSurfelSize) + THREADS_PER_LOCALGROUP - 1) / THREADS_PER_LOCALGROUP,
+                ((depthSize.y / currentSurfelSize) + THREADS_PER_LOCALGROUP - 1) / THREADS_PER_LOCALGROUP,
                 1
             );
-        genMeshFromBC4Shader->memoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT |
-                                            GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT);
-
-        poseStreamer->removePosesLessThan(std::min(poseIdColor, poseIdDepth));
-
-        // Render
-        renderStats = m_graphicsAPI->drawObjects(*scene.get(), *cameras.get());
-
-        if (glm::abs(elapsedTimeColor) > 1e-5f) {
-            XR_LOG("E2E Latency (RGB): " << elapsedTimeColor << "ms");
-        }
-        if (glm::abs(elapsedTimeDepth) > 1e-5f) {
-            XR_LOG("E2E Latency (D): " << elapsedTimeDepth << "ms");
+        // Only the vertex fetch of this set depends on the compute output; other sets are untouched
+        genMeshFromBC4Shader->memoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_ELEMENT_ARRAY_BARRIER_BIT);
+
+        // Keep a copy of the generated indices and the per-tile bounds for culling.
+        // Culling writes the visible indices into meshSet.mesh, so this also works from the scratch mesh.
+        meshSet.tileCuller->update(*outputMesh, meshSet.numIndices);
+
+        if (packVertices) {
+            // Positions are stored relative to the remote camera, the nodes move them back
+            glm::vec3 remotePosition = glm::vec3(glm::inverse(currentDepthFramePose.mono.view)[3]);
+            vertexPacker->setBounds(remotePosition, glm::vec3(1.0f));
+            vertexPacker->pack(outputMesh->vertexBuffer, numMeshVertices, *meshSet.mesh);
+            meshSet.node->setPosition(remotePosition);
+            meshSet.nodeWireframe->setPosition(remotePosition);
         }
+
+        hasGoodMesh = true;
     }
 
     void DestroyResources() override {
         delete videoTextureColor;
         delete videoTextureDepth;
-        delete mesh;
-        delete node;
+        delete depthReceiver;
+        // The fences have to go while the context is current, not when the app is destroyed
+        meshBuffers.destroyFences();
+        for (size_t i = 0; i < meshBuffers.size(); i++) {
+            // Detach the shared materials, so they are only deleted once (below)
+            meshBuffers[i].mesh->material = nullptr;
+            meshBuffers[i].nodeWireframe->overrideMaterial = nullptr;
+            delete meshBuffers[i].mesh;
+            delete meshBuffers[i].node;
+            delete meshBuffers[i].nodeWireframe;
+            delete meshBuffers[i].tileCuller;
+        }
+        if (unpackedMesh != nullptr) {
+            unpackedMesh->material = nullptr;
+        }
+        delete unpackedMesh;
+        delete meshMaterial;
+        delete wireframeMaterial;
+        delete vertexPacker;
         delete genMeshFromBC4Shader;
+        cameraBuffer.reset();
+
+        // The taps and the depth receiver write into the recorder
+        videoTap.reset();
+        depthTap.reset();
+        streamRecorder.reset();
+        streamReplayer.reset();
     }
 
     VideoTexture* videoTextureColor;
-    BC4DepthVideoTexture* videoTextureDepth;
+    BC4DepthVideoTexture* videoTextureDepth = nullptr;
+    BC4DeltaDepthReceiver* depthReceiver = nullptr;
+    glm::uvec2 depthSize;
+    Buffer* depthBlocksBuffer = nullptr;
     PoseStreamer* poseStreamer;
+    PosePredictor posePredictor;
+    std::unique_ptr<VRCamera> predictedCameras;
+
+    std::unique_ptr<QualityGovernor> qualityGovernor;
+    std::unique_ptr<QualityRequestStreamer> qualityRequestStreamer;
+    unsigned int currentSurfelSize = 1;
+
+    // Stream recording and replay (OpenXRApp::streamCapture)
+    std::unique_ptr<StreamRecorder> streamRecorder;
+    std::unique_ptr<StreamReplayer> streamReplayer;
+    std::unique_ptr<StreamTap> videoTap;
+    std::unique_ptr<StreamTap> depthTap;
 
     pose_id_t poseIdColor = -1;
     pose_id_t poseIdDepth = -1;
     // Get poses for the current frames
-    double elapsedTimeColor, elapsedTimeDepth;
+    double elapsedTimeColor = 0.0, elapsedTimeDepth = 0.0;
     Pose currentColorFramePose, currentDepthFramePose;
 
+    // Frame-drop concealment
+    pose_id_t lastPoseIdColor = -1;
+    pose_id_t lastPoseIdDepth = -1;
+    pose_id_t lastSeenPoseIdColor = -1;
+    pose_id_t lastSeenPoseIdDepth = -1;
+    double smoothedFrameLatencyMs = -1.0;
+    bool hasGoodMesh = false;
+    struct ConcealmentStats {
+        uint64_t framesTotal = 0;
+        uint64_t framesConcealed = 0;
+        uint64_t repeatedFrames = 0;
+        uint64_t staleFrames = 0;
+        uint64_t missingPose = 0;
+        uint64_t currentRun = 0;
+        uint64_t longestRun = 0;
+    } concealmentStats;
+
     PerspectiveCamera remoteCamera;
 
-    Mesh* mesh;
-    Node* node;
-    Node* nodeWireframe;
+    struct MeshBufferSet {
+        Mesh* mesh = nullptr;
+        Node* node = nullptr;
+        Node* nodeWireframe = nullptr;
+        TileCuller* tileCuller = nullptr;
+        unsigned int numIndices = 0;
+    };
+    FencedRing<MeshBufferSet, NUM_MESH_BUFFERS> meshBuffers;
+    UnlitMaterial* meshMaterial = nullptr;
+    UnlitMaterial* wireframeMaterial = nullptr;
+    unsigned int numMeshVertices = 0;
+    // What the buffers were created for (surfelSize)
+    unsigned int maxMeshVertices = 0;
+    unsigned int maxMeshIndices = 0;
+    bool wireframeVisible = false;
+
+    Mesh* unpackedMesh = nullptr;
+    VertexPacker* vertexPacker = nullptr;
 
     ComputeShader* genMeshFromBC4Shader;
+    // Per-frame uniforms, resolved once; the rest are set when the shader is created
+    struct {
+        UniformLocation surfelSize;
+        UniformLocation viewColor;
+        UniformLocation viewInverseDepth;
+    } genMeshUniforms;
+    std::unique_ptr<StereoCameraBuffer> cameraBuffer;
 
     RenderStats renderStats;
 
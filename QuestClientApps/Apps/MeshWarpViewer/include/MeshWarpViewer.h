@@ -12,6 +12,8 @@
 #include <Utils/FileIO.h>
 
 #include <BC4DepthVideoTexture.h>
+#include <TileCuller.h>
+#include <StereoCameraBuffer.h>
 
 #include <shaders_common.h>
 
@@ -90,8 +92,11 @@ private:
             .maxVertices = maxVertices,
             .maxIndices = maxIndices,
             .material = new UnlitMaterial({ .baseColorTexture = colorTexture }),
-            .usage = GL_DYNAMIC_DRAW
+            .usage = GL_DYNAMIC_DRAW,
+            .indirectDraw = true
         });
+        tileCuller = new TileCuller(maxIndices, sizeof(Vertex));
+        numMeshIndices = maxIndices;
         node = new Node(mesh);
         node->frustumCulled = false;
         scene->addChildNode(node);
@@ -111,6 +116,20 @@ private:
                 "#define THREADS_PER_LOCALGROUP " + std::to_string(GEN_MESH_THREADS_PER_LOCALGROUP)
             }
         });
+
+        // The saved frame doesn't change, so the uniforms are only set once
+        genMeshFromBC4Shader->bind();
+        genMeshFromBC4Shader->setBool("unlinearizeDepth", true);
+        genMeshFromBC4Shader->setVec2("screenSize", windowSize);
+        genMeshFromBC4Shader->setVec2("depthMapSize", glm::vec2(colorTexture->width, colorTexture->height));
+        genMeshFromBC4Shader->setInt("surfelSize", surfelSize);
+        genMeshFromBC4Shader->setMat4("projection", remoteCamera->getProjectionMatrix());
+        genMeshFromBC4Shader->setMat4("projectionInverse", glm::inverse(remoteCamera->getProjectionMatrix()));
+        genMeshFromBC4Shader->setMat4("viewInverseDepth", glm::inverse(remoteCamera->getViewMatrix()));
+        genMeshFromBC4Shader->setFloat("near", remoteCamera->getNear());
+        genMeshFromBC4Shader->setFloat("far", remoteCamera->getFar());
+
+        cameraBuffer = new StereoCameraBuffer();
     }
 
     void CreateActionSet() override {
@@ -197,42 +216,43 @@ private:
 
     void OnRender(double now, double dt) override {
         double startTime = timeutils::getTimeMicros();
-        genMeshFromBC4Shader->bind();
-
-        genMeshFromBC4Shader->setBool("unlinearizeDepth", true);
-
-        genMeshFromBC4Shader->setVec2("screenSize", windowSize);
-        genMeshFromBC4Shader->setVec2("depthMapSize", glm::vec2(colorTexture->width, colorTexture->height));
-        genMeshFromBC4Shader->setInt("surfelSize", surfelSize);
-
-        genMeshFromBC4Shader->setMat4("projection", remoteCamera->getProjectionMatrix());
-        genMeshFromBC4Shader->setMat4("projectionInverse", glm::inverse(remoteCamera->getProjectionMatrix()));
-        genMeshFromBC4Shader->setMat4("viewInverseDepth", glm::inverse(remoteCamera->getViewMatrix()));
-        genMeshFromBC4Shader->setFloat("near", remoteCamera->getNear());
-        genMeshFromBC4Shader->setFloat("far", remoteCamera->getFar());
-
-        genMeshFromBC4Shader->setBuffer(GL_SHADER_STORAGE_BUFFER, 0, mesh->vertexBuffer);
-        genMeshFromBC4Shader->setBuffer(GL_SHADER_STORAGE_BUFFER, 1, mesh->indexBuffer);
-        genMeshFromBC4Shader->setBuffer(GL_SHADER_STORAGE_BUFFER, 2, *bc4BufferData);
-
-        genMeshFromBC4Shader->dispatch(
-            (windowSize.x / surfelSize + GEN_MESH_THREADS_PER_LOCALGROUP - 1) / GEN_MESH_THREADS_PER_LOCALGROUP,
-            (windowSize.y / surfelSize + GEN_MESH_THREADS_PER_LOCALGROUP - 1) / GEN_MESH_THREADS_PER_LOCALGROUP,
-            1
-        );
-
-        genMeshFromBC4Shader->memoryBarrier(
-            GL_SHADER_STORAGE_BARRIER_BIT |
-            GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT |
-            GL_ELEMENT_ARRAY_BARRIER_BIT
-        );
+        {
+            GPUProfiler::Scope meshGenScope(*m_graphicsAPI->gpuProfiler, "meshGen");
+            genMeshFromBC4Shader->bind();
+
+            genMeshFromBC4Shader->setBuffer(GL_SHADER_STORAGE_BUFFER, 0, mesh->vertexBuffer);
+            genMeshFromBC4Shader->setBuffer(GL_SHADER_STORAGE_BUFFER, 1, mesh->indexBuffer);
+            genMeshFromBC4Shader->setBuffer(GL_SHADER_STORAGE_BUFFER, 2, *bc4BufferData);
+
+            genMeshFromBC4Shader->dispatch(
+                (windowSize.x / surfelSize + GEN_MESH_THREADS_PER_LOCALGROUP - 1) / GEN_MESH_THREADS_PER_LOCALGROUP,
+                (windowSize.y / surfelSize + GEN_MESH_THREADS_PER_LOCALGROUP - 1) / GEN_MESH_THREADS_PER_LOCALGROUP,
+                1
+            );
+
+            genMeshFromBC4Shader->memoryBarrier(
+                GL_SHADER_STORAGE_BARRIER_BIT |
+                GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT |
+                GL_ELEMENT_ARRAY_BARRIER_BIT
+            );
+
+            tileCuller->update(*mesh, numMeshIndices);
+        }
         double endTime = timeutils::getTimeMicros();
 
+        // Only draw the tiles of the mesh that either eye can see
+        {
+            GPUProfiler::Scope cullScope(*m_graphicsAPI->gpuProfiler, "tileCull");
+            cameraBuffer->update(*cameras);
+            tileCuller->cull(*mesh, *cameraBuffer);
+        }
+
         // Render
         m_graphicsAPI->drawObjects(*scene.get(), *cameras.get());
 
-        spdlog::info("Mesh generation time: {:.3f}ms", timeutils::microsToMillis(endTime - startTime));
-        spdlog::info("Rendering time: {:.3f}ms", timeutils::secondsToMillis(dt));
+        if (logStatsThisFrame) {
+            spdlog::info("Mesh generation time (CPU submit): {:.3f}ms", timeutils::microsToMillis(endTime - startTime));
+        }
     }
 
     void DestroyResources() override {
@@ -240,7 +260,9 @@ private:
         delete bc4BufferData;
         delete mesh;
         delete node;
+        delete tileCuller;
         delete genMeshFromBC4Shader;
+        delete cameraBuffer;
         delete remoteCamera;
     }
 
@@ -253,6 +275,10 @@ private:
     Node* node;
     Node* nodeWireframe;
 
+    TileCuller* tileCuller;
+    StereoCameraBuffer* cameraBuffer;
+    unsigned int numMeshIndices;
+
     ComputeShader* genMeshFromBC4Shader;
 
     // Actions.
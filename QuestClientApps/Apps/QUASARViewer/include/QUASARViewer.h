@@ -15,6 +15,8 @@
 #include <Quads/DepthOffsets.h>
 #include <Quads/MeshFromQuads.h>
 
+#include <TileCuller.h>
+
 using namespace quasar;
 
 class QUASARViewer final : public OpenXRApp {
@@ -44,6 +46,7 @@ public:
         meshes.reserve(maxViews);
         nodes.reserve(maxViews);
         nodeWireframes.reserve(maxViews);
+        tileCullers.reserve(maxViews);
         colorTextures.reserve(maxViews);
     }
     ~QUASARViewer() = default;
@@ -152,6 +155,10 @@ private:
                 *meshes[view]
             );
 
+            // Meshes are static, so tile bounds only need to be computed once
+            tileCullers.push_back(new TileCuller(numProxies * NUM_SUB_QUADS * INDICES_IN_A_QUAD, sizeof(QuadVertex)));
+            tileCullers[view]->update(*meshes[view]);
+
             totalProxies += numProxies;
             totalDepthOffsets = numDepthOffsets;
         }
@@ -258,8 +265,11 @@ private:
     }
 
     void OnRender(double now, double dt) override {
+        for (int view = 0; view < maxViews; view++) {
+            tileCullers[view]->cull(*meshes[view], *cameras.get(), glm::translate(glm::mat4(1.0f), nodes[view]->getPosition()));
+        }
+
         m_graphicsAPI->drawObjects(*scene.get(), *cameras.get());
-        spdlog::info("Rendering time: {:.3f}ms", timeutils::secondsToMillis(dt));
     }
 
     void DestroyResources() override {
@@ -273,6 +283,9 @@ private:
         for (auto node : nodes) {
             delete node;
         }
+        for (auto tileCuller : tileCullers) {
+            delete tileCuller;
+        }
     }
 
 private:
@@ -289,6 +302,7 @@ private:
     std::vector<Mesh*> meshes;
     std::vector<Node*> nodes;
     std::vector<Node*> nodeWireframes;
+    std::vector<TileCuller*> tileCullers;
 
     // Tracking data
     uint totalProxies = 0;
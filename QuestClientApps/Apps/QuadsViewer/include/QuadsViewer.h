@@ -15,6 +15,10 @@
 #include <Quads/DepthOffsets.h>
 #include <Quads/MeshFromQuads.h>
 
+#include <TileCuller.h>
+#include <StereoCameraBuffer.h>
+#include <VertexPacker.h>
+
 using namespace quasar;
 
 class QuadsViewer final : public OpenXRApp {
@@ -22,6 +26,9 @@ private:
     std::string sceneName = "robot_lab";
     std::string dataPathBase = "quads/" + sceneName + "/";
 
+    // Draw the quads from packed vertices (half float positions around the remote camera, unorm16 texture coordinates)
+    bool packVertices = false;
+
 public:
     QuadsViewer(GraphicsAPI_Type apiType)
             : OpenXRApp(apiType) {
@@ -96,21 +103,45 @@ private:
         std::string depthOffsetsFileName = dataPath / "depthOffsets.bin.zstd";
         numDepthOffsets = depthOffsets->loadFromFile(depthOffsetsFileName);
 
+        QuadMaterial* material = new QuadMaterial({ .baseColorTexture = colorTexture });
+        numMeshVertices = numProxies * NUM_SUB_QUADS * VERTICES_IN_A_QUAD;
+        if (packVertices) {
+            // MeshFromQuads writes float vertices here, they are packed into mesh every frame
+            unpackedMesh = new Mesh({
+                .maxVertices = numMeshVertices,
+                .maxIndices = numProxies * NUM_SUB_QUADS * INDICES_IN_A_QUAD,
+                .vertexSize = sizeof(QuadVertex),
+                .attributes = QuadVertex::getVertexInputAttributes(),
+                .material = material,
+                .usage = GL_DYNAMIC_DRAW,
+                .indirectDraw = true
+            });
+            vertexPacker = new VertexPacker(sizeof(QuadVertex), QuadVertex::getVertexInputAttributes(), {
+                .position = static_cast<int>(offsetof(QuadVertex, position)),
+                .texCoords = static_cast<int>(offsetof(QuadVertex, texCoords))
+            });
+            vertexPacker->setBounds(remoteCamera->getPosition(), glm::vec3(1.0f));
+        }
         mesh = new Mesh({
-            .maxVertices = numProxies * NUM_SUB_QUADS * VERTICES_IN_A_QUAD,
+            .maxVertices = numMeshVertices,
             .maxIndices = numProxies * NUM_SUB_QUADS * INDICES_IN_A_QUAD,
-            .vertexSize = sizeof(QuadVertex),
-            .attributes = QuadVertex::getVertexInputAttributes(),
-            .material = new QuadMaterial({ .baseColorTexture = colorTexture }),
+            .vertexSize = packVertices ? vertexPacker->getVertexSize() : (uint)sizeof(QuadVertex),
+            .attributes = packVertices ? vertexPacker->getAttributes() : QuadVertex::getVertexInputAttributes(),
+            .material = material,
             .usage = GL_DYNAMIC_DRAW,
             .indirectDraw = true
         });
+        tileCuller = new TileCuller(numProxies * NUM_SUB_QUADS * INDICES_IN_A_QUAD, sizeof(QuadVertex));
+        cameraBuffer = new StereoCameraBuffer();
 
         spdlog::info("Loaded {} proxies and {} depth offsets", numProxies, numDepthOffsets);
 
+        // Packed positions are already relative to the remote camera
+        glm::vec3 meshPosition = packVertices ? glm::vec3(0.0f) : -1.0f * remoteCamera->getPosition();
+
         node = new Node(mesh);
         node->frustumCulled = false;
-        node->setPosition(-1.0f * remoteCamera->getPosition());
+        node->setPosition(meshPosition);
         scene->addChildNode(node);
 
         nodeWireframe = new Node(mesh);
@@ -119,7 +150,7 @@ private:
         nodeWireframe->visible = false;
         nodeWireframe->primativeType = GL_LINES;
         nodeWireframe->overrideMaterial = new QuadMaterial({ .baseColor = glm::vec4(1.0f, 1.0f, 0.0f, 1.0f) });
-        nodeWireframe->setPosition(-1.0f * remoteCamera->getPosition());
+        nodeWireframe->setPosition(meshPosition);
         scene->addChildNode(nodeWireframe);
     }
 
@@ -208,15 +239,28 @@ private:
             remoteWindowSize,
             numProxies, *depthOffsets,
             *remoteCamera,
-            *mesh
+            packVertices ? *unpackedMesh : *mesh
         );
 
+        // Only draw the tiles of the mesh that either eye can see.
+        // Tile bounds are in the space of the unpacked vertices.
+        if (packVertices) {
+            tileCuller->update(*unpackedMesh);
+            vertexPacker->pack(unpackedMesh->vertexBuffer, numMeshVertices, *mesh);
+        }
+        else {
+            tileCuller->update(*mesh);
+        }
+        cameraBuffer->update(*cameras);
+        tileCuller->cull(*mesh, *cameraBuffer, glm::translate(glm::mat4(1.0f), -1.0f * remoteCamera->getPosition()));
+
         m_graphicsAPI->drawObjects(*scene.get(), *cameras.get());
 
-        spdlog::info("Time to append proxies: {:.3f}ms", meshFromQuads->stats.timeToAppendQuadsMs);
-        spdlog::info("Time to fill output quads: {:.3f}ms", meshFromQuads->stats.timeToGatherQuadsMs);
-        spdlog::info("Time to create mesh: {:.3f}ms", meshFromQuads->stats.timeToCreateMeshMs);
-        spdlog::info("Rendering time: {:.3f}ms", timeutils::secondsToMillis(dt));
+        if (logStatsThisFrame) {
+            spdlog::info("Time to append proxies: {:.3f}ms", meshFromQuads->stats.timeToAppendQuadsMs);
+            spdlog::info("Time to fill output quads: {:.3f}ms", meshFromQuads->stats.timeToGatherQuadsMs);
+            spdlog::info("Time to create mesh: {:.3f}ms", meshFromQuads->stats.timeToCreateMeshMs);
+        }
     }
 
     void DestroyResources() override {
@@ -224,6 +268,10 @@ private:
         delete colorTexture;
         delete mesh;
         delete node;
+        delete tileCuller;
+        delete cameraBuffer;
+        delete unpackedMesh;
+        delete vertexPacker;
     }
 
     glm::uvec2 remoteWindowSize;
@@ -238,6 +286,12 @@ private:
     DepthOffsets* depthOffsets;
 
     Mesh* mesh;
+    unsigned int numMeshVertices;
+    TileCuller* tileCuller;
+    StereoCameraBuffer* cameraBuffer;
+
+    Mesh* unpackedMesh = nullptr;
+    VertexPacker* vertexPacker = nullptr;
     Texture* colorTexture;
     Node* node;
     Node* nodeWireframe;
@@ -11,20 +11,37 @@
 #include <Lights/DirectionalLight.h>
 #include <Lights/PointLight.h>
 
+#include <VertexPacker.h>
+
 using namespace quasar;
 
 class SceneViewer final : public OpenXRApp {
 private:
     glm::uvec2 windowSize = glm::uvec2(1024, 1024);
 
+    // Draw RobotLab from packed vertices instead of LODs (LOD generation reads float vertices)
+    bool packVertices = false;
+
 public:
-    SceneViewer(GraphicsAPI_Type apiType) : OpenXRApp(apiType) {}
+    SceneViewer(GraphicsAPI_Type apiType) : OpenXRApp(apiType) {
+        // Heavy scenes would rather drop pixels than frames; never above the recommended resolution
+        dynamicResolutionEnabled = true;
+        dynamicResolutionParams.minScale = 0.6f;
+    }
     ~SceneViewer() = default;
 
 private:
     void CreateResources() override {
         scene->backgroundColor = glm::vec4(0.17f, 0.17f, 0.17f, 1.0f);
 
+        // Large GLB scenes repeat meshes and share materials, so sort draws to cut state changes
+        m_graphicsAPI->useRenderQueue = true;
+
+        // Only the animated props (robot arm, rc flyer) and the controllers cast moving shadows, so the rest
+        // of the lab stays in the cached static shadow map and only they are re-rendered each frame
+        m_graphicsAPI->cacheShadows = true;
+        m_graphicsAPI->shadowCache.movingNodes = { &m_handNodes[0], &m_handNodes[1] };
+
         // Add lights
         AmbientLight* ambientLight = new AmbientLight({
             .intensity = 0.1f
@@ -81,15 +98,48 @@ private:
         });
         m_handNodes[1].setEntity(rightControllerMesh);
 
-        Model* robotLab = new Model({
-            .flipTextures = true,
-            .gammaCorrected = true,
-            .IBL = 0,
-            .path = "models/scenes/RobotLab.glb"
-        });
-        scene->addChildNode(new Node(robotLab));
         cameraPositionOffset += glm::vec3(0.0f, 3.0f, 10.0f);
 
+        // RobotLab takes seconds to load, so load it in the background and start with just the lights and controllers.
+        // Packing and LOD generation read the meshes back, so they run in the background too.
+        m_graphicsAPI->resourceLoader->enqueue(
+            [this]() {
+                robotLab = new Model({
+                    .flipTextures = true,
+                    .gammaCorrected = true,
+                    .IBL = 0,
+                    .path = "models/scenes/RobotLab.glb"
+                });
+
+                if (packVertices) {
+                    robotLabLayouts = VertexPacker::packModel(*robotLab, { .position = PackedVertexFormat::Position::SNORM16 });
+                }
+                else {
+                    // The scene is triangle bound in stereo, so draw distant meshes with fewer triangles.
+                    // Levels are cached in app storage after the first run.
+                    robotLabLOD = std::make_unique<MeshLOD>();
+                    robotLabLOD->generate(*robotLab, GetDataPath() + "/RobotLab.lod", jobSystem.get());
+                }
+            },
+            [this]() {
+                ResourceLoader &resourceLoader = *m_graphicsAPI->resourceLoader;
+                ResourceLoader::AdoptedMeshes adoptedMeshes = resourceLoader.adoptModel(*robotLab, robotLabLayouts);
+                if (robotLabLOD) {
+                    ResourceLoader::AdoptedMeshes adoptedLevels = resourceLoader.adoptMeshes(robotLabLOD->getLevelMeshes());
+                    adoptedMeshes.insert(adoptedLevels.begin(), adoptedLevels.end());
+                    robotLabLOD->remapMeshes(adoptedMeshes);
+                    meshLOD = std::move(robotLabLOD);
+                    m_graphicsAPI->renderQueue.meshLOD = meshLOD.get();
+                }
+
+                SetupRobotLab();
+                scene->addChildNode(new Node(robotLab));
+                m_graphicsAPI->shadowCache.invalidate();
+            }
+        );
+    }
+
+    void SetupRobotLab() {
         {
             Node* node = robotLab->findNodeByName("prop_robotArm_body");
             if (node != nullptr) {
@@ -279,12 +329,39 @@ private:
         scene->updateAnimations(dt);
         m_graphicsAPI->drawObjects(*scene.get(), *cameras.get());
 
-        spdlog::info("Rendering time: {:.3f}ms", timeutils::secondsToMillis(dt));
+        if (!logStatsThisFrame) {
+            return;
+        }
+
+        const RenderQueue::Stats &queueStats = m_graphicsAPI->renderQueue.stats;
+        spdlog::info("Draw calls: {}, shader changes: {} -> {}, material binds: {} -> {}, transform only: {}, passthrough nodes: {}",
+                     queueStats.drawCalls,
+                     queueStats.unsortedShaderChanges, queueStats.shaderChanges,
+                     queueStats.unsortedMaterialBinds, queueStats.materialBinds,
+                     queueStats.transformOnlyDraws, queueStats.passthroughNodes);
+        const ShadowCache::Stats &shadowStats = m_graphicsAPI->shadowCache.stats;
+        spdlog::info("Shadow map static updates: {}, dynamic updates: {}, skipped: {}",
+                     shadowStats.staticUpdates, shadowStats.dynamicUpdates, shadowStats.skipped);
+
+        if (meshLOD) {
+            const MeshLOD::Stats &lodStats = meshLOD->stats;
+            spdlog::info("LOD draws: {}/{}/{}/{}, triangles: {} of {}",
+                         lodStats.draws[0], lodStats.draws[1], lodStats.draws[2], lodStats.draws[3],
+                         lodStats.drawnTriangles, lodStats.fullTriangles);
+        }
     }
 
     void DestroyResources() override {
+        m_graphicsAPI->renderQueue.meshLOD = nullptr;
+        meshLOD.reset();
     }
 
+    Model* robotLab = nullptr;
+    // Made on the loader's worker; the render thread only touches them once the load is ready
+    VertexLayouts robotLabLayouts;
+    std::unique_ptr<MeshLOD> robotLabLOD;
+    std::unique_ptr<MeshLOD> meshLOD;
+
     // Actions.
     XrAction m_clickAction;
     // The realtime states of these actions.
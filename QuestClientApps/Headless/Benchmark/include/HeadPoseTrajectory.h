@@ -0,0 +1,42 @@
+#ifndef HEAD_POSE_TRAJECTORY_H
+#define HEAD_POSE_TRAJECTORY_H
+
+#include <string>
+#include <vector>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <openxr/openxr.h>
+
+namespace quasar {
+
+// Head poses over time for the null runtime, interpolated between keyframes and looped.
+//
+// Recorded trajectories are CSV files with one keyframe per line, "t,px,py,pz,qx,qy,qz,qw" (seconds, meters,
+// and an orientation quaternion) in the LOCAL reference space; blank lines and lines starting with '#' are
+// skipped. Without a file, a scripted look around is used.
+class HeadPoseTrajectory {
+public:
+    struct Keyframe {
+        double time;
+        glm::vec3 position;
+        glm::quat orientation;
+    };
+
+    // The scripted look around: sweeps yaw and pitch while swaying slightly, which exercises culling,
+    // LOD selection and reprojection
+    HeadPoseTrajectory();
+
+    bool loadCSV(const std::string &path);
+
+    double getDuration() const { return keyframes.back().time; }
+    XrPosef getPose(double seconds) const;
+
+private:
+    std::vector<Keyframe> keyframes;
+};
+
+} // namespace quasar
+
+#endif // HEAD_POSE_TRAJECTORY_H
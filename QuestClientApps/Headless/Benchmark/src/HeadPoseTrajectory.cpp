@@ -0,0 +1,92 @@
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <sstream>
+
+#include <spdlog/spdlog.h>
+
+#include <HeadPoseTrajectory.h>
+
+using namespace quasar;
+
+HeadPoseTrajectory::HeadPoseTrajectory() {
+    constexpr double duration = 8.0;
+    constexpr int numKeyframes = 64;
+
+    for (int i = 0; i <= numKeyframes; i++) {
+        double t = duration * i / numKeyframes;
+        double phase = 2.0 * M_PI * t / duration;
+
+        float yaw = glm::radians(60.0f) * static_cast<float>(std::sin(phase));
+        float pitch = glm::radians(15.0f) * static_cast<float>(std::sin(2.0 * phase));
+        glm::quat orientation = glm::angleAxis(yaw, glm::vec3(0.0f, 1.0f, 0.0f)) *
+                                glm::angleAxis(pitch, glm::vec3(1.0f, 0.0f, 0.0f));
+        glm::vec3 position(0.1f * std::sin(phase), 0.02f * std::sin(4.0 * phase), 0.0f);
+
+        keyframes.push_back({ t, position, orientation });
+    }
+}
+
+bool HeadPoseTrajectory::loadCSV(const std::string &path) {
+    std::ifstream file(path);
+    if (!file.is_open()) {
+        spdlog::error("Failed to open trajectory {}", path);
+        return false;
+    }
+
+    std::vector<Keyframe> loaded;
+    std::string line;
+    int lineNumber = 0;
+    while (std::getline(file, line)) {
+        lineNumber++;
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        std::replace(line.begin(), line.end(), ',', ' ');
+        std::istringstream fields(line);
+        Keyframe keyframe;
+        float qx, qy, qz, qw;
+        if (!(fields >> keyframe.time >> keyframe.position.x >> keyframe.position.y >> keyframe.position.z >> qx >> qy >> qz >> qw)) {
+            spdlog::error("Bad keyframe on line {} of {}", lineNumber, path);
+            return false;
+        }
+        keyframe.orientation = glm::normalize(glm::quat(qw, qx, qy, qz));
+
+        if (!loaded.empty() && keyframe.time <= loaded.back().time) {
+            spdlog::error("Keyframe times must increase (line {} of {})", lineNumber, path);
+            return false;
+        }
+        loaded.push_back(keyframe);
+    }
+
+    if (loaded.size() < 2) {
+        spdlog::error("Trajectory {} needs at least two keyframes", path);
+        return false;
+    }
+
+    keyframes = std::move(loaded);
+    return true;
+}
+
+XrPosef HeadPoseTrajectory::getPose(double seconds) const {
+    const Keyframe &first = keyframes.front();
+    double duration = getDuration() - first.time;
+    double t = first.time + std::fmod(std::max(seconds, 0.0), duration);
+
+    auto next = std::upper_bound(keyframes.begin(), keyframes.end(), t, [](double time, const Keyframe &keyframe) {
+        return time < keyframe.time;
+    });
+    next = std::clamp(next, keyframes.begin() + 1, keyframes.end() - 1);
+    const Keyframe &a = *(next - 1);
+    const Keyframe &b = *next;
+
+    float alpha = static_cast<float>((t - a.time) / (b.time - a.time));
+    glm::vec3 position = glm::mix(a.position, b.position, alpha);
+    glm::quat orientation = glm::slerp(a.orientation, b.orientation, alpha);
+
+    return {
+        { orientation.x, orientation.y, orientation.z, orientation.w },
+        { position.x, position.y, position.z }
+    };
+}
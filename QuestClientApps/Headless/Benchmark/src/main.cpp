@@ -0,0 +1,264 @@
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+
+#include BENCHMARK_APP_HEADER
+
+#if defined(QUEST_CLIENT_NULL_RUNTIME)
+#include <NullRuntime.h>
+#endif
+
+#include <HeadPoseTrajectory.h>
+
+using namespace quasar;
+
+struct Options {
+    uint64_t frames = 1000;
+    uint64_t warmupFrames = 100;
+    std::string trajectoryPath;
+    // The apps log to stdout, so the report goes to a file
+    std::string outputPath = BENCHMARK_APP_NAME "Benchmark.json";
+    uint32_t eyeWidth = 1024;
+    uint32_t eyeHeight = 1024;
+    float displayRate = 72.0f;
+    bool realtime = false;
+    std::string replayPath;
+    float replaySpeed = 1.0f;
+    std::string recordPath;
+};
+
+struct Results {
+    std::vector<double> workTimeMs;
+    std::vector<double> waitTimeMs;
+    std::vector<double> submitTimeMs;
+    std::vector<double> gpuTimeMs;
+    uint64_t missedFrames = 0;
+    uint64_t lateFrames = 0;
+    double drawCalls = 0.0;
+    double triangles = 0.0;
+    uint64_t allocations = 0;
+    uint64_t allocatedBytes = 0;
+    uint64_t framesWithAllocations = 0;
+};
+
+static void printUsage(const char* program) {
+    std::printf(
+        "Usage: %s [options]\n"
+        "  --frames N          frames to measure (default 1000)\n"
+        "  --warmup N          frames to run before measuring (default 100)\n"
+        "  --trajectory FILE   head pose CSV (t,px,py,pz,qx,qy,qz,qw), default is a scripted look around\n"
+        "  --output FILE       JSON report path (default " BENCHMARK_APP_NAME "Benchmark.json)\n"
+        "  --eye-size WxH      per eye swapchain size (default 1024x1024)\n"
+        "  --display-rate HZ   simulated display refresh rate (default 72)\n"
+        "  --realtime          pace frames at the display rate instead of running flat out\n"
+        "  --replay FILE       feed a streaming client a recorded session (.qsr) instead of a server\n"
+        "  --replay-speed X    replay clock rate relative to the frame clock (default 1)\n"
+        "  --record FILE       record the session a streaming client receives from its server (.qsr)\n",
+        program);
+}
+
+static bool parseOptions(int argc, char** argv, Options &options) {
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--frames" && hasValue) {
+            options.frames = std::stoull(argv[++i]);
+        }
+        else if (arg == "--warmup" && hasValue) {
+            options.warmupFrames = std::stoull(argv[++i]);
+        }
+        else if (arg == "--trajectory" && hasValue) {
+            options.trajectoryPath = argv[++i];
+        }
+        else if (arg == "--output" && hasValue) {
+            options.outputPath = argv[++i];
+        }
+        else if (arg == "--eye-size" && hasValue) {
+            if (std::sscanf(argv[++i], "%ux%u", &options.eyeWidth, &options.eyeHeight) != 2) {
+                return false;
+            }
+        }
+        else if (arg == "--display-rate" && hasValue) {
+            options.displayRate = std::stof(argv[++i]);
+        }
+        else if (arg == "--realtime") {
+            options.realtime = true;
+        }
+        else if (arg == "--replay" && hasValue) {
+            options.replayPath = argv[++i];
+        }
+        else if (arg == "--replay-speed" && hasValue) {
+            options.replaySpeed = std::stof(argv[++i]);
+        }
+        else if (arg == "--record" && hasValue) {
+            options.recordPath = argv[++i];
+        }
+        else {
+            return false;
+        }
+    }
+    bool oneCaptureMode = options.replayPath.empty() || options.recordPath.empty();
+    return options.frames > 0 && options.displayRate > 0.0f && options.replaySpeed > 0.0f && oneCaptureMode;
+}
+
+// VmRSS and VmHWM (peak) in kB
+static void getMemoryUsage(uint64_t &rssKB, uint64_t &peakRssKB) {
+    rssKB = peakRssKB = 0;
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line)) {
+        if (line.rfind("VmRSS:", 0) == 0) {
+            rssKB = std::stoull(line.substr(6));
+        }
+        else if (line.rfind("VmHWM:", 0) == 0) {
+            peakRssKB = std::stoull(line.substr(6));
+        }
+    }
+}
+
+static std::string summarize(std::vector<double> values) {
+    if (values.empty()) {
+        return "null";
+    }
+    std::sort(values.begin(), values.end());
+    auto percentile = [&](double p) {
+        return values[static_cast<size_t>(p * (values.size() - 1) + 0.5)];
+    };
+    double mean = std::accumulate(values.begin(), values.end(), 0.0) / values.size();
+
+    std::ostringstream json;
+    json << "{ \"mean\": " << mean << ", \"p50\": " << percentile(0.5) << ", \"p90\": " << percentile(0.9)
+         << ", \"p99\": " << percentile(0.99) << ", \"max\": " << values.back() << " }";
+    return json.str();
+}
+
+static void writeReport(std::ostream &out, const Options &options, const Results &results) {
+    uint64_t frames = results.workTimeMs.size();
+    uint64_t rssKB, peakRssKB;
+    getMemoryUsage(rssKB, peakRssKB);
+
+    out << "{\n";
+    out << "  \"app\": \"" << BENCHMARK_APP_NAME << "\",\n";
+    out << "  \"frames\": " << frames << ",\n";
+    out << "  \"warmupFrames\": " << options.warmupFrames << ",\n";
+    out << "  \"eyeWidth\": " << options.eyeWidth << ",\n";
+    out << "  \"eyeHeight\": " << options.eyeHeight << ",\n";
+    out << "  \"displayRate\": " << options.displayRate << ",\n";
+    out << "  \"trajectory\": \"" << (options.trajectoryPath.empty() ? "scripted" : options.trajectoryPath) << "\",\n";
+    out << "  \"replay\": \"" << (options.replayPath.empty() ? "none" : options.replayPath) << "\",\n";
+    out << "  \"replaySpeed\": " << options.replaySpeed << ",\n";
+    out << "  \"cpuWorkMs\": " << summarize(results.workTimeMs) << ",\n";
+    out << "  \"cpuWaitMs\": " << summarize(results.waitTimeMs) << ",\n";
+    out << "  \"submitMs\": " << summarize(results.submitTimeMs) << ",\n";
+    // Null without GL_EXT_disjoint_timer_query
+    out << "  \"gpuFrameMs\": " << summarize(results.gpuTimeMs) << ",\n";
+    out << "  \"drawCallsPerFrame\": " << results.drawCalls / frames << ",\n";
+    out << "  \"trianglesPerFrame\": " << results.triangles / frames << ",\n";
+    out << "  \"missedFrames\": " << results.missedFrames << ",\n";
+    out << "  \"lateFrames\": " << results.lateFrames << ",\n";
+#if defined(QUEST_CLIENT_NULL_RUNTIME)
+    // Views submitted with depth (XR_KHR_composition_layer_depth) over the whole run, warmup included
+    out << "  \"depthInfosSubmitted\": " << NullRuntime::getDepthInfosSubmitted() << ",\n";
+#endif
+    out << "  \"memory\": {\n";
+    out << "    \"rssKB\": " << rssKB << ",\n";
+    out << "    \"peakRssKB\": " << peakRssKB << ",\n";
+    if (AllocationTracker::isEnabled()) {
+        out << "    \"allocationsPerFrame\": " << static_cast<double>(results.allocations) / frames << ",\n";
+        out << "    \"allocatedBytesPerFrame\": " << static_cast<double>(results.allocatedBytes) / frames << ",\n";
+        // Steady state frames shouldn't allocate; frames that finish a background load do
+        out << "    \"framesWithAllocations\": " << results.framesWithAllocations << "\n";
+    }
+    else {
+        // Only counted with QUEST_CLIENT_TRACK_ALLOCATIONS
+        out << "    \"allocationsPerFrame\": null,\n";
+        out << "    \"allocatedBytesPerFrame\": null,\n";
+        out << "    \"framesWithAllocations\": null\n";
+    }
+    out << "  }\n";
+    out << "}\n";
+}
+
+int main(int argc, char** argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    HeadPoseTrajectory trajectory;
+    if (!options.trajectoryPath.empty() && !trajectory.loadCSV(options.trajectoryPath)) {
+        return 1;
+    }
+
+#if defined(QUEST_CLIENT_NULL_RUNTIME)
+    NullRuntime::Settings settings;
+    settings.eyeWidth = options.eyeWidth;
+    settings.eyeHeight = options.eyeHeight;
+    settings.displayRate = options.displayRate;
+    settings.frameLimit = options.warmupFrames + options.frames;
+    settings.realtime = options.realtime;
+    settings.headPose = [&trajectory](double seconds) { return trajectory.getPose(seconds); };
+    NullRuntime::configure(settings);
+#endif
+
+    DebugOutput debugOutput;
+
+    BENCHMARK_APP app(QUEST_CLIENT_GRAPHICS_API);
+    if (!options.replayPath.empty()) {
+        // Frame dt drives the replay clock, so records are handed over on the same frames on every run
+        // (decoding still runs on the receivers' threads, so frames can become ready a frame apart)
+        app.streamCapture.mode = OpenXRApp::StreamCapture::Mode::REPLAY;
+        app.streamCapture.path = options.replayPath;
+        app.streamCapture.replay.speed = options.replaySpeed;
+    }
+    else if (!options.recordPath.empty()) {
+        app.streamCapture.mode = OpenXRApp::StreamCapture::Mode::RECORD;
+        app.streamCapture.path = options.recordPath;
+    }
+    // Keep the app's periodic logs out of the measurements
+    spdlog::set_level(spdlog::level::warn);
+
+    Results results;
+    uint64_t frameIndex = 0;
+    bool reportWritten = false;
+    app.onFrameEnd = [&](const OpenXRApp::FrameReport &report) {
+        if (frameIndex++ < options.warmupFrames || reportWritten) {
+            return;
+        }
+
+        results.workTimeMs.push_back(report.timing.workTimeMs);
+        results.waitTimeMs.push_back(report.timing.waitTimeMs);
+        results.submitTimeMs.push_back(report.timing.submitTimeMs);
+        if (report.gpuTimeMs >= 0.0) {
+            results.gpuTimeMs.push_back(report.gpuTimeMs);
+        }
+        results.missedFrames += report.timing.missedFrames;
+        results.lateFrames += report.timing.late ? 1 : 0;
+        results.drawCalls += report.renderStats.drawCalls;
+        results.triangles += report.renderStats.trianglesDrawn;
+        results.allocations += report.allocations.allocations;
+        results.allocatedBytes += report.allocations.bytes;
+        results.framesWithAllocations += report.allocations.allocations > 0 ? 1 : 0;
+
+        if (results.workTimeMs.size() < options.frames) {
+            return;
+        }
+
+        // Written here rather than after Run(), so teardown isn't measured and an external runtime
+        // (which doesn't stop by itself) still gets a report
+        std::ofstream file(options.outputPath);
+        writeReport(file, options, results);
+        reportWritten = true;
+    };
+
+    app.Run();
+
+    if (!reportWritten) {
+        spdlog::error("Session ended after {} of {} frames", frameIndex, options.warmupFrames + options.frames);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,46 @@
+#ifndef NULL_RUNTIME_H
+#define NULL_RUNTIME_H
+
+#include <cstdint>
+#include <functional>
+
+#include <openxr/openxr.h>
+
+namespace quasar {
+
+// Minimal OpenXR runtime for headless host builds, linked in place of the loader. It implements the
+// entry points OpenXRApp uses: swapchains are GL textures that nothing presents (depth chained to projection
+// views is validated, not composited), the head follows a scripted pose, controllers are never tracked and
+// the session stops by itself after a number of frames.
+//
+// Display times are simulated (one display period per xrWaitFrame) unless realtime is set, so a run is
+// deterministic and as fast as the app can render.
+class NullRuntime {
+public:
+    struct Settings {
+        uint32_t eyeWidth = 1024;
+        uint32_t eyeHeight = 1024;
+        float displayRate = 72.0f;
+        // Frames submitted before the session stops, 0 to never stop
+        uint64_t frameLimit = 0;
+        // Blocks in xrWaitFrame to pace frames at the display rate in wall clock time
+        bool realtime = false;
+        float ipd = 0.063f;
+        // Half angle of every eye's symmetric field of view, in radians
+        float halfFov = 0.82f;
+        // Pose of the head in the reference space, by seconds since the first frame. Identity if unset.
+        std::function<XrPosef(double)> headPose;
+    };
+
+    // Call before the app creates its instance
+    static void configure(const Settings &settings);
+
+    static uint64_t getFramesSubmitted();
+    // Projection views submitted with a valid XR_KHR_composition_layer_depth depth info. xrEndFrame fails with
+    // XR_ERROR_VALIDATION_FAILURE on an invalid one.
+    static uint64_t getDepthInfosSubmitted();
+};
+
+} // namespace quasar
+
+#endif // NULL_RUNTIME_H
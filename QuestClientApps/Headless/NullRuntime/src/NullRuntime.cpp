@@ -0,0 +1,723 @@
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iterator>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <EGL/egl.h>
+#include <GLES3/gl32.h>
+
+#include <openxr/openxr.h>
+#include <openxr/openxr_platform.h>
+#include <openxr/openxr_reflection.h>
+
+#include <NullRuntime.h>
+
+using namespace quasar;
+
+namespace {
+
+constexpr XrSystemId SYSTEM_ID = 1;
+constexpr uint32_t NUM_SWAPCHAIN_IMAGES = 3;
+constexpr uint32_t MAX_IMAGE_SIZE = 4096;
+// XrTime of the first display time; any nonzero value works
+constexpr XrTime START_TIME = 1'000'000'000;
+
+struct Swapchain {
+    GLenum target;
+    GLenum format;
+    uint32_t width, height, arraySize;
+    std::vector<GLuint> images;
+    uint32_t nextImage = 0;
+};
+
+struct Space {
+    bool isActionSpace;
+    XrPosef poseInReferenceSpace;
+};
+
+struct Runtime {
+    NullRuntime::Settings settings;
+
+    std::mutex eventMutex;
+    std::deque<XrEventDataBuffer> events;
+
+    std::vector<std::string> paths = { "" };
+
+    XrSession session = XR_NULL_HANDLE;
+    XrSessionState sessionState = XR_SESSION_STATE_UNKNOWN;
+
+    // xrWaitFrame may run on a pacing thread while the app thread is in xrEndFrame
+    std::atomic<uint64_t> framesWaited = 0;
+    std::atomic<uint64_t> framesSubmitted = 0;
+    std::atomic<uint64_t> depthInfosSubmitted = 0;
+    std::chrono::steady_clock::time_point realtimeStart;
+
+    XrTime getDisplayPeriod() const {
+        return static_cast<XrTime>(1e+9 / settings.displayRate);
+    }
+};
+
+Runtime runtime;
+
+// Handles are pointers to heap objects (or a dummy allocation for handles with no state)
+template <typename Handle, typename T>
+Handle toHandle(T* object) {
+    return reinterpret_cast<Handle>(object);
+}
+
+template <typename T, typename Handle>
+T* fromHandle(Handle handle) {
+    return reinterpret_cast<T*>(handle);
+}
+
+// Two call idiom: report the count, and fill the output if it has room
+template <typename T, typename Fill>
+XrResult enumerate(uint32_t capacityInput, uint32_t* countOutput, T* output, uint32_t count, Fill fill) {
+    if (countOutput == nullptr) {
+        return XR_ERROR_VALIDATION_FAILURE;
+    }
+    *countOutput = count;
+    if (capacityInput == 0) {
+        return XR_SUCCESS;
+    }
+    if (capacityInput < count) {
+        return XR_ERROR_SIZE_INSUFFICIENT;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        fill(output[i], i);
+    }
+    return XR_SUCCESS;
+}
+
+void queueSessionState(XrSessionState state, XrTime time) {
+    XrEventDataSessionStateChanged event{XR_TYPE_EVENT_DATA_SESSION_STATE_CHANGED};
+    event.session = runtime.session;
+    event.state = state;
+    event.time = time;
+
+    XrEventDataBuffer buffer{};
+    std::memcpy(&buffer, &event, sizeof(event));
+
+    std::lock_guard<std::mutex> lock(runtime.eventMutex);
+    runtime.events.push_back(buffer);
+}
+
+XrTime getLastDisplayTime() {
+    return START_TIME + static_cast<XrTime>(runtime.framesWaited) * runtime.getDisplayPeriod();
+}
+
+XrVector3f rotate(const XrQuaternionf &q, const XrVector3f &v) {
+    // v + 2w(q x v) + 2 q x (q x v)
+    XrVector3f t = {
+        2.0f * (q.y * v.z - q.z * v.y),
+        2.0f * (q.z * v.x - q.x * v.z),
+        2.0f * (q.x * v.y - q.y * v.x)
+    };
+    return {
+        v.x + q.w * t.x + (q.y * t.z - q.z * t.y),
+        v.y + q.w * t.y + (q.z * t.x - q.x * t.z),
+        v.z + q.w * t.z + (q.x * t.y - q.y * t.x)
+    };
+}
+
+XrPosef getHeadPose(XrTime time) {
+    if (!runtime.settings.headPose) {
+        return {{0.0f, 0.0f, 0.0f, 1.0f}, {0.0f, 0.0f, 0.0f}};
+    }
+    return runtime.settings.headPose(static_cast<double>(time - START_TIME) / 1e+9);
+}
+
+void copyString(char* dst, size_t size, const char* src) {
+    std::snprintf(dst, size, "%s", src);
+}
+
+bool isDepthFormat(GLenum format) {
+    return format == GL_DEPTH_COMPONENT32F || format == GL_DEPTH_COMPONENT24 || format == GL_DEPTH_COMPONENT16;
+}
+
+// Checks a depth info chained to a projection view the way XR_KHR_composition_layer_depth requires,
+// so the headless runs catch depth submission errors a device runtime would reject
+bool isValidDepthInfo(const XrCompositionLayerDepthInfoKHR &depthInfo) {
+    const auto* sc = fromHandle<Swapchain>(depthInfo.subImage.swapchain);
+    if (sc == nullptr || !isDepthFormat(sc->format)) {
+        std::fprintf(stderr, "NullRuntime: depth info doesn't reference a depth swapchain\n");
+        return false;
+    }
+    const XrRect2Di &rect = depthInfo.subImage.imageRect;
+    if (rect.offset.x < 0 || rect.offset.y < 0 || rect.extent.width <= 0 || rect.extent.height <= 0 ||
+        static_cast<uint32_t>(rect.offset.x + rect.extent.width) > sc->width ||
+        static_cast<uint32_t>(rect.offset.y + rect.extent.height) > sc->height ||
+        depthInfo.subImage.imageArrayIndex >= sc->arraySize) {
+        std::fprintf(stderr, "NullRuntime: depth info sub-image is outside its swapchain\n");
+        return false;
+    }
+    if (depthInfo.minDepth < 0.0f || depthInfo.maxDepth > 1.0f || depthInfo.minDepth >= depthInfo.maxDepth ||
+        !(depthInfo.nearZ >= 0.0f) || !(depthInfo.farZ >= 0.0f) || depthInfo.nearZ == depthInfo.farZ) {
+        std::fprintf(stderr, "NullRuntime: depth info has an invalid depth range\n");
+        return false;
+    }
+    return true;
+}
+
+} // namespace
+
+void NullRuntime::configure(const Settings &settings) {
+    runtime.settings = settings;
+}
+
+uint64_t NullRuntime::getFramesSubmitted() {
+    return runtime.framesSubmitted;
+}
+
+uint64_t NullRuntime::getDepthInfosSubmitted() {
+    return runtime.depthInfosSubmitted;
+}
+
+// Instance
+
+XRAPI_ATTR XrResult XRAPI_CALL xrEnumerateApiLayerProperties(uint32_t propertyCapacityInput, uint32_t* propertyCountOutput, XrApiLayerProperties* properties) {
+    return enumerate(propertyCapacityInput, propertyCountOutput, properties, 0, [](XrApiLayerProperties&, uint32_t) {});
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrEnumerateInstanceExtensionProperties(const char* layerName, uint32_t propertyCapacityInput, uint32_t* propertyCountOutput, XrExtensionProperties* properties) {
+    static const std::pair<const char*, uint32_t> extensions[] = {
+        { XR_KHR_OPENGL_ES_ENABLE_EXTENSION_NAME, XR_KHR_opengl_es_enable_SPEC_VERSION },
+        { XR_MNDX_EGL_ENABLE_EXTENSION_NAME, XR_MNDX_egl_enable_SPEC_VERSION },
+        { XR_KHR_COMPOSITION_LAYER_DEPTH_EXTENSION_NAME, XR_KHR_composition_layer_depth_SPEC_VERSION },
+        { XR_EXT_DEBUG_UTILS_EXTENSION_NAME, XR_EXT_debug_utils_SPEC_VERSION },
+    };
+    if (layerName != nullptr) {
+        return XR_ERROR_API_LAYER_NOT_PRESENT;
+    }
+    return enumerate(propertyCapacityInput, propertyCountOutput, properties, std::size(extensions), [](XrExtensionProperties &property, uint32_t i) {
+        copyString(property.extensionName, XR_MAX_EXTENSION_NAME_SIZE, extensions[i].first);
+        property.extensionVersion = extensions[i].second;
+    });
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrCreateInstance(const XrInstanceCreateInfo* createInfo, XrInstance* instance) {
+    uint32_t numExtensions = 0;
+    xrEnumerateInstanceExtensionProperties(nullptr, 0, &numExtensions, nullptr);
+    std::vector<XrExtensionProperties> extensions(numExtensions, {XR_TYPE_EXTENSION_PROPERTIES});
+    xrEnumerateInstanceExtensionProperties(nullptr, numExtensions, &numExtensions, extensions.data());
+
+    for (uint32_t i = 0; i < createInfo->enabledExtensionCount; i++) {
+        bool found = false;
+        for (const auto &extension : extensions) {
+            found |= std::strcmp(extension.extensionName, createInfo->enabledExtensionNames[i]) == 0;
+        }
+        if (!found) {
+            return XR_ERROR_EXTENSION_NOT_PRESENT;
+        }
+    }
+    if (createInfo->enabledApiLayerCount > 0) {
+        return XR_ERROR_API_LAYER_NOT_PRESENT;
+    }
+
+    *instance = toHandle<XrInstance>(new int);
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrDestroyInstance(XrInstance instance) {
+    delete fromHandle<int>(instance);
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrGetInstanceProperties(XrInstance instance, XrInstanceProperties* instanceProperties) {
+    instanceProperties->runtimeVersion = XR_MAKE_VERSION(1, 0, 0);
+    copyString(instanceProperties->runtimeName, XR_MAX_RUNTIME_NAME_SIZE, "QuestClient Null Runtime");
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrResultToString(XrInstance instance, XrResult value, char buffer[XR_MAX_RESULT_STRING_SIZE]) {
+    switch (value) {
+#define RESULT_CASE(name, val) case name: copyString(buffer, XR_MAX_RESULT_STRING_SIZE, #name); break;
+        XR_LIST_ENUM_XrResult(RESULT_CASE)
+#undef RESULT_CASE
+        default:
+            std::snprintf(buffer, XR_MAX_RESULT_STRING_SIZE, "XR_UNKNOWN_RESULT_%d", value);
+            break;
+    }
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrPollEvent(XrInstance instance, XrEventDataBuffer* eventData) {
+    std::lock_guard<std::mutex> lock(runtime.eventMutex);
+    if (runtime.events.empty()) {
+        return XR_EVENT_UNAVAILABLE;
+    }
+    *eventData = runtime.events.front();
+    runtime.events.pop_front();
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrStringToPath(XrInstance instance, const char* pathString, XrPath* path) {
+    for (size_t i = 1; i < runtime.paths.size(); i++) {
+        if (runtime.paths[i] == pathString) {
+            *path = i;
+            return XR_SUCCESS;
+        }
+    }
+    runtime.paths.push_back(pathString);
+    *path = runtime.paths.size() - 1;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrPathToString(XrInstance instance, XrPath path, uint32_t bufferCapacityInput, uint32_t* bufferCountOutput, char* buffer) {
+    if (path == XR_NULL_PATH || path >= runtime.paths.size()) {
+        return XR_ERROR_PATH_INVALID;
+    }
+    const std::string &string = runtime.paths[path];
+    return enumerate(bufferCapacityInput, bufferCountOutput, buffer, string.size() + 1, [&](char &c, uint32_t i) {
+        c = (i < string.size()) ? string[i] : '\0';
+    });
+}
+
+// System
+
+XRAPI_ATTR XrResult XRAPI_CALL xrGetSystem(XrInstance instance, const XrSystemGetInfo* getInfo, XrSystemId* systemId) {
+    if (getInfo->formFactor != XR_FORM_FACTOR_HEAD_MOUNTED_DISPLAY) {
+        return XR_ERROR_FORM_FACTOR_UNSUPPORTED;
+    }
+    *systemId = SYSTEM_ID;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrGetSystemProperties(XrInstance instance, XrSystemId systemId, XrSystemProperties* properties) {
+    properties->systemId = SYSTEM_ID;
+    properties->vendorId = 0;
+    copyString(properties->systemName, XR_MAX_SYSTEM_NAME_SIZE, "Null HMD");
+    properties->graphicsProperties.maxSwapchainImageWidth = MAX_IMAGE_SIZE;
+    properties->graphicsProperties.maxSwapchainImageHeight = MAX_IMAGE_SIZE;
+    properties->graphicsProperties.maxLayerCount = XR_MIN_COMPOSITION_LAYERS_SUPPORTED;
+    properties->trackingProperties.orientationTracking = XR_TRUE;
+    properties->trackingProperties.positionTracking = XR_TRUE;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrEnumerateViewConfigurations(XrInstance instance, XrSystemId systemId, uint32_t viewConfigurationTypeCapacityInput, uint32_t* viewConfigurationTypeCountOutput, XrViewConfigurationType* viewConfigurationTypes) {
+    return enumerate(viewConfigurationTypeCapacityInput, viewConfigurationTypeCountOutput, viewConfigurationTypes, 1, [](XrViewConfigurationType &type, uint32_t) {
+        type = XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO;
+    });
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrEnumerateViewConfigurationViews(XrInstance instance, XrSystemId systemId, XrViewConfigurationType viewConfigurationType, uint32_t viewCapacityInput, uint32_t* viewCountOutput, XrViewConfigurationView* views) {
+    if (viewConfigurationType != XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO) {
+        return XR_ERROR_VIEW_CONFIGURATION_TYPE_UNSUPPORTED;
+    }
+    return enumerate(viewCapacityInput, viewCountOutput, views, 2, [](XrViewConfigurationView &view, uint32_t) {
+        view.recommendedImageRectWidth = runtime.settings.eyeWidth;
+        view.recommendedImageRectHeight = runtime.settings.eyeHeight;
+        view.maxImageRectWidth = MAX_IMAGE_SIZE;
+        view.maxImageRectHeight = MAX_IMAGE_SIZE;
+        view.recommendedSwapchainSampleCount = 1;
+        view.maxSwapchainSampleCount = 1;
+    });
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrEnumerateEnvironmentBlendModes(XrInstance instance, XrSystemId systemId, XrViewConfigurationType viewConfigurationType, uint32_t environmentBlendModeCapacityInput, uint32_t* environmentBlendModeCountOutput, XrEnvironmentBlendMode* environmentBlendModes) {
+    return enumerate(environmentBlendModeCapacityInput, environmentBlendModeCountOutput, environmentBlendModes, 1, [](XrEnvironmentBlendMode &mode, uint32_t) {
+        mode = XR_ENVIRONMENT_BLEND_MODE_OPAQUE;
+    });
+}
+
+// Session
+
+XRAPI_ATTR XrResult XRAPI_CALL xrCreateSession(XrInstance instance, const XrSessionCreateInfo* createInfo, XrSession* session) {
+    if (runtime.session != XR_NULL_HANDLE) {
+        return XR_ERROR_LIMIT_REACHED;
+    }
+
+    // The app's EGL context must be current on this thread; swapchain images are created in it
+    bool hasBinding = false;
+    for (auto* next = static_cast<const XrBaseInStructure*>(createInfo->next); next != nullptr; next = next->next) {
+        hasBinding |= next->type == XR_TYPE_GRAPHICS_BINDING_EGL_MNDX;
+    }
+    if (!hasBinding || eglGetCurrentContext() == EGL_NO_CONTEXT) {
+        return XR_ERROR_GRAPHICS_DEVICE_INVALID;
+    }
+
+    *session = toHandle<XrSession>(new int);
+    runtime.session = *session;
+    runtime.framesWaited = 0;
+    runtime.framesSubmitted = 0;
+
+    runtime.sessionState = XR_SESSION_STATE_READY;
+    queueSessionState(XR_SESSION_STATE_IDLE, START_TIME);
+    queueSessionState(XR_SESSION_STATE_READY, START_TIME);
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrDestroySession(XrSession session) {
+    delete fromHandle<int>(session);
+    runtime.session = XR_NULL_HANDLE;
+    runtime.sessionState = XR_SESSION_STATE_UNKNOWN;
+
+    std::lock_guard<std::mutex> lock(runtime.eventMutex);
+    runtime.events.clear();
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrBeginSession(XrSession session, const XrSessionBeginInfo* beginInfo) {
+    if (beginInfo->primaryViewConfigurationType != XR_VIEW_CONFIGURATION_TYPE_PRIMARY_STEREO) {
+        return XR_ERROR_VIEW_CONFIGURATION_TYPE_UNSUPPORTED;
+    }
+    if (runtime.sessionState != XR_SESSION_STATE_READY) {
+        return XR_ERROR_SESSION_NOT_READY;
+    }
+
+    runtime.realtimeStart = std::chrono::steady_clock::now();
+
+    runtime.sessionState = XR_SESSION_STATE_FOCUSED;
+    queueSessionState(XR_SESSION_STATE_SYNCHRONIZED, START_TIME);
+    queueSessionState(XR_SESSION_STATE_VISIBLE, START_TIME);
+    queueSessionState(XR_SESSION_STATE_FOCUSED, START_TIME);
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrEndSession(XrSession session) {
+    if (runtime.sessionState != XR_SESSION_STATE_STOPPING) {
+        return XR_ERROR_SESSION_NOT_STOPPING;
+    }
+
+    // Nothing restarts a headless session, so exit right away
+    runtime.sessionState = XR_SESSION_STATE_EXITING;
+    queueSessionState(XR_SESSION_STATE_IDLE, getLastDisplayTime());
+    queueSessionState(XR_SESSION_STATE_EXITING, getLastDisplayTime());
+    return XR_SUCCESS;
+}
+
+// Frames
+
+XRAPI_ATTR XrResult XRAPI_CALL xrWaitFrame(XrSession session, const XrFrameWaitInfo* frameWaitInfo, XrFrameState* frameState) {
+    uint64_t frame = ++runtime.framesWaited;
+    XrTime period = runtime.getDisplayPeriod();
+
+    if (runtime.settings.realtime) {
+        std::this_thread::sleep_until(runtime.realtimeStart + std::chrono::nanoseconds(frame * period));
+    }
+
+    frameState->predictedDisplayTime = START_TIME + static_cast<XrTime>(frame) * period;
+    frameState->predictedDisplayPeriod = period;
+    frameState->shouldRender = runtime.sessionState == XR_SESSION_STATE_VISIBLE ||
+                               runtime.sessionState == XR_SESSION_STATE_FOCUSED;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrBeginFrame(XrSession session, const XrFrameBeginInfo* frameBeginInfo) {
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrEndFrame(XrSession session, const XrFrameEndInfo* frameEndInfo) {
+    // Nothing composites the layers, but depth submitted with them is validated
+    for (uint32_t i = 0; i < frameEndInfo->layerCount; i++) {
+        if (frameEndInfo->layers[i]->type != XR_TYPE_COMPOSITION_LAYER_PROJECTION) {
+            continue;
+        }
+        const auto* layer = reinterpret_cast<const XrCompositionLayerProjection*>(frameEndInfo->layers[i]);
+        for (uint32_t v = 0; v < layer->viewCount; v++) {
+            for (auto* next = static_cast<const XrBaseInStructure*>(layer->views[v].next); next != nullptr; next = next->next) {
+                if (next->type != XR_TYPE_COMPOSITION_LAYER_DEPTH_INFO_KHR) {
+                    continue;
+                }
+                if (!isValidDepthInfo(*reinterpret_cast<const XrCompositionLayerDepthInfoKHR*>(next))) {
+                    return XR_ERROR_VALIDATION_FAILURE;
+                }
+                runtime.depthInfosSubmitted++;
+            }
+        }
+    }
+
+    // Flushing keeps the GPU work of each frame inside its frame
+    glFlush();
+
+    uint64_t frames = ++runtime.framesSubmitted;
+    if (runtime.settings.frameLimit > 0 && frames == runtime.settings.frameLimit) {
+        runtime.sessionState = XR_SESSION_STATE_STOPPING;
+        queueSessionState(XR_SESSION_STATE_STOPPING, frameEndInfo->displayTime);
+    }
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrLocateViews(XrSession session, const XrViewLocateInfo* viewLocateInfo, XrViewState* viewState, uint32_t viewCapacityInput, uint32_t* viewCountOutput, XrView* views) {
+    XrPosef head = getHeadPose(viewLocateInfo->displayTime);
+
+    viewState->viewStateFlags = XR_VIEW_STATE_ORIENTATION_VALID_BIT | XR_VIEW_STATE_POSITION_VALID_BIT |
+                                XR_VIEW_STATE_ORIENTATION_TRACKED_BIT | XR_VIEW_STATE_POSITION_TRACKED_BIT;
+    return enumerate(viewCapacityInput, viewCountOutput, views, 2, [&](XrView &view, uint32_t i) {
+        float eyeOffset = (i == 0 ? -0.5f : 0.5f) * runtime.settings.ipd;
+        XrVector3f offset = rotate(head.orientation, {eyeOffset, 0.0f, 0.0f});
+
+        view.pose.orientation = head.orientation;
+        view.pose.position = {head.position.x + offset.x, head.position.y + offset.y, head.position.z + offset.z};
+
+        float halfFov = runtime.settings.halfFov;
+        view.fov = {-halfFov, halfFov, halfFov, -halfFov};
+    });
+}
+
+// Swapchains
+
+XRAPI_ATTR XrResult XRAPI_CALL xrEnumerateSwapchainFormats(XrSession session, uint32_t formatCapacityInput, uint32_t* formatCountOutput, int64_t* formats) {
+    static const int64_t supportedFormats[] = {
+        GL_RGBA8, GL_SRGB8_ALPHA8, GL_DEPTH_COMPONENT32F, GL_DEPTH_COMPONENT24, GL_DEPTH_COMPONENT16
+    };
+    return enumerate(formatCapacityInput, formatCountOutput, formats, std::size(supportedFormats), [](int64_t &format, uint32_t i) {
+        format = supportedFormats[i];
+    });
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrCreateSwapchain(XrSession session, const XrSwapchainCreateInfo* createInfo, XrSwapchain* swapchain) {
+    if (createInfo->faceCount != 1 || createInfo->sampleCount > 1) {
+        return XR_ERROR_FEATURE_UNSUPPORTED;
+    }
+
+    auto* sc = new Swapchain();
+    sc->format = static_cast<GLenum>(createInfo->format);
+    sc->width = createInfo->width;
+    sc->height = createInfo->height;
+    sc->arraySize = createInfo->arraySize;
+    // Projection layers are rendered with multiview, which needs array textures
+    sc->target = (createInfo->arraySize > 1) ? GL_TEXTURE_2D_ARRAY : GL_TEXTURE_2D;
+    sc->images.resize(NUM_SWAPCHAIN_IMAGES);
+
+    GLint lastBinding = 0;
+    glGetIntegerv(sc->target == GL_TEXTURE_2D_ARRAY ? GL_TEXTURE_BINDING_2D_ARRAY : GL_TEXTURE_BINDING_2D, &lastBinding);
+
+    glGenTextures(NUM_SWAPCHAIN_IMAGES, sc->images.data());
+    for (GLuint image : sc->images) {
+        glBindTexture(sc->target, image);
+        if (sc->target == GL_TEXTURE_2D_ARRAY) {
+            glTexStorage3D(sc->target, createInfo->mipCount, static_cast<GLenum>(createInfo->format),
+                           createInfo->width, createInfo->height, createInfo->arraySize);
+        }
+        else {
+            glTexStorage2D(sc->target, createInfo->mipCount, static_cast<GLenum>(createInfo->format),
+                           createInfo->width, createInfo->height);
+        }
+    }
+    glBindTexture(sc->target, lastBinding);
+
+    if (glGetError() != GL_NO_ERROR) {
+        glDeleteTextures(NUM_SWAPCHAIN_IMAGES, sc->images.data());
+        delete sc;
+        return XR_ERROR_SWAPCHAIN_FORMAT_UNSUPPORTED;
+    }
+
+    *swapchain = toHandle<XrSwapchain>(sc);
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrDestroySwapchain(XrSwapchain swapchain) {
+    auto* sc = fromHandle<Swapchain>(swapchain);
+    glDeleteTextures(sc->images.size(), sc->images.data());
+    delete sc;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrEnumerateSwapchainImages(XrSwapchain swapchain, uint32_t imageCapacityInput, uint32_t* imageCountOutput, XrSwapchainImageBaseHeader* images) {
+    auto* sc = fromHandle<Swapchain>(swapchain);
+    auto* glesImages = reinterpret_cast<XrSwapchainImageOpenGLESKHR*>(images);
+    return enumerate(imageCapacityInput, imageCountOutput, glesImages, sc->images.size(), [&](XrSwapchainImageOpenGLESKHR &image, uint32_t i) {
+        image.image = sc->images[i];
+    });
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrAcquireSwapchainImage(XrSwapchain swapchain, const XrSwapchainImageAcquireInfo* acquireInfo, uint32_t* index) {
+    auto* sc = fromHandle<Swapchain>(swapchain);
+    *index = sc->nextImage;
+    sc->nextImage = (sc->nextImage + 1) % sc->images.size();
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrWaitSwapchainImage(XrSwapchain swapchain, const XrSwapchainImageWaitInfo* waitInfo) {
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrReleaseSwapchainImage(XrSwapchain swapchain, const XrSwapchainImageReleaseInfo* releaseInfo) {
+    return XR_SUCCESS;
+}
+
+// Spaces
+
+XRAPI_ATTR XrResult XRAPI_CALL xrCreateReferenceSpace(XrSession session, const XrReferenceSpaceCreateInfo* createInfo, XrSpace* space) {
+    *space = toHandle<XrSpace>(new Space{false, createInfo->poseInReferenceSpace});
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrCreateActionSpace(XrSession session, const XrActionSpaceCreateInfo* createInfo, XrSpace* space) {
+    *space = toHandle<XrSpace>(new Space{true, createInfo->poseInActionSpace});
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrDestroySpace(XrSpace space) {
+    delete fromHandle<Space>(space);
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrLocateSpace(XrSpace space, XrSpace baseSpace, XrTime time, XrSpaceLocation* location) {
+    // Controllers are never tracked
+    if (fromHandle<Space>(space)->isActionSpace) {
+        location->locationFlags = 0;
+        return XR_SUCCESS;
+    }
+    location->locationFlags = XR_SPACE_LOCATION_ORIENTATION_VALID_BIT | XR_SPACE_LOCATION_POSITION_VALID_BIT |
+                              XR_SPACE_LOCATION_ORIENTATION_TRACKED_BIT | XR_SPACE_LOCATION_POSITION_TRACKED_BIT;
+    location->pose = fromHandle<Space>(space)->poseInReferenceSpace;
+    return XR_SUCCESS;
+}
+
+// Actions
+
+XRAPI_ATTR XrResult XRAPI_CALL xrCreateActionSet(XrInstance instance, const XrActionSetCreateInfo* createInfo, XrActionSet* actionSet) {
+    *actionSet = toHandle<XrActionSet>(new int);
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrDestroyActionSet(XrActionSet actionSet) {
+    delete fromHandle<int>(actionSet);
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrCreateAction(XrActionSet actionSet, const XrActionCreateInfo* createInfo, XrAction* action) {
+    *action = toHandle<XrAction>(new int);
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrDestroyAction(XrAction action) {
+    delete fromHandle<int>(action);
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrSuggestInteractionProfileBindings(XrInstance instance, const XrInteractionProfileSuggestedBinding* suggestedBindings) {
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrAttachSessionActionSets(XrSession session, const XrSessionActionSetsAttachInfo* attachInfo) {
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrGetCurrentInteractionProfile(XrSession session, XrPath topLevelUserPath, XrInteractionProfileState* interactionProfile) {
+    interactionProfile->interactionProfile = XR_NULL_PATH;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrSyncActions(XrSession session, const XrActionsSyncInfo* syncInfo) {
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrGetActionStateBoolean(XrSession session, const XrActionStateGetInfo* getInfo, XrActionStateBoolean* state) {
+    state->currentState = XR_FALSE;
+    state->changedSinceLastSync = XR_FALSE;
+    state->lastChangeTime = 0;
+    state->isActive = XR_FALSE;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrGetActionStateVector2f(XrSession session, const XrActionStateGetInfo* getInfo, XrActionStateVector2f* state) {
+    state->currentState = {0.0f, 0.0f};
+    state->changedSinceLastSync = XR_FALSE;
+    state->lastChangeTime = 0;
+    state->isActive = XR_FALSE;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrGetActionStatePose(XrSession session, const XrActionStateGetInfo* getInfo, XrActionStatePose* state) {
+    state->isActive = XR_FALSE;
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrApplyHapticFeedback(XrSession session, const XrHapticActionInfo* hapticActionInfo, const XrHapticBaseHeader* hapticFeedback) {
+    return XR_SUCCESS;
+}
+
+// Extensions
+
+static XrResult XRAPI_CALL nullCreateDebugUtilsMessengerEXT(XrInstance instance, const XrDebugUtilsMessengerCreateInfoEXT* createInfo, XrDebugUtilsMessengerEXT* messenger) {
+    // The runtime never reports anything
+    *messenger = toHandle<XrDebugUtilsMessengerEXT>(new int);
+    return XR_SUCCESS;
+}
+
+static XrResult XRAPI_CALL nullDestroyDebugUtilsMessengerEXT(XrDebugUtilsMessengerEXT messenger) {
+    delete fromHandle<int>(messenger);
+    return XR_SUCCESS;
+}
+
+static XrResult XRAPI_CALL nullGetOpenGLESGraphicsRequirementsKHR(XrInstance instance, XrSystemId systemId, XrGraphicsRequirementsOpenGLESKHR* graphicsRequirements) {
+    graphicsRequirements->minApiVersionSupported = XR_MAKE_VERSION(3, 0, 0);
+    graphicsRequirements->maxApiVersionSupported = XR_MAKE_VERSION(3, 2, 0);
+    return XR_SUCCESS;
+}
+
+XRAPI_ATTR XrResult XRAPI_CALL xrGetInstanceProcAddr(XrInstance instance, const char* name, PFN_xrVoidFunction* function) {
+#define PROC(fn) { #fn, reinterpret_cast<PFN_xrVoidFunction>(fn) }
+    static const std::pair<const char*, PFN_xrVoidFunction> procs[] = {
+        PROC(xrEnumerateApiLayerProperties),
+        PROC(xrEnumerateInstanceExtensionProperties),
+        PROC(xrCreateInstance),
+        PROC(xrDestroyInstance),
+        PROC(xrGetInstanceProperties),
+        PROC(xrResultToString),
+        PROC(xrPollEvent),
+        PROC(xrStringToPath),
+        PROC(xrPathToString),
+        PROC(xrGetSystem),
+        PROC(xrGetSystemProperties),
+        PROC(xrEnumerateViewConfigurations),
+        PROC(xrEnumerateViewConfigurationViews),
+        PROC(xrEnumerateEnvironmentBlendModes),
+        PROC(xrCreateSession),
+        PROC(xrDestroySession),
+        PROC(xrBeginSession),
+        PROC(xrEndSession),
+        PROC(xrWaitFrame),
+        PROC(xrBeginFrame),
+        PROC(xrEndFrame),
+        PROC(xrLocateViews),
+        PROC(xrEnumerateSwapchainFormats),
+        PROC(xrCreateSwapchain),
+        PROC(xrDestroySwapchain),
+        PROC(xrEnumerateSwapchainImages),
+        PROC(xrAcquireSwapchainImage),
+        PROC(xrWaitSwapchainImage),
+        PROC(xrReleaseSwapchainImage),
+        PROC(xrCreateReferenceSpace),
+        PROC(xrCreateActionSpace),
+        PROC(xrDestroySpace),
+        PROC(xrLocateSpace),
+        PROC(xrCreateActionSet),
+        PROC(xrDestroyActionSet),
+        PROC(xrCreateAction),
+        PROC(xrDestroyAction),
+        PROC(xrSuggestInteractionProfileBindings),
+        PROC(xrAttachSessionActionSets),
+        PROC(xrGetCurrentInteractionProfile),
+        PROC(xrSyncActions),
+        PROC(xrGetActionStateBoolean),
+        PROC(xrGetActionStateVector2f),
+        PROC(xrGetActionStatePose),
+        PROC(xrApplyHapticFeedback),
+        PROC(xrGetInstanceProcAddr),
+        { "xrCreateDebugUtilsMessengerEXT", reinterpret_cast<PFN_xrVoidFunction>(nullCreateDebugUtilsMessengerEXT) },
+        { "xrDestroyDebugUtilsMessengerEXT", reinterpret_cast<PFN_xrVoidFunction>(nullDestroyDebugUtilsMessengerEXT) },
+        { "xrGetOpenGLESGraphicsRequirementsKHR", reinterpret_cast<PFN_xrVoidFunction>(nullGetOpenGLESGraphicsRequirementsKHR) },
+    };
+#undef PROC
+
+    for (const auto &[procName, proc] : procs) {
+        if (std::strcmp(procName, name) == 0) {
+            *function = proc;
+            return XR_SUCCESS;
+        }
+    }
+    // Includes xrInitializeLoaderKHR, which only the Android loader needs
+    *function = nullptr;
+    return XR_ERROR_FUNCTION_UNSUPPORTED;
+}
@@ -0,0 +1,19 @@
+#ifndef TEST_CHECK_H
+#define TEST_CHECK_H
+
+#include <spdlog/spdlog.h>
+
+// Minimal checks for the host tests: a failed CHECK logs and is counted, and main returns TEST_RESULT()
+inline int testFailures = 0;
+
+#define CHECK(condition) \
+    do { \
+        if (!(condition)) { \
+            spdlog::error("{}:{}: CHECK({}) failed", __FILE__, __LINE__, #condition); \
+            testFailures++; \
+        } \
+    } while (0)
+
+#define TEST_RESULT() (testFailures == 0 ? 0 : 1)
+
+#endif // TEST_CHECK_H
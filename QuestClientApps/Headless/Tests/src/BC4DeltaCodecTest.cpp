@@ -0,0 +1,116 @@
+#include <cstring>
+#include <random>
+
+#include <Codecs/BC4DeltaCodec.h>
+
+#include <TestCheck.h>
+
+using namespace quasar;
+
+namespace {
+
+constexpr size_t frameSize = (256 / 8) * (128 / 8) * 8; // 256x128 depth, 8 byte BC4 blocks
+
+// Changes a few blocks per frame, like a depth stream under small head motion
+void perturb(std::vector<uint8_t> &frame, std::mt19937 &rng) {
+    std::uniform_int_distribution<size_t> block(0, frame.size() / 8 - 1);
+    for (int i = 0; i < 16; i++) {
+        size_t offset = block(rng) * 8;
+        for (size_t j = 0; j < 8; j++) {
+            frame[offset + j] = static_cast<uint8_t>(rng());
+        }
+    }
+}
+
+void testRoundTrip() {
+    std::mt19937 rng(1);
+    std::vector<uint8_t> frame(frameSize);
+    for (auto &byte : frame) {
+        byte = static_cast<uint8_t>(rng());
+    }
+
+    BC4DeltaEncoder encoder(8);
+    BC4DeltaDecoder decoder(frameSize);
+    std::vector<char> packet;
+    std::vector<uint8_t> decoded;
+
+    for (int i = 0; i < 20; i++) {
+        CHECK(encoder.encode(frame.data(), frame.size(), 100 + i, packet) > 0);
+
+        int64_t poseID = -1;
+        CHECK(decoder.decode(packet.data(), packet.size(), decoded, &poseID) == BC4DeltaDecoder::Result::OK);
+        CHECK(poseID == 100 + i);
+        CHECK(decoded == frame);
+
+        perturb(frame, rng);
+    }
+
+    // key frames at 0, 8 and 16
+    CHECK(encoder.stats.keyFrames == 3);
+    CHECK(decoder.stats.keyFrames == 3);
+    CHECK(decoder.stats.framesCoded == 20);
+}
+
+void testResumesAtKeyFrame() {
+    std::mt19937 rng(2);
+    std::vector<uint8_t> frame(frameSize, 0);
+
+    BC4DeltaEncoder encoder(4);
+    BC4DeltaDecoder decoder(frameSize);
+    std::vector<std::vector<char>> packets(8);
+    std::vector<std::vector<uint8_t>> frames;
+    for (auto &packet : packets) {
+        encoder.encode(frame.data(), frame.size(), -1, packet);
+        frames.push_back(frame);
+        perturb(frame, rng);
+    }
+
+    std::vector<uint8_t> decoded;
+    CHECK(decoder.decode(packets[0].data(), packets[0].size(), decoded) == BC4DeltaDecoder::Result::OK);
+    // packet 1 lost: deltas are skipped until the key frame at 4
+    CHECK(decoder.decode(packets[2].data(), packets[2].size(), decoded) == BC4DeltaDecoder::Result::WAITING_FOR_KEY_FRAME);
+    CHECK(decoder.decode(packets[3].data(), packets[3].size(), decoded) == BC4DeltaDecoder::Result::WAITING_FOR_KEY_FRAME);
+    for (size_t i = 4; i < packets.size(); i++) {
+        CHECK(decoder.decode(packets[i].data(), packets[i].size(), decoded) == BC4DeltaDecoder::Result::OK);
+        CHECK(decoded == frames[i]);
+    }
+}
+
+void testRejectsBadPackets() {
+    std::vector<uint8_t> frame(frameSize, 7);
+    BC4DeltaEncoder encoder;
+    std::vector<char> packet;
+    encoder.encode(frame.data(), frame.size(), -1, packet);
+
+    std::vector<uint8_t> decoded;
+
+    // another resolution than the receiver expects
+    BC4DeltaDecoder smallDecoder(frameSize / 2);
+    CHECK(smallDecoder.decode(packet.data(), packet.size(), decoded) == BC4DeltaDecoder::Result::CORRUPT);
+
+    BC4DeltaDecoder decoder(frameSize);
+
+    // truncated payload
+    CHECK(decoder.decode(packet.data(), packet.size() - 1, decoded) == BC4DeltaDecoder::Result::CORRUPT);
+    CHECK(decoder.decode(packet.data(), sizeof(BC4DeltaFrameHeader) - 1, decoded) == BC4DeltaDecoder::Result::CORRUPT);
+
+    // announced size that would need a huge allocation
+    std::vector<char> oversized = packet;
+    BC4DeltaFrameHeader header;
+    std::memcpy(&header, oversized.data(), sizeof(header));
+    header.frameSize = 0xFFFFFFF0u;
+    std::memcpy(oversized.data(), &header, sizeof(header));
+    CHECK(decoder.decode(oversized.data(), oversized.size(), decoded) == BC4DeltaDecoder::Result::CORRUPT);
+
+    CHECK(decoder.decode(packet.data(), packet.size(), decoded) == BC4DeltaDecoder::Result::OK);
+    CHECK(decoded == frame);
+}
+
+} // namespace
+
+int main() {
+    testRoundTrip();
+    testResumesAtKeyFrame();
+    testRejectsBadPackets();
+    return TEST_RESULT();
+}
@@ -0,0 +1,102 @@
+#include <cstdint>
+#include <thread>
+
+#include <FrameArena.h>
+#include <FrameTiming.h>
+#include <AllocationTracker.h>
+
+#include <TestCheck.h>
+
+using namespace quasar;
+
+namespace {
+
+struct Temporary {
+    float values[16];
+};
+
+// What the frame loop does with the arena and timing on every frame, with allocations as large as a frame's
+void runFrame(FrameArena &arena, FrameTiming &timing, int64_t displayTime, size_t frameBytes) {
+    timing.beginWait();
+    timing.beginWork(displayTime, 13'888'889);
+    for (size_t bytes = 0; bytes < frameBytes; bytes += sizeof(Temporary)) {
+        Temporary* temporary = arena.allocate<Temporary>(1);
+        temporary->values[0] = static_cast<float>(bytes);
+    }
+    timing.beginSubmit();
+    timing.endFrame(true);
+    arena.reset();
+}
+
+void testArenaGrowsToHighWater() {
+    FrameArena arena(1024);
+    FrameTiming timing;
+
+    // The first frames overflow the block, then reset grows it
+    runFrame(arena, timing, 1, 16 * 1024);
+    CHECK(arena.getStats().overflows > 0);
+    CHECK(arena.getStats().capacity >= 16 * 1024);
+
+    uint64_t overflows = arena.getStats().overflows;
+    for (int64_t frame = 2; frame < 100; frame++) {
+        runFrame(arena, timing, frame * 13'888'889, 16 * 1024);
+    }
+    CHECK(arena.getStats().overflows == overflows);
+}
+
+void testSteadyStateFramesDontAllocate() {
+    FrameArena arena(1024);
+    FrameTiming timing;
+    runFrame(arena, timing, 1, 16 * 1024);
+
+    AllocationTracker::Counts start = AllocationTracker::getThreadCounts();
+    for (int64_t frame = 2; frame < 100; frame++) {
+        runFrame(arena, timing, frame * 13'888'889, 16 * 1024);
+    }
+    AllocationTracker::Counts end = AllocationTracker::getThreadCounts();
+    CHECK(end.allocations == start.allocations);
+    CHECK(end.bytes == start.bytes);
+}
+
+// Through a volatile pointer, so the compiler can't elide the allocation
+uint64_t* volatile allocated = nullptr;
+
+void testTrackerCountsPerThread() {
+    AllocationTracker::Counts before = AllocationTracker::getThreadCounts();
+    allocated = new uint64_t(1);
+    AllocationTracker::Counts after = AllocationTracker::getThreadCounts();
+    delete allocated;
+    CHECK(after.allocations == before.allocations + 1);
+    CHECK(after.bytes == before.bytes + sizeof(uint64_t));
+
+    // The network and decoder threads' allocations don't show up in the frame thread's counts
+    uint64_t workerAllocations = 0;
+    std::thread worker([&workerAllocations]() {
+        AllocationTracker::Counts start = AllocationTracker::getThreadCounts();
+        uint64_t* volatile first = new uint64_t(2);
+        uint64_t* volatile second = new uint64_t(3);
+        delete first;
+        delete second;
+        workerAllocations = AllocationTracker::getThreadCounts().allocations - start.allocations;
+    });
+    worker.join();
+    CHECK(workerAllocations == 2);
+    CHECK(AllocationTracker::getTotalCounts().allocations >= after.allocations + workerAllocations);
+}
+
+} // namespace
+
+int main() {
+    testArenaGrowsToHighWater();
+
+    // Without QUEST_CLIENT_TRACK_ALLOCATIONS every count is 0 and there is nothing to check
+    if (AllocationTracker::isEnabled()) {
+        testSteadyStateFramesDontAllocate();
+        testTrackerCountsPerThread();
+    }
+    else {
+        spdlog::warn("Allocation tracking is off, configure with -DQUEST_CLIENT_TRACK_ALLOCATIONS=ON to check allocations");
+    }
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,124 @@
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <PosePredictor.h>
+
+#include <TestCheck.h>
+
+using namespace quasar;
+
+namespace {
+
+constexpr double frameTime = 1.0 / 90.0;
+constexpr float eyeOffset = 0.032f;
+
+// Places the eyes of cameras either side of a head at position with the given orientation
+void setHead(VRCamera &cameras, const glm::vec3 &position, const glm::quat &orientation) {
+    glm::mat4 worldFromHead = glm::translate(glm::mat4(1.0f), position) * glm::mat4_cast(orientation);
+    glm::mat4 worldFromLeft = worldFromHead * glm::translate(glm::mat4(1.0f), glm::vec3(-eyeOffset, 0.0f, 0.0f));
+    glm::mat4 worldFromRight = worldFromHead * glm::translate(glm::mat4(1.0f), glm::vec3(eyeOffset, 0.0f, 0.0f));
+    cameras.setViewMatrices({
+        glm::inverse(worldFromLeft),
+        glm::inverse(worldFromRight)
+    });
+}
+
+glm::vec3 getEyePosition(const PerspectiveCamera &eye) {
+    return glm::vec3(glm::inverse(eye.getViewMatrix())[3]);
+}
+
+glm::quat getEyeOrientation(const PerspectiveCamera &eye) {
+    return glm::normalize(glm::quat_cast(glm::mat3(glm::inverse(eye.getViewMatrix()))));
+}
+
+float degreesBetween(const glm::quat &a, const glm::quat &b) {
+    return glm::degrees(2.0f * glm::acos(glm::min(glm::abs(glm::dot(a, b)), 1.0f)));
+}
+
+// Moving at a constant velocity, the prediction is the current pose moved by velocity * latency
+void testLinearExtrapolation() {
+    PosePredictor predictor;
+    VRCamera cameras, predictedCameras;
+    const glm::vec3 velocity(1.0f, 0.0f, -0.5f);
+
+    for (int frame = 0; frame < 90; frame++) {
+        double now = frame * frameTime;
+        setHead(cameras, velocity * static_cast<float>(now), glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+        predictor.update(now, cameras);
+        predictor.addLatencySample(50.0);
+        predictor.predict(cameras, predictedCameras);
+    }
+
+    glm::vec3 expectedOffset = velocity * 0.05f;
+    CHECK(glm::length(getEyePosition(predictedCameras.left) - getEyePosition(cameras.left) - expectedOffset) < 1e-3f);
+    CHECK(glm::length(getEyePosition(predictedCameras.right) - getEyePosition(cameras.right) - expectedOffset) < 1e-3f);
+    CHECK(degreesBetween(getEyeOrientation(predictedCameras.left), getEyeOrientation(cameras.left)) < 0.01f);
+
+    // Predictions are scored up to a frame after their target time, so they aren't exact, but are much closer
+    // than the pose they were predicted from
+    CHECK(predictor.stats.numSamples > 0);
+    CHECK(predictor.stats.positionErrorMm < 0.25 * predictor.stats.unpredictedPositionErrorMm);
+}
+
+// Turning at a constant rate, both eyes rotate rigidly about the head by rate * latency
+void testAngularExtrapolation() {
+    PosePredictor predictor;
+    VRCamera cameras, predictedCameras;
+    const float degreesPerSecond = 90.0f;
+    const glm::vec3 up(0.0f, 1.0f, 0.0f);
+    const glm::vec3 headPosition(0.5f, 1.6f, 2.0f);
+
+    for (int frame = 0; frame < 90; frame++) {
+        double now = frame * frameTime;
+        glm::quat orientation = glm::angleAxis(glm::radians(degreesPerSecond * static_cast<float>(now)), up);
+        setHead(cameras, headPosition, orientation);
+        predictor.update(now, cameras);
+        predictor.addLatencySample(50.0);
+        predictor.predict(cameras, predictedCameras);
+    }
+
+    glm::quat expectedDelta = glm::angleAxis(glm::radians(degreesPerSecond * 0.05f), up);
+    glm::quat expectedOrientation = expectedDelta * getEyeOrientation(cameras.left);
+    CHECK(degreesBetween(getEyeOrientation(predictedCameras.left), expectedOrientation) < 0.1f);
+    CHECK(degreesBetween(getEyeOrientation(predictedCameras.right), expectedOrientation) < 0.1f);
+
+    // The eyes keep their distance and stay centered on the head
+    glm::vec3 left = getEyePosition(predictedCameras.left);
+    glm::vec3 right = getEyePosition(predictedCameras.right);
+    CHECK(glm::abs(glm::length(right - left) - 2.0f * eyeOffset) < 1e-4f);
+    CHECK(glm::length(0.5f * (left + right) - headPosition) < 1e-3f);
+    CHECK(glm::length((right - left) - expectedDelta * (getEyePosition(cameras.right) - getEyePosition(cameras.left))) < 1e-3f);
+
+    CHECK(predictor.stats.rotationErrorDeg < 0.25 * predictor.stats.unpredictedRotationErrorDeg);
+}
+
+// The horizon is the smoothed latency, capped at maxHorizonMs, and nothing is extrapolated before any latency is known
+void testHorizon() {
+    PosePredictor predictor({ .maxHorizonMs = 20.0 });
+    VRCamera cameras, predictedCameras;
+    const glm::vec3 velocity(0.0f, 0.0f, 2.0f);
+
+    for (int frame = 0; frame < 10; frame++) {
+        double now = frame * frameTime;
+        setHead(cameras, velocity * static_cast<float>(now), glm::quat(1.0f, 0.0f, 0.0f, 0.0f));
+        predictor.update(now, cameras);
+    }
+    predictor.predict(cameras, predictedCameras);
+    CHECK(glm::length(getEyePosition(predictedCameras.left) - getEyePosition(cameras.left)) < 1e-5f);
+
+    predictor.addLatencySample(200.0);
+    predictor.predict(cameras, predictedCameras);
+    glm::vec3 expectedOffset = velocity * 0.02f;
+    CHECK(glm::length(getEyePosition(predictedCameras.left) - getEyePosition(cameras.left) - expectedOffset) < 1e-3f);
+}
+
+} // namespace
+
+int main() {
+    testLinearExtrapolation();
+    testAngularExtrapolation();
+    testHorizon();
+
+    return TEST_RESULT();
+}
@@ -0,0 +1,172 @@
+#include <vector>
+
+#include <QualityGovernor.h>
+#include <QualityRequest.h>
+
+#include <TestCheck.h>
+
+using namespace quasar;
+
+namespace {
+
+constexpr double frameBudgetMs = 1000.0 / 72.0;
+constexpr float fullFrameRate = 72.0f;
+
+// What a server does with the requests: applies the newest one and ignores anything else
+struct StandInServer {
+    uint32_t sequence = 0;
+    uint32_t level = 0;
+    float frameRate = fullFrameRate;
+
+    bool receive(const std::vector<char> &data) {
+        QualityRequest request;
+        if (!request.deserialize(data) || request.sequence <= sequence) {
+            return false;
+        }
+        sequence = request.sequence;
+        level = request.level;
+        if (request.frameRate > 0.0f) {
+            frameRate = request.frameRate;
+        }
+        return true;
+    }
+};
+
+// The client side: feeds the governor and, like MeshWarpClient::updateQuality, requests the new level's frame rate
+struct Client {
+    QualityGovernor governor;
+    uint32_t sequence = 0;
+    std::vector<char> data;
+
+    Client(const QualityGovernor::Params &params) : governor(params) {}
+
+    // Runs frames with the given times, delivering any requests to the server. Returns the number of requests.
+    uint32_t runFrames(uint32_t frames, const QualityGovernor::Sample &sample, StandInServer &server) {
+        uint32_t requests = 0;
+        for (uint32_t i = 0; i < frames; i++) {
+            if (!governor.update(sample, frameBudgetMs)) {
+                continue;
+            }
+            QualityRequest request;
+            request.sequence = ++sequence;
+            request.level = governor.getLevel();
+            request.frameRate = fullFrameRate / static_cast<float>(1 + governor.getLevel());
+            request.serialize(data);
+            server.receive(data);
+            requests++;
+        }
+        return requests;
+    }
+};
+
+QualityGovernor::Sample makeSample(double cpuTimeMs, double gpuTimeMs) {
+    QualityGovernor::Sample sample;
+    sample.cpuTimeMs = cpuTimeMs;
+    sample.gpuTimeMs = gpuTimeMs;
+    return sample;
+}
+
+// Over budget, the level steps down once per cooldown; with headroom it steps back up, much more slowly
+void testStepsWithHysteresis() {
+    QualityGovernor::Params params;
+    Client client(params);
+    StandInServer server;
+
+    QualityGovernor::Sample overBudget = makeSample(frameBudgetMs * 1.2, frameBudgetMs * 0.5);
+    CHECK(client.runFrames(params.cooldownFrames - 1, overBudget, server) == 0);
+    CHECK(client.runFrames(1, overBudget, server) == 1);
+    CHECK(server.level == 1);
+    CHECK(server.frameRate < fullFrameRate);
+
+    CHECK(client.runFrames(params.cooldownFrames, overBudget, server) == 1);
+    CHECK(server.level == 2);
+    CHECK(client.governor.stats.stepDowns == 2);
+
+    // Between the thresholds the level holds
+    QualityGovernor::Sample inBudget = makeSample(frameBudgetMs * 0.8, frameBudgetMs * 0.5);
+    CHECK(client.runFrames(4 * params.stepUpFrames, inBudget, server) == 0);
+    CHECK(server.level == 2);
+
+    // The smoothed time takes a while to fall under the threshold, then a full run of headroom is needed
+    QualityGovernor::Sample headroom = makeSample(frameBudgetMs * 0.3, frameBudgetMs * 0.3);
+    CHECK(client.runFrames(params.stepUpFrames, headroom, server) == 0);
+    CHECK(client.runFrames(params.stepUpFrames, headroom, server) == 1);
+    CHECK(server.level == 1);
+    CHECK(client.runFrames(params.stepUpFrames, headroom, server) == 1);
+    CHECK(server.level == 0);
+    CHECK(server.frameRate == fullFrameRate);
+
+    // Never above full quality
+    CHECK(client.runFrames(params.stepUpFrames, headroom, server) == 0);
+    CHECK(client.governor.getLevel() == 0);
+}
+
+// Repeated missed frames step down without waiting for the smoothed times
+void testMissedFrames() {
+    QualityGovernor::Params params;
+    Client client(params);
+    StandInServer server;
+
+    QualityGovernor::Sample inBudget = makeSample(frameBudgetMs * 0.5, frameBudgetMs * 0.5);
+    client.runFrames(params.cooldownFrames, inBudget, server);
+    CHECK(server.level == 0);
+
+    QualityGovernor::Sample missed = inBudget;
+    missed.missedFrames = 1;
+    CHECK(client.runFrames(params.maxMissedFrames, missed, server) == 1);
+    CHECK(server.level == 1);
+    CHECK(client.governor.stats.missedFrames == params.maxMissedFrames);
+}
+
+// Frames without a new GPU result don't pull the smoothed GPU time toward 0
+void testMissingGPUResults() {
+    QualityGovernor::Params params;
+    Client client(params);
+    StandInServer server;
+
+    QualityGovernor::Sample gpuBound = makeSample(frameBudgetMs * 0.3, frameBudgetMs * 1.2);
+    QualityGovernor::Sample noGPUResult = makeSample(frameBudgetMs * 0.3, -1.0);
+    for (uint32_t i = 0; i < params.cooldownFrames; i++) {
+        client.runFrames(1, (i % 3 == 0) ? gpuBound : noGPUResult, server);
+    }
+    CHECK(client.governor.stats.smoothedGPUTimeMs > frameBudgetMs);
+    CHECK(server.level == 1);
+}
+
+// The server applies only the newest request, and ignores anything that isn't one
+void testStandInServer() {
+    StandInServer server;
+    std::vector<char> data;
+
+    QualityRequest newer;
+    newer.sequence = 2;
+    newer.level = 3;
+    newer.frameRate = 36.0f;
+    newer.serialize(data);
+    CHECK(server.receive(data));
+
+    QualityRequest older;
+    older.sequence = 1;
+    older.level = 1;
+    older.serialize(data);
+    CHECK(!server.receive(data));
+    CHECK(server.level == 3);
+    CHECK(server.frameRate == 36.0f);
+
+    data.assign(sizeof(QualityRequest), 0);
+    CHECK(!server.receive(data));
+    data.resize(sizeof(QualityRequest) - 1);
+    CHECK(!server.receive(data));
+    CHECK(server.sequence == 2);
+}
+
+} // namespace
+
+int main() {
+    testStepsWithHysteresis();
+    testMissedFrames();
+    testMissingGPUResults();
+    testStandInServer();
+
+    return TEST_RESULT();
+}
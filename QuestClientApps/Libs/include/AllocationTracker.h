@@ -0,0 +1,31 @@
+#ifndef ALLOCATION_TRACKER_H
+#define ALLOCATION_TRACKER_H
+
+#include <cstdint>
+
+namespace quasar {
+
+// Counts heap allocations made through operator new. Only enabled when configured with
+// QUEST_CLIENT_TRACK_ALLOCATIONS, where it replaces the global operator new/delete of whatever links the
+// client library; otherwise every count is 0.
+//
+// Counts are kept per thread, so the frame loop can measure its own allocations without
+// picking up the network and decoder threads.
+class AllocationTracker {
+public:
+    struct Counts {
+        uint64_t allocations = 0;
+        uint64_t bytes = 0;
+    };
+
+    static bool isEnabled();
+
+    // Allocations made by the calling thread since it started
+    static Counts getThreadCounts();
+    // Allocations made by every thread
+    static Counts getTotalCounts();
+};
+
+} // namespace quasar
+
+#endif // ALLOCATION_TRACKER_H
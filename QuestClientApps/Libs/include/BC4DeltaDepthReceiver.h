@@ -0,0 +1,99 @@
+#ifndef BC4_DELTA_DEPTH_RECEIVER_H
+#define BC4_DELTA_DEPTH_RECEIVER_H
+
+#include <deque>
+#include <memory>
+#include <mutex>
+
+#include <Buffer.h>
+#include <DataReceiverTCP.h>
+#include <BC4DepthVideoTexture.h>
+#include <PoseStreamer.h>
+
+#include <JobSystem.h>
+#include <StreamRecorder.h>
+
+#include <Codecs/BC4DeltaCodec.h>
+
+namespace quasar {
+
+// Receives BC4 depth frames coded with BC4DeltaEncoder, decodes them on the job system and
+// uploads the decoded blocks into bc4CompressedBuffer on draw(). Drop-in replacement for the
+// buffer side of BC4DepthVideoTexture when the server streams with the temporal depth codec.
+//
+// Without a streamer URL nothing is received from the network and packets are only handed in with
+// receive(), which is how StreamReplayer plays a recorded depth stream back.
+class BC4DeltaDepthReceiver {
+public:
+    uint width, height;
+    Buffer bc4CompressedBuffer;
+
+    struct Stats {
+        uint64_t framesReceived = 0;
+        uint64_t framesDecoded = 0;
+        uint64_t framesDropped = 0;
+        double compressionRatio = 0.0;
+        double timeToDecodeMs = 0.0;
+    };
+
+    // Packets received from the network are also written to recorder (as DEPTH_PACKETS), if there is one
+    BC4DeltaDepthReceiver(const glm::uvec2 &size, const std::string &streamerURL, JobSystem &jobSystem,
+                          StreamRecorder* recorder = nullptr);
+    ~BC4DeltaDepthReceiver();
+
+    // Queues one coded packet for decoding. Thread safe.
+    void receive(const std::vector<char> &data);
+
+    // Uploads the decoded frame matching poseID (or the newest one if there is no match) into
+    // bc4CompressedBuffer and returns its pose id. Returns the previously uploaded id if nothing new arrived.
+    pose_id_t draw(pose_id_t poseID = -1);
+
+    Stats getStats();
+
+private:
+    static constexpr size_t maxQueuedPackets = 4;
+    static constexpr size_t maxDecodedFrames = 4;
+
+    struct DecodedFrame {
+        pose_id_t poseID;
+        std::vector<uint8_t> blocks;
+    };
+
+    class Connection : public DataReceiverTCP {
+    public:
+        Connection(const std::string &streamerURL, BC4DeltaDepthReceiver &owner)
+                : DataReceiverTCP(streamerURL), owner(owner) {}
+
+    private:
+        BC4DeltaDepthReceiver &owner;
+
+        void onDataReceived(const std::vector<char> &data) override;
+    };
+
+    size_t frameSize;
+    pose_id_t lastPoseID = -1;
+
+    std::unique_ptr<Connection> connection;
+    StreamRecorder* recorder = nullptr;
+
+    BC4DeltaDecoder decoder;
+    Stats stats;
+
+    std::mutex mutex;
+    std::deque<std::vector<char>> packets;
+    std::deque<DecodedFrame> decodedFrames;
+    std::vector<std::vector<uint8_t>> freeFrames;
+
+    // Delta frames have to be decoded in order, so at most one decode job runs at a time and
+    // it drains the packet queue before finishing
+    JobSystem &jobSystem;
+    JobSystem::JobHandle decodeJob;
+    bool decodeScheduled = false;
+    bool running = true;
+
+    void decodePackets();
+};
+
+} // namespace quasar
+
+#endif // BC4_DELTA_DEPTH_RECEIVER_H
@@ -0,0 +1,28 @@
+#ifndef CLIENT_SHADERS_H
+#define CLIENT_SHADERS_H
+
+// Shaders owned by the client (QUASAR's own shaders come from shaders_common.h).
+// Sources omit the #version line, extensions and defines, which are added when the shader is compiled.
+
+extern const char SHADER_CLIENT_TILE_BOUNDS_COMP[];
+extern const unsigned int SHADER_CLIENT_TILE_BOUNDS_COMP_len;
+
+extern const char SHADER_CLIENT_TILE_CULL_COMP[];
+extern const unsigned int SHADER_CLIENT_TILE_CULL_COMP_len;
+
+extern const char SHADER_CLIENT_ATW_MULTIVIEW_VERT[];
+extern const unsigned int SHADER_CLIENT_ATW_MULTIVIEW_VERT_len;
+
+extern const char SHADER_CLIENT_ATW_MULTIVIEW_FRAG[];
+extern const unsigned int SHADER_CLIENT_ATW_MULTIVIEW_FRAG_len;
+
+extern const char SHADER_CLIENT_PACK_VERTICES_COMP[];
+extern const unsigned int SHADER_CLIENT_PACK_VERTICES_COMP_len;
+
+extern const char SHADER_CLIENT_SHADOW_COMPOSITE_VERT[];
+extern const unsigned int SHADER_CLIENT_SHADOW_COMPOSITE_VERT_len;
+
+extern const char SHADER_CLIENT_SHADOW_COMPOSITE_FRAG[];
+extern const unsigned int SHADER_CLIENT_SHADOW_COMPOSITE_FRAG_len;
+
+#endif // CLIENT_SHADERS_H
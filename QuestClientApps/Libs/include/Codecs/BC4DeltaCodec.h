@@ -0,0 +1,109 @@
+#ifndef BC4_DELTA_CODEC_H
+#define BC4_DELTA_CODEC_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+struct ZSTD_CCtx_s;
+struct ZSTD_DCtx_s;
+
+namespace quasar {
+
+// Lossless temporal codec for BC4 compressed depth frames.
+//
+// Key frames carry the zstd compressed BC4 blocks as-is. Delta frames carry the zstd compressed XOR of the
+// current blocks against the previous frame, which is mostly zeros under small head motion.
+// This header has no GL dependencies so the encoder and decoder can be built and run on a host machine.
+
+enum class BC4FrameType : uint8_t {
+    KEY_FRAME = 0,
+    DELTA_FRAME = 1
+};
+
+#pragma pack(push, 1)
+struct BC4DeltaFrameHeader {
+    static constexpr uint32_t MAGIC = 0x31443442; // "B4D1"
+
+    uint32_t magic = MAGIC;
+    BC4FrameType frameType = BC4FrameType::KEY_FRAME;
+    uint8_t reserved[3] = {0, 0, 0};
+    uint32_t frameIndex = 0;
+    uint32_t frameSize = 0;       // size of the decoded BC4 frame in bytes
+    uint32_t compressedSize = 0;  // size of the payload following this header
+    int64_t poseID = -1;
+};
+#pragma pack(pop)
+
+struct BC4DeltaCodecStats {
+    uint64_t framesCoded = 0;
+    uint64_t keyFrames = 0;
+    uint64_t rawBytes = 0;
+    uint64_t codedBytes = 0;
+    double lastTimeMs = 0.0;
+
+    double compressionRatio() const { return codedBytes > 0 ? static_cast<double>(rawBytes) / codedBytes : 0.0; }
+};
+
+class BC4DeltaEncoder {
+public:
+    BC4DeltaCodecStats stats;
+
+    BC4DeltaEncoder(uint32_t keyFrameInterval = 60, int compressionLevel = 3);
+    ~BC4DeltaEncoder();
+
+    BC4DeltaEncoder(const BC4DeltaEncoder&) = delete;
+    BC4DeltaEncoder& operator=(const BC4DeltaEncoder&) = delete;
+
+    // Encodes one BC4 frame into a packet (header + payload). Returns the packet size in bytes.
+    size_t encode(const void* frame, size_t frameSize, int64_t poseID, std::vector<char> &packet);
+
+    // Makes the next encoded frame a key frame (e.g. when a new receiver connects).
+    void forceKeyFrame() { keyFramePending = true; }
+
+private:
+    uint32_t keyFrameInterval;
+    int compressionLevel;
+    bool keyFramePending = true;
+    uint32_t frameIndex = 0;
+
+    ZSTD_CCtx_s* cctx = nullptr;
+    std::vector<uint8_t> reference;
+    std::vector<uint8_t> residual;
+};
+
+class BC4DeltaDecoder {
+public:
+    enum class Result {
+        OK,
+        WAITING_FOR_KEY_FRAME,
+        CORRUPT
+    };
+
+    BC4DeltaCodecStats stats;
+
+    // Packets whose header announces a different decoded size are rejected as corrupt before anything is
+    // allocated. 0 accepts any size.
+    explicit BC4DeltaDecoder(size_t expectedFrameSize = 0);
+    ~BC4DeltaDecoder();
+
+    BC4DeltaDecoder(const BC4DeltaDecoder&) = delete;
+    BC4DeltaDecoder& operator=(const BC4DeltaDecoder&) = delete;
+
+    // Decodes a packet produced by BC4DeltaEncoder into frame. Delta frames are only accepted
+    // if they directly follow the last decoded frame; otherwise decoding resumes at the next key frame.
+    Result decode(const char* packet, size_t packetSize, std::vector<uint8_t> &frame, int64_t* poseID = nullptr);
+
+    void reset() { hasReference = false; }
+
+private:
+    size_t expectedFrameSize;
+    ZSTD_DCtx_s* dctx = nullptr;
+    bool hasReference = false;
+    uint32_t lastFrameIndex = 0;
+    std::vector<uint8_t> reference;
+};
+
+} // namespace quasar
+
+#endif // BC4_DELTA_CODEC_H
@@ -0,0 +1,49 @@
+#ifndef DYNAMIC_RESOLUTION_H
+#define DYNAMIC_RESOLUTION_H
+
+#include <cstdint>
+
+namespace quasar {
+
+// Picks a render scale (relative to the runtime's recommended resolution) from measured GPU frame times.
+// Scales down quickly when over budget and back up slowly when there is headroom, with a cooldown
+// between changes so the resolution doesn't oscillate.
+class DynamicResolution {
+public:
+    struct Params {
+        float minScale = 0.6f;
+        // Above 1.0 supersamples: the swapchain is allocated at maxScale^2 times the recommended pixels
+        float maxScale = 1.0f;
+        float scaleStep = 0.05f;
+        // Fractions of the frame budget
+        float scaleDownThreshold = 0.9f;
+        float scaleUpThreshold = 0.7f;
+        // Frames to wait after a change before changing again
+        uint32_t cooldownFrames = 30;
+        // Weight of the newest sample in the smoothed GPU time
+        float smoothing = 0.1f;
+    } params;
+
+    struct Stats {
+        double smoothedGPUTimeMs = 0.0;
+        uint64_t scaleDowns = 0;
+        uint64_t scaleUps = 0;
+    } stats;
+
+    DynamicResolution() = default;
+    DynamicResolution(const Params &params) : params(params), scale(params.maxScale) {}
+
+    float getScale() const { return scale; }
+
+    // Feeds one GPU frame time measurement. Returns true if the scale changed.
+    bool update(double gpuTimeMs, double frameBudgetMs);
+
+private:
+    float scale = 1.0f;
+    uint32_t framesSinceChange = 0;
+    bool hasSample = false;
+};
+
+} // namespace quasar
+
+#endif // DYNAMIC_RESOLUTION_H
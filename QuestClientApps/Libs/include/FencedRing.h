@@ -0,0 +1,123 @@
+#ifndef FENCED_RING_H
+#define FENCED_RING_H
+
+#include <array>
+
+#include <GraphicsAPI.h>
+
+namespace quasar {
+
+// A small ring of N resource sets (e.g. mesh buffers), each guarded by a GL fence.
+// acquire() hands out a set the GPU has finished reading from, so work writing into one
+// set can overlap draws that are still reading from another.
+template <typename T, size_t N>
+class FencedRing {
+public:
+    struct Stats {
+        uint64_t acquires = 0;
+        uint64_t stalls = 0;
+    } stats;
+
+    FencedRing() = default;
+    ~FencedRing() {
+        destroyFences();
+    }
+
+    FencedRing(const FencedRing&) = delete;
+    FencedRing& operator=(const FencedRing&) = delete;
+
+    T& operator[](size_t index) { return slots[index].item; }
+    const T& operator[](size_t index) const { return slots[index].item; }
+    constexpr size_t size() const { return N; }
+
+    size_t currentIndex() const { return currIndex; }
+    T& current() { return slots[currIndex].item; }
+
+    // Selects the next set whose last use has retired on the GPU. If every set is still in flight,
+    // blocks on the oldest one (counted as a stall).
+    size_t acquire() {
+        stats.acquires++;
+
+        for (size_t i = 1; i <= N; i++) {
+            size_t index = (currIndex + i) % N;
+            if (isRetired(slots[index])) {
+                currIndex = index;
+                return currIndex;
+            }
+        }
+
+        // Sets aren't always released in ring order (a frame may skip release()), so find the oldest fence
+        stats.stalls++;
+        size_t oldest = 0;
+        for (size_t index = 1; index < N; index++) {
+            if (slots[index].sequence < slots[oldest].sequence) {
+                oldest = index;
+            }
+        }
+        glClientWaitSync(slots[oldest].fence, GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+        deleteFence(slots[oldest].fence);
+        currIndex = oldest;
+        return currIndex;
+    }
+
+    // Marks the current set as in use by every GL command issued so far.
+    // Call after the last command that reads from the set this frame.
+    void release() {
+        Slot &slot = slots[currIndex];
+        deleteFence(slot.fence);
+        slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        slot.sequence = ++nextSequence;
+    }
+
+    // Makes the GPU wait for the current set's last fenced use before running commands issued from now on,
+    // without blocking the CPU. For rewriting part of a set that is still in flight (acquire() only hands
+    // out retired ones), e.g. re-culling the set that is drawn again on a frame without a new mesh.
+    void waitCurrent() {
+        Slot &slot = slots[currIndex];
+        if (slot.fence != 0) {
+            glWaitSync(slot.fence, 0, GL_TIMEOUT_IGNORED);
+        }
+    }
+
+    // Deletes the fences. Call while the context is still current (e.g. from DestroyResources);
+    // the destructor only deletes fences that are left, which needs a current context too.
+    void destroyFences() {
+        for (auto &slot : slots) {
+            deleteFence(slot.fence);
+        }
+    }
+
+private:
+    struct Slot {
+        T item{};
+        GLsync fence = 0;
+        // Order the fence was created in, to find the oldest one
+        uint64_t sequence = 0;
+    };
+    std::array<Slot, N> slots{};
+    size_t currIndex = 0;
+    uint64_t nextSequence = 0;
+
+    static void deleteFence(GLsync &fence) {
+        if (fence != 0) {
+            glDeleteSync(fence);
+            fence = 0;
+        }
+    }
+
+    static bool isRetired(Slot &slot) {
+        if (slot.fence == 0) {
+            return true;
+        }
+        GLenum result = glClientWaitSync(slot.fence, 0, 0);
+        if (result == GL_ALREADY_SIGNALED || result == GL_CONDITION_SATISFIED) {
+            deleteFence(slot.fence);
+            return true;
+        }
+        return false;
+    }
+};
+
+} // namespace quasar
+
+#endif // FENCED_RING_H
@@ -0,0 +1,58 @@
+#ifndef FRAME_ARENA_H
+#define FRAME_ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+#include <type_traits>
+
+namespace quasar {
+
+// Linear allocator for temporaries that only live for one frame. Allocations bump a pointer into one
+// block and are all released at once by reset(), which the frame loop calls after xrEndFrame.
+//
+// Allocations that don't fit go to the heap and the block grows to the frame's high water mark on the
+// next reset(), so after a few frames the steady state doesn't touch the heap at all.
+class FrameArena {
+public:
+    struct Stats {
+        size_t capacity = 0;
+        size_t used = 0;       // in the current frame
+        size_t highWater = 0;  // largest frame so far
+        uint64_t overflows = 0;
+    };
+
+    FrameArena(size_t capacity = 64 * 1024);
+    ~FrameArena() = default;
+
+    FrameArena(const FrameArena&) = delete;
+    FrameArena& operator=(const FrameArena&) = delete;
+
+    void* allocate(size_t size, size_t alignment = alignof(std::max_align_t));
+
+    // Uninitialized storage for count objects. Destructors are never run, so only trivial types are allowed.
+    template<typename T>
+    T* allocate(size_t count) {
+        static_assert(std::is_trivially_destructible_v<T>, "FrameArena never runs destructors");
+        return static_cast<T*>(allocate(count * sizeof(T), alignof(T)));
+    }
+
+    // Releases everything allocated since the last reset.
+    void reset();
+
+    const Stats &getStats() const { return stats; }
+
+private:
+    std::unique_ptr<uint8_t[]> block;
+    size_t offset = 0;
+    // Allocations that didn't fit in block this frame
+    std::vector<std::unique_ptr<uint8_t[]>> overflowBlocks;
+    size_t overflowBytes = 0;
+
+    Stats stats;
+};
+
+} // namespace quasar
+
+#endif // FRAME_ARENA_H
@@ -0,0 +1,69 @@
+#ifndef FRAME_PACER_H
+#define FRAME_PACER_H
+
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+
+#include <GraphicsAPI.h>
+
+namespace quasar {
+
+// Calls xrWaitFrame on its own thread, so the thread that renders and submits frames never blocks in it.
+//
+// OpenXR lets xrWaitFrame for frame N + 1 run as soon as xrBeginFrame for frame N has returned, from any thread.
+// The pacing thread waits for the next frame while the main thread renders frame N and prepares frame N + 1,
+// and the main thread only blocks if it is done before the runtime wants the next frame.
+class FramePacer {
+public:
+    struct Stats {
+        uint64_t framesWaited = 0;
+        // Time the pacing thread spent in xrWaitFrame for the latest frame
+        double timeInWaitFrameMs = 0.0;
+        // Time the main thread was blocked in acquireFrame for the latest frame
+        double timeBlockedMs = 0.0;
+    };
+
+    FramePacer(XrSession session);
+    ~FramePacer();
+
+    FramePacer(const FramePacer&) = delete;
+    FramePacer& operator=(const FramePacer&) = delete;
+
+    // Starts the pacing thread. Call once the session is running.
+    void start();
+    // Stops and joins the pacing thread. Call before xrEndSession.
+    void stop();
+    bool isRunning() const { return running; }
+
+    // Blocks until the pacing thread has waited for a frame and returns its state.
+    // Returns false if the pacer was stopped or xrWaitFrame failed.
+    bool acquireFrame(XrFrameState &frameState);
+    // Call right after xrBeginFrame for the acquired frame, so the pacing thread can wait for the next one.
+    void frameBegun();
+
+    Stats getStats();
+
+private:
+    XrSession session;
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable cv;
+
+    bool running = false;
+    bool shouldStop = false;
+    // The previous frame has begun, so xrWaitFrame may be called again
+    bool canWait = true;
+    bool frameReady = false;
+    bool failed = false;
+    XrFrameState readyFrameState{XR_TYPE_FRAME_STATE};
+
+    Stats stats;
+
+    void run();
+};
+
+} // namespace quasar
+
+#endif // FRAME_PACER_H
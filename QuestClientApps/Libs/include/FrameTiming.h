@@ -0,0 +1,103 @@
+#ifndef FRAME_TIMING_H
+#define FRAME_TIMING_H
+
+#include <chrono>
+#include <cstdint>
+
+namespace quasar {
+
+// Per frame timing of the OpenXR frame loop: time in xrWaitFrame, CPU work between xrBeginFrame and
+// xrEndFrame, time in xrEndFrame, and the predicted display time and period the runtime gave the frame.
+//
+// Missed refreshes are detected from gaps between predicted display times. A frame is late when its work and
+// submit took longer than a display period, in which case the compositor showed an older frame at least once.
+// Times are kept in histograms that apps (and QualityGovernor) can query. Display times are XrTime, in nanoseconds.
+class FrameTiming {
+public:
+    // Fixed width buckets; the last one also counts everything above it
+    class Histogram {
+    public:
+        static constexpr uint32_t NUM_BUCKETS = 160;
+        static constexpr double BUCKET_MS = 0.25;
+
+        void add(double ms);
+        void reset() { *this = {}; }
+
+        uint64_t getCount() const { return count; }
+        double getMean() const { return count > 0 ? sum / count : 0.0; }
+        double getMax() const { return max; }
+        // Upper edge of the bucket holding the p-th percentile (p in [0, 1])
+        double getPercentile(double p) const;
+
+    private:
+        uint64_t buckets[NUM_BUCKETS] = {};
+        uint64_t count = 0;
+        double sum = 0.0;
+        double max = 0.0;
+    };
+
+    struct Frame {
+        uint64_t index = 0;
+        int64_t predictedDisplayTime = 0;
+        int64_t displayPeriod = 0;
+        double waitTimeMs = 0.0;
+        double workTimeMs = 0.0;
+        double submitTimeMs = 0.0;
+        uint32_t missedFrames = 0;
+        bool late = false;
+        bool rendered = false;
+    };
+
+    struct Stats {
+        uint64_t frames = 0;
+        uint64_t missedFrames = 0;
+        uint64_t lateFrames = 0;
+        Histogram waitTimeMs;
+        Histogram workTimeMs;
+        Histogram submitTimeMs;
+        // Between consecutive predicted display times
+        Histogram displayIntervalMs;
+    };
+
+    FrameTiming() = default;
+
+    // Call right before xrWaitFrame (or before waiting on the pacing thread)
+    void beginWait();
+    // Call after xrBeginFrame with the frame state returned by the wait
+    void beginWork(int64_t predictedDisplayTime, int64_t displayPeriod);
+    // Call right before xrEndFrame
+    void beginSubmit();
+    // Call after xrEndFrame
+    void endFrame(bool rendered);
+
+    // The frame being worked on; its times are filled in as it goes
+    const Frame &getCurrentFrame() const { return current; }
+    // The last frame that went through endFrame
+    const Frame &getLastFrame() const { return last; }
+
+    // Seconds between the predicted display times of the current and the previous frame, 0 on the first frame
+    double getDeltaTime() const { return deltaTime; }
+    double getDisplayPeriodMs() const { return current.displayPeriod / 1e+6; }
+
+    const Stats &getStats() const { return stats; }
+    void resetStats() { stats = {}; }
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    Frame current;
+    Frame last;
+    Stats stats;
+
+    Clock::time_point waitStart;
+    Clock::time_point workStart;
+    Clock::time_point submitStart;
+
+    int64_t lastPredictedDisplayTime = 0;
+    double deltaTime = 0.0;
+    uint64_t frameIndex = 0;
+};
+
+} // namespace quasar
+
+#endif // FRAME_TIMING_H
@@ -0,0 +1,102 @@
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include <array>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <GraphicsAPI.h>
+
+#include <FrameArena.h>
+
+#define GPU_PROFILER_NUM_FRAMES 4
+#define GPU_PROFILER_WINDOW_SIZE 64
+
+namespace quasar {
+
+// Measures GPU time of named scopes with GL_EXT_disjoint_timer_query timestamps.
+// Each scope keeps a small ring of query pairs that collect() reads back a few frames later, so
+// profiling never stalls the pipeline. Timestamps (unlike time-elapsed queries) nest, so a frame
+// scope can contain the per-pass scopes.
+class GPUProfiler {
+public:
+    struct ScopeStats {
+        double lastMs = 0.0;
+        double avgMs = 0.0;
+        double minMs = 0.0;
+        double maxMs = 0.0;
+        uint32_t numSamples = 0; // samples in the rolling window
+    };
+
+    // Profiles the GPU work submitted during its lifetime.
+    class Scope {
+    public:
+        Scope(GPUProfiler &profiler, const char* name) : profiler(profiler), scopeIndex(profiler.beginScope(name)) {}
+        ~Scope() { profiler.endScope(scopeIndex); }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        GPUProfiler &profiler;
+        int scopeIndex;
+    };
+
+    GPUProfiler();
+    ~GPUProfiler();
+
+    GPUProfiler(const GPUProfiler&) = delete;
+    GPUProfiler& operator=(const GPUProfiler&) = delete;
+
+    bool isSupported() const { return supported; }
+
+    // Returns the scope index to pass to endScope(), or -1 if nothing is recorded.
+    int beginScope(const char* name);
+    void endScope(int scopeIndex);
+
+    // Reads back every finished query without waiting. Call once per frame, after the frame is submitted.
+    // Results that straddle a GPU disjoint event (e.g. a frequency change) are discarded.
+    // Scratch space for the results comes from arena.
+    void collect(FrameArena &arena);
+
+    // Returns true and sets elapsedMs if the scope got a new result since the last call.
+    bool getLatestMs(const char* name, double &elapsedMs);
+
+    // Rolling stats over the last GPU_PROFILER_WINDOW_SIZE results of the scope.
+    bool getStats(const char* name, ScopeStats &stats) const;
+
+    void logStats() const;
+
+private:
+    struct ScopeData {
+        std::string name;
+        // Start and end timestamp of each in-flight frame
+        std::array<GLuint, 2 * GPU_PROFILER_NUM_FRAMES> queries{};
+        // Queries are issued at writeIndex and read back from readIndex
+        uint32_t writeIndex = 0;
+        uint32_t readIndex = 0;
+        bool active = false;
+
+        std::array<double, GPU_PROFILER_WINDOW_SIZE> samples{};
+        uint32_t numSamples = 0;
+        uint32_t nextSample = 0;
+        double lastMs = 0.0;
+        bool hasNewResult = false;
+    };
+
+    bool supported = false;
+    std::vector<std::unique_ptr<ScopeData>> scopes;
+
+    int findScope(const char* name) const;
+    ScopeStats computeStats(const ScopeData &scope) const;
+
+    typedef void (*PFNGLQUERYCOUNTEREXTPROC_)(GLuint id, GLenum target);
+    typedef void (*PFNGLGETQUERYOBJECTUI64VEXTPROC_)(GLuint id, GLenum pname, GLuint64* params);
+    PFNGLQUERYCOUNTEREXTPROC_ glQueryCounterEXT_ = nullptr;
+    PFNGLGETQUERYOBJECTUI64VEXTPROC_ glGetQueryObjectui64vEXT_ = nullptr;
+};
+
+} // namespace quasar
+
+#endif // GPU_PROFILER_H
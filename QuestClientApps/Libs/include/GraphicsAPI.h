@@ -7,8 +7,13 @@
 #pragma once
 #include <Utils/HelperFunctions.h>
 
+#if defined(QUEST_CLIENT_HEADLESS)
+// Linux host without a window: a surfaceless EGL context, bound to the runtime with XR_MNDX_egl_enable
+#define XR_USE_PLATFORM_EGL
+#else
 #include <android_native_app_glue.h>
 #define XR_USE_PLATFORM_ANDROID
+#endif
 
 #define XR_USE_GRAPHICS_API_OPENGL_ES
 
@@ -20,8 +25,16 @@
 #include <OpenGLAppConfig.h>
 #include <Renderers/OpenGLRenderer.h>
 
+#include <RenderQueue.h>
+#include <ShadowCache.h>
+#include <FrameArena.h>
+#include <ResourceLoader.h>
+
 namespace quasar {
 
+// GPUProfiler.h includes this header, so it is only declared here
+class GPUProfiler;
+
 enum GraphicsAPI_Type : uint8_t {
     UNKNOWN,
     D3D11,
@@ -117,8 +130,8 @@ public:
     };
 
 public:
-    GraphicsAPI(const Config &config) : OpenGLRenderer(config) {}
-    virtual ~GraphicsAPI() = default;
+    GraphicsAPI(const Config &config);
+    virtual ~GraphicsAPI();
 
     int64_t SelectColorSwapchainFormat(const std::vector<int64_t>& formats);
     int64_t SelectDepthSwapchainFormat(const std::vector<int64_t>& formats);
@@ -143,6 +156,26 @@ public:
     virtual RenderStats drawObjects(const Scene &scene, const Camera &camera, uint32_t clearMask = GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT) override = 0;
     virtual RenderStats drawToScreen(const Shader &screenShader, const RenderTargetBase* overrideRenderTarget = nullptr) override = 0;
 
+    // Submit the scene through a state-sorted draw list instead of walking the scene graph node by node.
+    bool useRenderQueue = false;
+    RenderQueue renderQueue;
+
+    // Keep the static casters in a cached directional shadow map and re-render only the moving ones.
+    bool cacheShadows = false;
+    ShadowCache shadowCache;
+
+    // GPU timings of the frame and its passes. Created with the context, so only valid after construction.
+    std::unique_ptr<GPUProfiler> gpuProfiler;
+
+    // Loads resources on a worker thread with a context shared with the render context. Created with the context.
+    std::unique_ptr<ResourceLoader> resourceLoader;
+
+    // Per frame temporaries for the frame loop and the renderer. Reset by the frame loop after xrEndFrame.
+    FrameArena frameArena;
+
+    // Totals of every draw in the current frame. Reset by the frame loop after xrEndFrame.
+    RenderStats frameRenderStats;
+
 protected:
     virtual const std::vector<int64_t> GetSupportedColorSwapchainFormats() = 0;
     virtual const std::vector<int64_t> GetSupportedDepthSwapchainFormats() = 0;
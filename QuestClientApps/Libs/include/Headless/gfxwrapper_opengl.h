@@ -0,0 +1,17 @@
+#ifndef HEADLESS_GFXWRAPPER_OPENGL_H
+#define HEADLESS_GFXWRAPPER_OPENGL_H
+
+// Stands in for OpenXR's gfxwrapper_opengl.h in headless host builds (QUEST_CLIENT_HEADLESS), which create
+// their context with EGL directly. Provides the same GLES 3.2 and EGL declarations the Android build gets.
+
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#include <GLES3/gl32.h>
+#include <GLES2/gl2ext.h>
+
+// Extension entry points aren't exported by the host's GLES library; loaded by OpenGLESRenderer once its
+// context is current
+extern PFNGLFRAMEBUFFERTEXTUREMULTIVIEWOVRPROC glFramebufferTextureMultiviewOVR_;
+#define glFramebufferTextureMultiviewOVR glFramebufferTextureMultiviewOVR_
+
+#endif // HEADLESS_GFXWRAPPER_OPENGL_H
@@ -0,0 +1,120 @@
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <condition_variable>
+
+namespace quasar {
+
+// A pool of worker threads for CPU work (decompression, decoding, mesh processing), shared by the
+// loading and streaming code instead of each of them spawning threads.
+//
+// Every worker has its own deque: it pushes and pops jobs at the back and steals from the front of the
+// others' when it runs dry. Jobs can have a parent, which only counts as finished once all its children
+// have, so a job can fan out and be waited on as a whole. Threads that wait run jobs in the meantime.
+//
+// Workers are pinned to the big or the little cores, found from the cores' maximum frequencies.
+class JobSystem {
+public:
+    enum class CoreAffinity {
+        ANY,
+        BIG,   // every core outside the slowest cluster
+        LITTLE // the slowest cluster
+    };
+
+    struct Params {
+        // 0 picks one worker per core of the chosen cores, minus one for the render thread
+        uint32_t numWorkers = 0;
+        CoreAffinity affinity = CoreAffinity::BIG;
+    };
+
+    struct CoreTopology {
+        std::vector<int> bigCores;
+        std::vector<int> littleCores;
+    };
+
+    // Reported for every job that ran, from the thread that ran it
+    struct TraceEvent {
+        const char* name;
+        int worker; // -1 for threads outside the pool
+        uint64_t startNs;
+        uint64_t endNs;
+    };
+    using TraceCallback = std::function<void(const TraceEvent&)>;
+
+    struct Job {
+        const char* name;
+        std::function<void()> function;
+        std::shared_ptr<Job> parent;
+        // The job itself plus its unfinished children
+        std::atomic<int32_t> unfinished{1};
+    };
+    using JobHandle = std::shared_ptr<Job>;
+
+    JobSystem() : JobSystem(Params{}) {}
+    JobSystem(const Params &params);
+    ~JobSystem();
+
+    JobSystem(const JobSystem&) = delete;
+    JobSystem& operator=(const JobSystem&) = delete;
+
+    // Creates a job without running it. Children must be created before their parent finishes,
+    // i.e. from the parent's function or before the parent is run.
+    JobHandle create(const char* name, std::function<void()> function, const JobHandle &parent = nullptr);
+    void run(const JobHandle &job);
+    JobHandle submit(const char* name, std::function<void()> function, const JobHandle &parent = nullptr) {
+        JobHandle job = create(name, std::move(function), parent);
+        run(job);
+        return job;
+    }
+
+    bool isFinished(const JobHandle &job) const { return job->unfinished.load(std::memory_order_acquire) == 0; }
+    // Returns once the job and all its children have finished, running queued jobs while waiting.
+    void wait(const JobHandle &job);
+
+    // Calls function(begin, end) over [0, count) in ranges of at most grainSize and waits for all of them.
+    void parallelFor(const char* name, uint32_t count, uint32_t grainSize, const std::function<void(uint32_t, uint32_t)> &function);
+
+    // Set before submitting work; called concurrently from every worker.
+    void setTraceCallback(TraceCallback callback) { traceCallback = std::move(callback); }
+
+    uint32_t getNumWorkers() const { return static_cast<uint32_t>(workers.size()); }
+
+    static CoreTopology getCoreTopology();
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<JobHandle> jobs;
+    };
+
+    // One per worker, plus one for jobs run from outside the pool
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+
+    std::mutex sleepMutex;
+    std::condition_variable workAvailable;
+    std::condition_variable jobFinished;
+    std::atomic<uint32_t> queuedJobs{0};
+    std::atomic<uint32_t> numWaiters{0};
+    bool shouldStop = false;
+
+    TraceCallback traceCallback;
+
+    void workerLoop(int workerIndex, std::vector<int> cores);
+    JobHandle popJob(int workerIndex);
+    bool runOneJob(int workerIndex);
+    void execute(const JobHandle &job, int workerIndex);
+    void finish(Job* job);
+    int currentWorker() const;
+};
+
+} // namespace quasar
+
+#endif // JOB_SYSTEM_H
@@ -0,0 +1,104 @@
+#ifndef MESH_LOD_H
+#define MESH_LOD_H
+
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+#include <Primitives/Mesh.h>
+#include <Primitives/Model.h>
+
+#include <JobSystem.h>
+
+#define MESH_LOD_MAX_LEVELS 4
+
+namespace quasar {
+
+// Simplified levels of detail for the meshes of a model, and per node selection by projected size.
+//
+// Levels are made by vertex clustering: vertices are snapped to a grid over the mesh bounds and every
+// cell keeps one of its original vertices, so levels never invent new attributes. The grid is halved for
+// every level. Generated levels can be written to a binary cache file and loaded from it on the next run;
+// the cache is keyed by a hash of each mesh's vertex and index data and of the parameters that shape the levels.
+//
+// Level meshes draw with their source mesh's material but don't own it.
+class MeshLOD {
+public:
+    struct Params {
+        // Levels generated below full detail (at most MESH_LOD_MAX_LEVELS - 1)
+        uint32_t numLevels = 3;
+        // Grid cells along the longest axis of a mesh for the first level
+        uint32_t gridResolution = 64;
+        // Meshes with fewer triangles are never simplified
+        uint32_t minTriangles = 512;
+        // A level is only kept if it has at most this fraction of the triangles of the level above it
+        float maxTriangleRatio = 0.75f;
+        // Level i + 1 is used once the bounding sphere covers less than screenSizes[i] of the screen's half height
+        float screenSizes[MESH_LOD_MAX_LEVELS - 1] = { 0.25f, 0.1f, 0.04f };
+    };
+
+    struct Stats {
+        uint32_t draws[MESH_LOD_MAX_LEVELS] = {};
+        uint64_t fullTriangles = 0;
+        uint64_t drawnTriangles = 0;
+    };
+
+    Params params;
+    Stats stats;
+
+    MeshLOD() = default;
+    MeshLOD(const Params &params) : params(params) {}
+    ~MeshLOD();
+
+    MeshLOD(const MeshLOD&) = delete;
+    MeshLOD& operator=(const MeshLOD&) = delete;
+
+    // Builds the levels of every mesh in the model. If cachePath is set, levels are loaded from it when it
+    // was written for the same model, and written to it otherwise. With a job system, meshes are simplified
+    // in parallel on its workers; reading back and creating the meshes stays on the calling (GL) thread.
+    void generate(Model &model, const std::string &cachePath = "", JobSystem* jobSystem = nullptr);
+
+    // When generate() ran on ResourceLoader's worker, the level meshes and the model's meshes are adopted onto the
+    // render context afterwards: pass the level meshes to ResourceLoader::adoptMeshes, then every adopted mesh to remapMeshes.
+    std::vector<Mesh*> getLevelMeshes() const;
+    void remapMeshes(const std::unordered_map<const Mesh*, Mesh*> &adoptedMeshes);
+
+    // Call once per frame before select().
+    void resetStats() { stats = {}; }
+
+    // Returns the level of mesh to draw for a node with the given transform, seen from eyePosition.
+    // projectionScale is projection[1][1] of the eye. Meshes without levels are returned as is.
+    Mesh* select(Mesh* mesh, const glm::mat4 &model, const glm::vec3 &eyePosition, float projectionScale);
+
+private:
+    struct Level {
+        std::vector<uint8_t> vertices;
+        std::vector<uint32_t> indices;
+        uint32_t numIndices = 0;
+        Mesh* mesh = nullptr;
+    };
+
+    struct MeshLevels {
+        uint32_t numSourceVertices = 0;
+        uint32_t numSourceIndices = 0;
+        // Of the source vertices and indices; 0 for meshes that aren't simplified
+        uint64_t contentHash = 0;
+        glm::vec3 center{0.0f};
+        float radius = 0.0f;
+        // Level 0 is the source mesh and is not stored
+        std::vector<Level> levels;
+    };
+
+    std::unordered_map<const Mesh*, MeshLevels> meshLevels;
+
+    void buildLevels(const std::vector<uint8_t> &vertices, const std::vector<uint32_t> &indices, uint32_t vertexSize, MeshLevels &levels) const;
+    void createMeshes(Mesh* source, MeshLevels &levels);
+
+    bool loadCache(const std::string &cachePath, const std::vector<Mesh*> &meshes);
+    void writeCache(const std::string &cachePath, const std::vector<Mesh*> &meshes) const;
+    uint64_t hashParams() const;
+};
+
+} // namespace quasar
+
+#endif // MESH_LOD_H
@@ -40,10 +40,25 @@ private:
     virtual const std::vector<int64_t> GetSupportedColorSwapchainFormats() override;
     virtual const std::vector<int64_t> GetSupportedDepthSwapchainFormats() override;
 
+    // Shadow pass for cacheShadows: the cached static casters and/or the dynamic casters, as the cache decides
+    void updateCachedDirLightShadow(const Scene &scene, const Camera &camera);
+
+#if defined(QUEST_CLIENT_HEADLESS)
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLConfig config = nullptr;
+    EGLContext context = EGL_NO_CONTEXT;
+
+    bool createHeadlessContext();
+#else
     ksGpuWindow window{};
+#endif
 
     PFN_xrGetOpenGLESGraphicsRequirementsKHR xrGetOpenGLESGraphicsRequirementsKHR = nullptr;
+#if defined(QUEST_CLIENT_HEADLESS)
+    XrGraphicsBindingEGLMNDX graphicsBinding{};
+#else
     XrGraphicsBindingOpenGLESAndroidKHR graphicsBinding{};
+#endif
 
     std::unordered_map <XrSwapchain, std::pair<SwapchainType, std::vector<XrSwapchainImageOpenGLESKHR>>> swapchainImagesMap{};
 
@@ -51,6 +66,8 @@ private:
     std::unordered_map<GLuint, ImageViewCreateInfo> imageViews{};
 
     GLuint framebuffer;
+
+    std::unique_ptr<FullScreenQuad> outputFsQuad;
 };
 #endif
 
@@ -2,12 +2,27 @@
 #define OPENXR_APP_H
 
 #include <map>
+#include <functional>
 
 #include <spdlog/spdlog.h>
+#if defined(QUEST_CLIENT_HEADLESS)
+#include <spdlog/sinks/stdout_color_sinks.h>
+#else
 #include <spdlog/sinks/android_sink.h>
+#include <sys/system_properties.h>
+#endif
 
 #include <OpenGLAppConfig.h>
 #include <OpenGLESRenderer.h>
+#include <GPUProfiler.h>
+#include <DynamicResolution.h>
+#include <FramePacer.h>
+#include <FrameArena.h>
+#include <FrameTiming.h>
+#include <JobSystem.h>
+#include <AllocationTracker.h>
+#include <StreamReplayer.h>
+#include <ProgramBinaryCache.h>
 
 #include <Scene.h>
 #include <Cameras/VRCamera.h>
@@ -33,9 +48,17 @@ public:
 
         // Set up spd for android logging.
         spdlog::set_pattern("%v");
+#if defined(QUEST_CLIENT_HEADLESS)
+        auto logger = spdlog::stdout_color_mt("headless");
+#else
         std::string tag = "spdlog-android";
         auto logger = spdlog::android_logger_mt("android", tag);
+#endif
         spdlog::set_default_logger(logger);
+
+#if !defined(QUEST_CLIENT_HEADLESS)
+        streamCapture.loadProperties();
+#endif
     }
     ~OpenXRApp() = default;
 
@@ -57,19 +80,35 @@ public:
         CreateReferenceSpace();
         CreateSwapchains();
 
+        jobSystem = std::make_unique<JobSystem>(jobSystemParams);
         CreateResourcesInternal();
 
+        if (ProgramBinaryCache::isEnabled()) {
+            ProgramBinaryCache::Stats programStats = ProgramBinaryCache::getStats();
+            spdlog::info("Program binary cache: {} hits, {} misses, {} rejected, {:.3f}ms linking",
+                         programStats.hits, programStats.misses, programStats.rejected, programStats.linkTimeMs);
+        }
+
         while (m_applicationRunning) {
             PollSystemEvents();
             PollEvents();
             if (m_sessionRunning) {
+                OnPrepareFrame();
                 RenderFrame();
             }
         }
 
+        if (framePacer) {
+            framePacer->stop();
+        }
+
+        // Loader jobs write into the app's resources and use the job system, so finish them before either goes away
+        m_graphicsAPI->resourceLoader->shutdown();
+
         DestroySwapchains();
         DestroyReferenceSpace();
         DestroyResources();
+        jobSystem.reset();
         DestroySession();
 
         DestroyDebugMessenger();
@@ -93,6 +132,14 @@ protected:
             // Ensure m_apiType is already defined when we call this line.
             m_instanceExtensions.push_back(GetGraphicsAPIInstanceExtensionString(m_apiType));
             m_instanceExtensions.push_back(XR_EXT_DEBUG_UTILS_EXTENSION_NAME);
+#if defined(QUEST_CLIENT_HEADLESS)
+            // Binds the surfaceless EGL context instead of an Android one
+            m_instanceExtensions.push_back(XR_MNDX_EGL_ENABLE_EXTENSION_NAME);
+#endif
+
+            if (submitDepthLayer) {
+                m_optionalInstanceExtensions.push_back(XR_KHR_COMPOSITION_LAYER_DEPTH_EXTENSION_NAME);
+            }
         }
 
         // Get all the API Layers from the OpenXR runtime.
@@ -144,6 +191,18 @@ protected:
             }
         }
 
+        // Optional Instance Extensions are only enabled if the runtime supports them.
+        for (auto &optionalInstanceExtension : m_optionalInstanceExtensions) {
+            for (auto &extensionProperty : extensionProperties) {
+                if (strcmp(optionalInstanceExtension.c_str(), extensionProperty.extensionName) == 0) {
+                    m_activeInstanceExtensions.push_back(optionalInstanceExtension.c_str());
+                    break;
+                }
+            }
+        }
+        m_depthLayerEnabled = submitDepthLayer && IsStringInVector(m_activeInstanceExtensions, XR_KHR_COMPOSITION_LAYER_DEPTH_EXTENSION_NAME);
+        XR_LOG("Depth layer submission " << (m_depthLayerEnabled ? "enabled" : "disabled"));
+
         // Fill out an XrInstanceCreateInfo structure and create an XrInstance.
         XrInstanceCreateInfo instanceCI{XR_TYPE_INSTANCE_CREATE_INFO};
         instanceCI.createFlags = 0;
@@ -378,6 +437,11 @@ protected:
         // Create an XrSessionCreateInfo structure.
         XrSessionCreateInfo sessionCI{XR_TYPE_SESSION_CREATE_INFO};
 
+        // Before the context is created, so the renderer's own shaders are cached too
+        if (cacheProgramBinaries) {
+            ProgramBinaryCache::enable(GetDataPath() + "/program_cache");
+        }
+
         // Create a std::unique_ptr<GraphicsAPI_...> from the instance and system.
         // This call sets up a graphics API that's suitable for use with OpenXR.
         if (m_apiType == OPENGL_ES) {
@@ -474,6 +538,10 @@ protected:
                 }
                 if (sessionStateChanged->state == XR_SESSION_STATE_STOPPING) {
                     // SessionState is stopping. End the XrSession.
+                    // The pacing thread can't be in xrWaitFrame past this point.
+                    if (framePacer) {
+                        framePacer->stop();
+                    }
                     OPENXR_CHECK(xrEndSession(m_session), "Failed to end Session.");
                     m_sessionRunning = false;
                 }
@@ -578,6 +646,11 @@ protected:
         const XrViewConfigurationView &viewConfigurationView = m_viewConfigurationViews[0];
         uint32_t viewCount = static_cast<uint32_t>(m_viewConfigurationViews.size());
 
+        // With dynamic resolution, the swapchain is sized for the largest scale and each frame renders into a sub-rectangle of it.
+        float maxRenderScale = dynamicResolutionEnabled ? dynamicResolutionParams.maxScale : 1.0f;
+        m_swapchainWidth = std::min(static_cast<uint32_t>(viewConfigurationView.recommendedImageRectWidth * maxRenderScale), viewConfigurationView.maxImageRectWidth);
+        m_swapchainHeight = std::min(static_cast<uint32_t>(viewConfigurationView.recommendedImageRectHeight * maxRenderScale), viewConfigurationView.maxImageRectHeight);
+
         // Create a color and depth swapchain, and their associated image views.
         // Fill out an XrSwapchainCreateInfo structure and create an XrSwapchain.
         // Color.
@@ -586,8 +659,8 @@ protected:
         swapchainCI.usageFlags = XR_SWAPCHAIN_USAGE_SAMPLED_BIT | XR_SWAPCHAIN_USAGE_COLOR_ATTACHMENT_BIT;
         swapchainCI.format = m_graphicsAPI->SelectColorSwapchainFormat(formats);          // Use GraphicsAPI to select the first compatible format.
         swapchainCI.sampleCount = viewConfigurationView.recommendedSwapchainSampleCount;  // Use the recommended values from the XrViewConfigurationView.
-        swapchainCI.width = viewConfigurationView.recommendedImageRectWidth;
-        swapchainCI.height = viewConfigurationView.recommendedImageRectHeight;
+        swapchainCI.width = m_swapchainWidth;
+        swapchainCI.height = m_swapchainHeight;
         swapchainCI.faceCount = 1;
         swapchainCI.arraySize = viewCount;
         swapchainCI.mipCount = 1;
@@ -599,8 +672,8 @@ protected:
         swapchainCI.usageFlags = XR_SWAPCHAIN_USAGE_SAMPLED_BIT | XR_SWAPCHAIN_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT;
         swapchainCI.format = m_graphicsAPI->SelectDepthSwapchainFormat(formats);          // Use GraphicsAPI to select the first compatible format.
         swapchainCI.sampleCount = viewConfigurationView.recommendedSwapchainSampleCount;  // Use the recommended values from the XrViewConfigurationView.
-        swapchainCI.width = viewConfigurationView.recommendedImageRectWidth;
-        swapchainCI.height = viewConfigurationView.recommendedImageRectHeight;
+        swapchainCI.width = m_swapchainWidth;
+        swapchainCI.height = m_swapchainHeight;
         swapchainCI.faceCount = 1;
         swapchainCI.arraySize = viewCount;
         swapchainCI.mipCount = 1;
@@ -648,6 +721,16 @@ protected:
         }
 
         XR_LOG("Created swapchains with reccomended resolution: " << viewConfigurationView.recommendedImageRectWidth << "x" << viewConfigurationView.recommendedImageRectHeight);
+
+        if (dynamicResolutionEnabled) {
+            if (m_graphicsAPI->gpuProfiler->isSupported()) {
+                dynamicResolution = std::make_unique<DynamicResolution>(dynamicResolutionParams);
+                XR_LOG("Dynamic resolution enabled, swapchain resolution: " << m_swapchainWidth << "x" << m_swapchainHeight);
+            }
+            else {
+                XR_LOG("Dynamic resolution disabled, GPU timer queries are not supported.");
+            }
+        }
     }
 
     void DestroySwapchains() {
@@ -670,22 +753,58 @@ protected:
 
     virtual void HandleInteractions() {}
 
+    // CPU work for the next frame that doesn't need its predicted display time (simulation, network ingestion).
+    // With pipelinedFrameLoop it runs while the pacing thread waits for the frame.
+    virtual void OnPrepareFrame() {}
+
     virtual void OnRender(double now, double dt) {}
 
+    // Lets an app submit its own composition layers (e.g. video in a separate swapchain) below the rendered scene.
+    // The layer structs must stay valid until xrEndFrame returns.
+    virtual void AddBackgroundLayers(std::vector<XrCompositionLayerBaseHeader*> &layers) {}
+
     void RenderFrame() {
         // Get the XrFrameState for timing and rendering info.
         XrFrameState frameState{XR_TYPE_FRAME_STATE};
-        XrFrameWaitInfo frameWaitInfo{XR_TYPE_FRAME_WAIT_INFO};
-        OPENXR_CHECK(xrWaitFrame(m_session, &frameWaitInfo, &frameState), "Failed to wait for XR Frame.");
+        frameTiming.beginWait();
+        bool frameAcquired = false;
+        if (pipelinedFrameLoop) {
+            if (!framePacer) {
+                framePacer = std::make_unique<FramePacer>(m_session);
+            }
+            framePacer->start();
+            frameAcquired = framePacer->acquireFrame(frameState);
+            if (!frameAcquired) {
+                // xrWaitFrame failed on the pacing thread. Wait on this thread from now on instead of restarting
+                // the pacer every frame, so a lasting error is reported by OPENXR_CHECK as it is without the pacer.
+                spdlog::warn("Frame pacing thread failed, waiting for frames on the main thread");
+                framePacer->stop();
+                framePacer.reset();
+                pipelinedFrameLoop = false;
+            }
+        }
+        if (!frameAcquired) {
+            XrFrameWaitInfo frameWaitInfo{XR_TYPE_FRAME_WAIT_INFO};
+            OPENXR_CHECK(xrWaitFrame(m_session, &frameWaitInfo, &frameState), "Failed to wait for XR Frame.");
+        }
 
         // Tell the OpenXR compositor that the application is beginning the frame.
         XrFrameBeginInfo frameBeginInfo{XR_TYPE_FRAME_BEGIN_INFO};
         OPENXR_CHECK(xrBeginFrame(m_session, &frameBeginInfo), "Failed to begin the XR Frame.");
+        frameTiming.beginWork(frameState.predictedDisplayTime, frameState.predictedDisplayPeriod);
+        if (pipelinedFrameLoop) {
+            // The next xrWaitFrame may start now, while this frame is rendered
+            framePacer->frameBegun();
+        }
+        AllocationTracker::Counts frameStartAllocations = AllocationTracker::getThreadCounts();
 
-        // Variables for rendering and layer composition.
+        // Variables for rendering and layer composition. The layer info is reused so its vectors keep their capacity.
         bool rendered = false;
-        RenderLayerInfo renderLayerInfo;
+        RenderLayerInfo &renderLayerInfo = m_renderLayerInfo;
+        renderLayerInfo.layers.clear();
+        renderLayerInfo.layerProjection = {XR_TYPE_COMPOSITION_LAYER_PROJECTION};
         renderLayerInfo.predictedDisplayTime = frameState.predictedDisplayTime;
+        renderLayerInfo.predictedDisplayPeriod = frameState.predictedDisplayPeriod;
 
         // Check that the session is active and that we should render.
         bool sessionActive = (m_sessionState == XR_SESSION_STATE_SYNCHRONIZED || m_sessionState == XR_SESSION_STATE_VISIBLE || m_sessionState == XR_SESSION_STATE_FOCUSED);
@@ -697,6 +816,8 @@ protected:
             // Render the stereo image and associate one of swapchain images with the XrCompositionLayerProjection structure.
             rendered = RenderLayer(renderLayerInfo);
             if (rendered) {
+                // Layers are composited in order, so app-owned layers go underneath the rendered scene.
+                AddBackgroundLayers(renderLayerInfo.layers);
                 renderLayerInfo.layers.push_back(reinterpret_cast<XrCompositionLayerBaseHeader*>(&renderLayerInfo.layerProjection));
             }
         }
@@ -707,12 +828,103 @@ protected:
         frameEndInfo.environmentBlendMode = m_environmentBlendMode;
         frameEndInfo.layerCount = static_cast<uint32_t>(renderLayerInfo.layers.size());
         frameEndInfo.layers = renderLayerInfo.layers.data();
+        frameTiming.beginSubmit();
         OPENXR_CHECK(xrEndFrame(m_session, &frameEndInfo), "Failed to end the XR Frame.");
+        frameTiming.endFrame(rendered);
+
+        // Only known once the frame is submitted, so logged here rather than by the apps in OnRender
+        if (rendered && logStatsThisFrame) {
+            spdlog::info("Rendering time: {:.3f}ms (display interval: {:.3f}ms)",
+                         frameTiming.getLastFrame().workTimeMs, frameTiming.getDeltaTime() * 1e+3);
+        }
+
+        // Nothing submitted this frame points into the arena anymore
+        m_graphicsAPI->frameArena.reset();
+
+        AllocationTracker::Counts frameEndAllocations = AllocationTracker::getThreadCounts();
+        lastFrameAllocations.allocations = frameEndAllocations.allocations - frameStartAllocations.allocations;
+        lastFrameAllocations.bytes = frameEndAllocations.bytes - frameStartAllocations.bytes;
+
+        if (onFrameEnd) {
+            // Doesn't consume the new result flag that dynamic resolution reads
+            GPUProfiler::ScopeStats gpuStats;
+            bool hasGPUTime = m_graphicsAPI->gpuProfiler->getStats("frame", gpuStats) && gpuStats.numSamples > 0;
+            onFrameEnd({ frameTiming.getLastFrame(), hasGPUTime ? gpuStats.lastMs : -1.0, m_graphicsAPI->frameRenderStats, lastFrameAllocations });
+        }
+        m_graphicsAPI->frameRenderStats = {};
+    }
+
+    // Logs the frame timing since the last log and starts a new window.
+    void logFrameTiming() {
+        const FrameTiming::Stats &timingStats = frameTiming.getStats();
+        if (timingStats.frames == 0) {
+            return;
+        }
+        spdlog::info("Frame timing over {} frames ({:.2f}ms period): work {:.2f}/{:.2f}ms (p50/p99), wait {:.2f}/{:.2f}ms, submit {:.2f}/{:.2f}ms, {} missed, {} late",
+                     timingStats.frames, frameTiming.getDisplayPeriodMs(),
+                     timingStats.workTimeMs.getPercentile(0.5), timingStats.workTimeMs.getPercentile(0.99),
+                     timingStats.waitTimeMs.getPercentile(0.5), timingStats.waitTimeMs.getPercentile(0.99),
+                     timingStats.submitTimeMs.getPercentile(0.5), timingStats.submitTimeMs.getPercentile(0.99),
+                     timingStats.missedFrames, timingStats.lateFrames);
+        frameTiming.resetStats();
+    }
+
+    // Locates the views again for the frame's predicted display time and updates the cameras and the submitted
+    // projection views with the result. Call from OnRender right before the draws that depend on the head pose,
+    // so the CPU work earlier in OnRender (network, decode, compute) doesn't add to the pose's age. Camera data the
+    // app keeps in uniform buffers has to be written after this. Returns false and keeps the earlier poses if the
+    // views can't be located.
+    bool LateLatchViews() {
+        const uint32_t maxViews = static_cast<uint32_t>(m_viewConfigurationViews.size());
+        XrView* views = m_graphicsAPI->frameArena.allocate<XrView>(maxViews);
+        for (uint32_t i = 0; i < maxViews; i++) {
+            views[i] = {XR_TYPE_VIEW};
+        }
+
+        XrViewState viewState{XR_TYPE_VIEW_STATE};
+        XrViewLocateInfo viewLocateInfo{XR_TYPE_VIEW_LOCATE_INFO};
+        viewLocateInfo.viewConfigurationType = m_viewConfiguration;
+        viewLocateInfo.displayTime = m_renderLayerInfo.predictedDisplayTime;
+        viewLocateInfo.space = m_localSpace;
+        uint32_t viewCount = 0;
+        XrResult result = xrLocateViews(m_session, &viewLocateInfo, &viewState, maxViews, &viewCount, views);
+        if (result != XR_SUCCESS || viewCount != m_locatedViewCount) {
+            return false;
+        }
+        // Tracking may have been lost since the first locate
+        const XrViewStateFlags requiredFlags = XR_VIEW_STATE_ORIENTATION_VALID_BIT | XR_VIEW_STATE_POSITION_VALID_BIT;
+        if ((viewState.viewStateFlags & requiredFlags) != requiredFlags) {
+            return false;
+        }
+
+        for (uint32_t i = 0; i < viewCount; i++) {
+            views[i].pose.position.x += cameraPositionOffset.x;
+            views[i].pose.position.y += cameraPositionOffset.y;
+            views[i].pose.position.z += cameraPositionOffset.z;
+
+            // The compositor reprojects from the pose the frame says it was rendered with, so it has to match
+            m_renderLayerInfo.layerProjectionViews[i].pose = views[i].pose;
+            m_renderLayerInfo.layerProjectionViews[i].fov = views[i].fov;
+        }
+
+        cameras->setProjectionMatrices({
+            gxi::toGLM(views[0].fov, m_apiType, nearZ, farZ),
+            gxi::toGLM(views[1].fov, m_apiType, nearZ, farZ)
+        });
+        cameras->setViewMatrices({
+            glm::inverse(gxi::toGlm(views[0].pose)),
+            glm::inverse(gxi::toGlm(views[1].pose))
+        });
+        return true;
     }
 
     bool RenderLayer(RenderLayerInfo &renderLayerInfo) {
         // Locate the views from the view configuration within the (reference) space at the display time.
-        std::vector<XrView> views(m_viewConfigurationViews.size(), {XR_TYPE_VIEW});
+        const uint32_t maxViews = static_cast<uint32_t>(m_viewConfigurationViews.size());
+        XrView* views = m_graphicsAPI->frameArena.allocate<XrView>(maxViews);
+        for (uint32_t i = 0; i < maxViews; i++) {
+            views[i] = {XR_TYPE_VIEW};
+        }
 
         XrViewState viewState{XR_TYPE_VIEW_STATE};  // Will contain information on whether the position and/or orientation is valid and/or tracked.
         XrViewLocateInfo viewLocateInfo{XR_TYPE_VIEW_LOCATE_INFO};
@@ -720,14 +932,19 @@ protected:
         viewLocateInfo.displayTime = renderLayerInfo.predictedDisplayTime;
         viewLocateInfo.space = m_localSpace;
         uint32_t viewCount = 0;
-        XrResult result = xrLocateViews(m_session, &viewLocateInfo, &viewState, static_cast<uint32_t>(views.size()), &viewCount, views.data());
+        XrResult result = xrLocateViews(m_session, &viewLocateInfo, &viewState, maxViews, &viewCount, views);
         if (result != XR_SUCCESS) {
             XR_LOG("Failed to locate Views.");
             return false;
         }
 
+        m_locatedViewCount = viewCount;
+
         // Resize the layer projection views to match the view count. The layer projection views are used in the layer projection.
         renderLayerInfo.layerProjectionViews.resize(viewCount, {XR_TYPE_COMPOSITION_LAYER_PROJECTION_VIEW});
+        if (m_depthLayerEnabled) {
+            renderLayerInfo.layerDepthInfos.resize(viewCount, {XR_TYPE_COMPOSITION_LAYER_DEPTH_INFO_KHR});
+        }
 
         for (uint32_t i = 0; i < viewCount; i++) {
             // Apply the camera position offset to the view.
@@ -754,8 +971,9 @@ protected:
         OPENXR_CHECK(xrWaitSwapchainImage(m_depthSwapchainInfo.swapchain, &waitInfo), "Failed to wait for Image from the Depth Swapchain");
 
         // Get the width and height and construct the viewport and scissors.
-        const uint32_t &width = m_viewConfigurationViews[0].recommendedImageRectWidth;
-        const uint32_t &height = m_viewConfigurationViews[0].recommendedImageRectHeight;
+        float renderScale = dynamicResolution ? dynamicResolution->getScale() : 1.0f;
+        const uint32_t width = std::min(static_cast<uint32_t>(m_viewConfigurationViews[0].recommendedImageRectWidth * renderScale), m_swapchainWidth);
+        const uint32_t height = std::min(static_cast<uint32_t>(m_viewConfigurationViews[0].recommendedImageRectHeight * renderScale), m_swapchainHeight);
 
         // Fill out the XrCompositionLayerProjectionView structure specifying the pose and fov from the view.
         // This also associates the swapchain image with this layer projection view.
@@ -770,6 +988,20 @@ protected:
             renderLayerInfo.layerProjectionViews[i].subImage.imageRect.extent.width = static_cast<int32_t>(width);
             renderLayerInfo.layerProjectionViews[i].subImage.imageRect.extent.height = static_cast<int32_t>(height);
             renderLayerInfo.layerProjectionViews[i].subImage.imageArrayIndex = i;  // Useful for multiview rendering.
+
+            // Chain the depth of this view, so the runtime can do positional reprojection.
+            if (m_depthLayerEnabled) {
+                XrCompositionLayerDepthInfoKHR &depthInfo = renderLayerInfo.layerDepthInfos[i];
+                depthInfo = { XR_TYPE_COMPOSITION_LAYER_DEPTH_INFO_KHR };
+                depthInfo.subImage.swapchain = m_depthSwapchainInfo.swapchain;
+                depthInfo.subImage.imageRect = renderLayerInfo.layerProjectionViews[i].subImage.imageRect;
+                depthInfo.subImage.imageArrayIndex = i;
+                depthInfo.minDepth = 0.0f;
+                depthInfo.maxDepth = 1.0f;
+                depthInfo.nearZ = nearZ;
+                depthInfo.farZ = farZ;
+                renderLayerInfo.layerProjectionViews[i].next = &depthInfo;
+            }
         }
 
         // Prepare to render
@@ -787,11 +1019,50 @@ protected:
             glm::inverse(gxi::toGlm(views[1].pose))
         });
 
+        // Attach whatever finished loading in the background
+        m_graphicsAPI->resourceLoader->update();
+
         double now = renderLayerInfo.predictedDisplayTime / 1e+9; // Convert nanoseconds to seconds.
-        static double lastTime = now;
-        double dt = (now - lastTime);
-        OnRender(now, dt);
-        lastTime = now;
+        double dt = frameTiming.getDeltaTime();
+        logStatsThisFrame = statsLogInterval <= 0.0 || now - lastStatsLogTime >= statsLogInterval;
+        if (logStatsThisFrame) {
+            lastStatsLogTime = now;
+        }
+        {
+            GPUProfiler::Scope frameScope(*m_graphicsAPI->gpuProfiler, "frame");
+            OnRender(now, dt);
+        }
+
+        // Read back the GPU timings of earlier frames
+        GPUProfiler &gpuProfiler = *m_graphicsAPI->gpuProfiler;
+        gpuProfiler.collect(m_graphicsAPI->frameArena);
+        if (gpuStatsLogInterval > 0.0 && now - lastGPUStatsLogTime >= gpuStatsLogInterval) {
+            gpuProfiler.logStats();
+            logFrameTiming();
+            if (framePacer) {
+                FramePacer::Stats pacerStats = framePacer->getStats();
+                spdlog::info("Frame pacing: {:.3f}ms in xrWaitFrame, {:.3f}ms blocked on it",
+                             pacerStats.timeInWaitFrameMs, pacerStats.timeBlockedMs);
+            }
+            const FrameArena::Stats &arenaStats = m_graphicsAPI->frameArena.getStats();
+            spdlog::info("Frame arena: {} of {} bytes used (high water {}), {} overflows",
+                         arenaStats.used, arenaStats.capacity, arenaStats.highWater, arenaStats.overflows);
+            if (AllocationTracker::isEnabled()) {
+                // Measured up to here on the previous frame; this frame is still in flight
+                spdlog::info("Heap allocations on the frame thread: {} ({} bytes) last frame",
+                             lastFrameAllocations.allocations, lastFrameAllocations.bytes);
+            }
+            lastGPUStatsLogTime = now;
+        }
+
+        // Pick the render scale for the next frames from the GPU time of earlier ones
+        double gpuTimeMs;
+        if (dynamicResolution && gpuProfiler.getLatestMs("frame", gpuTimeMs)) {
+            double frameBudgetMs = renderLayerInfo.predictedDisplayPeriod / 1e+6; // Convert nanoseconds to milliseconds.
+            if (dynamicResolution->update(gpuTimeMs, frameBudgetMs)) {
+                XR_LOG("Render scale: " << dynamicResolution->getScale() << " (GPU time: " << dynamicResolution->stats.smoothedGPUTimeMs << "ms, budget: " << frameBudgetMs << "ms)");
+            }
+        }
 
         // Give the swapchain image back to OpenXR, allowing the compositor to use the image.
         XrSwapchainImageReleaseInfo releaseInfo{XR_TYPE_SWAPCHAIN_IMAGE_RELEASE_INFO};
@@ -808,6 +1079,63 @@ protected:
     }
 
 public:
+    // Measurements of one frame, handed to onFrameEnd.
+    struct FrameReport {
+        const FrameTiming::Frame &timing;
+        // GPU time of the latest frame whose timestamps have been read back, negative if there is none
+        double gpuTimeMs;
+        RenderStats renderStats;
+        AllocationTracker::Counts allocations;
+    };
+    // Called after every submitted frame. Set before Run(); used by the headless benchmark runner.
+    std::function<void(const FrameReport&)> onFrameEnd;
+
+    // Streaming apps (ATWClient, MeshWarpClient) record the streams they receive, or replay a recording
+    // instead of connecting to the server. Set before Run(); on the headset, from system properties (loadProperties).
+    struct StreamCapture {
+        enum class Mode {
+            LIVE,
+            RECORD,
+            REPLAY
+        } mode = Mode::LIVE;
+        // Empty for <data path>/<app name>.qsr
+        std::string path;
+        StreamReplayer::Params replay;
+
+        std::string getPath(const std::string &appName) const {
+            return path.empty() ? GetDataPath() + "/" + appName + ".qsr" : path;
+        }
+
+#if !defined(QUEST_CLIENT_HEADLESS)
+        // Read when the app starts, so a session can be recorded without rebuilding:
+        //   adb shell setprop debug.quasar.capture record    (or replay, live)
+        //   adb shell setprop debug.quasar.capture_path /sdcard/Android/data/<package>/files/session.qsr
+        void loadProperties() {
+            char value[PROP_VALUE_MAX] = {};
+            if (__system_property_get("debug.quasar.capture", value) > 0) {
+                std::string modeName = value;
+                if (modeName == "record") mode = Mode::RECORD;
+                else if (modeName == "replay") mode = Mode::REPLAY;
+                else if (modeName == "live") mode = Mode::LIVE;
+                else spdlog::warn("Ignoring debug.quasar.capture={} (expected live, record or replay)", modeName);
+            }
+            if (__system_property_get("debug.quasar.capture_path", value) > 0) {
+                path = value;
+            }
+        }
+#endif
+    } streamCapture;
+
+    // Writable directory for caches.
+    static std::string GetDataPath() {
+#if defined(QUEST_CLIENT_HEADLESS)
+        return ".";
+#else
+        return androidApp->activity->internalDataPath;
+#endif
+    }
+
+#if !defined(QUEST_CLIENT_HEADLESS)
     // Stored pointer to the android_app structure from android_main().
     static android_app* androidApp;
 
@@ -855,7 +1183,13 @@ public:
         }
     }
 
+#endif
+
 protected:
+#if defined(QUEST_CLIENT_HEADLESS)
+    // No OS events on a headless host; the runtime ends the session when it is done.
+    void PollSystemEvents() {}
+#else
     void PollSystemEvents() {
         // Checks whether Android has requested that application should by destroyed.
         if (androidApp->destroyRequested != 0) {
@@ -877,12 +1211,14 @@ protected:
             }
         }
     }
+#endif
 
     XrInstance m_xrInstance = XR_NULL_HANDLE;
     std::vector<const char*> m_activeAPILayers = {};
     std::vector<const char*> m_activeInstanceExtensions = {};
     std::vector<std::string> m_apiLayers = {};
     std::vector<std::string> m_instanceExtensions = {};
+    std::vector<std::string> m_optionalInstanceExtensions = {};
 
     XrDebugUtilsMessengerEXT m_debugUtilsMessenger = XR_NULL_HANDLE;
 
@@ -910,18 +1246,32 @@ protected:
     };
     SwapchainInfo m_colorSwapchainInfo = {};
     SwapchainInfo m_depthSwapchainInfo = {};
+    uint32_t m_swapchainWidth = 0;
+    uint32_t m_swapchainHeight = 0;
 
     std::vector<XrEnvironmentBlendMode> m_applicationEnvironmentBlendModes = {XR_ENVIRONMENT_BLEND_MODE_OPAQUE, XR_ENVIRONMENT_BLEND_MODE_ADDITIVE};
     std::vector<XrEnvironmentBlendMode> m_environmentBlendModes = {};
     XrEnvironmentBlendMode m_environmentBlendMode = XR_ENVIRONMENT_BLEND_MODE_MAX_ENUM;
 
     XrSpace m_localSpace = XR_NULL_HANDLE;
+    // Per frame layer data, reused across frames.
     struct RenderLayerInfo {
         XrTime predictedDisplayTime = 0;
+        XrDuration predictedDisplayPeriod = 0;
         std::vector<XrCompositionLayerBaseHeader*> layers;
         XrCompositionLayerProjection layerProjection = {XR_TYPE_COMPOSITION_LAYER_PROJECTION};
         std::vector<XrCompositionLayerProjectionView> layerProjectionViews;
+        std::vector<XrCompositionLayerDepthInfoKHR> layerDepthInfos;
     };
+    RenderLayerInfo m_renderLayerInfo;
+    uint32_t m_locatedViewCount = 0;
+
+    // Heap allocations made by the frame thread during the last complete frame (QUEST_CLIENT_TRACK_ALLOCATIONS only,
+    // see AllocationTracker). Steady state frames should make none.
+    AllocationTracker::Counts lastFrameAllocations;
+
+    // Wait, work and submit times of every frame, and missed/late frame counts.
+    FrameTiming frameTiming;
 
     float nearZ = 0.05f;
     float farZ = 1000.0f;
@@ -933,6 +1283,41 @@ protected:
 
     glm::vec3 cameraPositionOffset{0.0f, 0.0f, 0.0f};
 
+    // Set in the app's constructor. Submits the depth swapchain with the projection layer (XR_KHR_composition_layer_depth)
+    // so the runtime can reproject positionally. Turn off for apps that don't write scene depth.
+    bool submitDepthLayer = true;
+    bool m_depthLayerEnabled = false;
+
+    // Set in the app's constructor to scale the render resolution with GPU load.
+    bool dynamicResolutionEnabled = false;
+    DynamicResolution::Params dynamicResolutionParams;
+    std::unique_ptr<DynamicResolution> dynamicResolution;
+
+    // Set in the app's constructor. Calls xrWaitFrame on a pacing thread (FramePacer), so the main thread
+    // renders frame N and runs OnPrepareFrame for frame N + 1 while the wait for frame N + 1 is in flight.
+    // Cleared if xrWaitFrame fails on the pacing thread; frames are then waited for on the main thread.
+    bool pipelinedFrameLoop = false;
+    std::unique_ptr<FramePacer> framePacer;
+
+    // Worker pool for CPU work off the render thread (LOD building, depth decoding). Created before
+    // CreateResources and destroyed after DestroyResources; set the params in the app's constructor.
+    JobSystem::Params jobSystemParams;
+    std::unique_ptr<JobSystem> jobSystem;
+
+    // Set in the app's constructor. Keeps linked shader programs in <data path>/program_cache (ProgramBinaryCache),
+    // so only the first launch after an install or driver update compiles them.
+    bool cacheProgramBinaries = true;
+
+    // Seconds between logs of the rolling GPU time of each profiled scope (0 disables).
+    double gpuStatsLogInterval = 5.0;
+    double lastGPUStatsLogTime = 0.0;
+
+    // Seconds between the apps' own per-frame stats logs (0 logs every frame). Apps only log in OnRender
+    // when logStatsThisFrame is set, since formatting log lines on every frame allocates.
+    double statsLogInterval = 1.0;
+    double lastStatsLogTime = 0.0;
+    bool logStatsThisFrame = false;
+
     // In STAGE space, viewHeightM should be 0. In LOCAL space, it should be offset downwards, below the viewer's initial position.
     float m_viewHeightM = 1.6f;
 
@@ -0,0 +1,83 @@
+#ifndef POSE_PREDICTOR_H
+#define POSE_PREDICTOR_H
+
+#include <array>
+
+#include <glm/glm.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#include <Cameras/VRCamera.h>
+
+#define POSE_PREDICTOR_MAX_PENDING 128
+
+namespace quasar {
+
+// Extrapolates the head pose to when a streamed frame will be displayed, so the server renders for
+// (roughly) the pose the client will warp it to and reprojection has less to correct.
+//
+// Uses constant linear and angular velocity, smoothed over the located head poses. The horizon is the
+// smoothed end to end latency of received frames. Every prediction is kept until its target time
+// and compared against the pose actually located then, along with the error of not predicting at all.
+class PosePredictor {
+public:
+    struct Params {
+        // Weight of the newest sample in the smoothed velocities
+        float velocitySmoothing = 0.5f;
+        // Weight of the newest measurement in the smoothed latency
+        float latencySmoothing = 0.1f;
+        // Never extrapolate further ahead than this
+        double maxHorizonMs = 100.0;
+    } params;
+
+    struct Stats {
+        double latencyMs = 0.0;
+        uint64_t numSamples = 0;
+        // Mean error of the predicted poses
+        double positionErrorMm = 0.0;
+        double rotationErrorDeg = 0.0;
+        // Mean error of sending the pose at prediction time instead
+        double unpredictedPositionErrorMm = 0.0;
+        double unpredictedRotationErrorDeg = 0.0;
+    } stats;
+
+    PosePredictor() = default;
+    PosePredictor(const Params &params) : params(params) {}
+
+    // Adds the head pose of cameras, located for time now (in seconds). Call once per frame.
+    void update(double now, const VRCamera &cameras);
+    // Adds a measured end to end latency (pose sent to frame displayed).
+    void addLatencySample(double latencyMs);
+
+    // Writes cameras moved by the head motion predicted over the current horizon into predictedCameras.
+    void predict(const VRCamera &cameras, VRCamera &predictedCameras);
+
+private:
+    struct HeadPose {
+        glm::vec3 position{0.0f};
+        glm::quat orientation{1.0f, 0.0f, 0.0f, 0.0f};
+    };
+
+    struct Prediction {
+        double targetTime;
+        HeadPose predicted;
+        HeadPose source;
+    };
+
+    bool hasPose = false;
+    bool hasLatency = false;
+    double lastTime = 0.0;
+    HeadPose lastPose;
+    glm::vec3 linearVelocity{0.0f};
+    glm::vec3 angularVelocity{0.0f}; // axis * radians per second
+
+    std::array<Prediction, POSE_PREDICTOR_MAX_PENDING> pending;
+    uint32_t pendingStart = 0;
+    uint32_t pendingCount = 0;
+
+    static HeadPose getHeadPose(const VRCamera &cameras);
+    void addErrorSample(const Prediction &prediction, const HeadPose &actual);
+};
+
+} // namespace quasar
+
+#endif // POSE_PREDICTOR_H
@@ -0,0 +1,44 @@
+#ifndef PROGRAM_BINARY_CACHE_H
+#define PROGRAM_BINARY_CACHE_H
+
+#include <string>
+#include <cstdint>
+
+namespace quasar {
+
+// Caches linked programs on disk (glGetProgramBinary/glProgramBinary), so later launches don't compile and link
+// the same shaders again: QUASAR's kernels, materials and the PBR shaders used by Model as well as the client's own.
+//
+// QUASAR's Shader and ComputeShader compile and link in their constructors, so the cache sits underneath them:
+// with QUEST_CLIENT_PROGRAM_BINARY_CACHE, the library is linked with --wrap for glCompileShader, glGetShaderiv,
+// glDeleteShader and glLinkProgram, which only reaches QUASAR while it is a static library (checked at configure).
+// A shader whose source (including its #version line and defines) belongs to a cached program isn't compiled, and
+// linking a program loads its binary instead. Entries are keyed by the shader sources and the driver's vendor,
+// renderer and version strings. If the driver rejects a binary, the shaders are
+// compiled and linked as usual and the entry is replaced.
+//
+// Cold compiles use KHR_parallel_shader_compile where available: compile status isn't waited on until link,
+// so a program's stages compile concurrently. Compile errors are then logged when the link fails.
+class ProgramBinaryCache {
+public:
+    struct Stats {
+        uint64_t hits = 0;
+        uint64_t misses = 0;
+        // Binaries the driver didn't accept (e.g. after a driver update with the same version string)
+        uint64_t rejected = 0;
+        // Time spent in glLinkProgram, including loading binaries and compiles deferred to link
+        double linkTimeMs = 0.0;
+    };
+
+    // Caches programs linked from now on in directory, which is created if needed. GL is only queried on the first
+    // compile, so this can be called before the context is created. Does nothing without QUEST_CLIENT_PROGRAM_BINARY_CACHE.
+    static void enable(const std::string &directory);
+
+    static bool isEnabled();
+
+    static Stats getStats();
+};
+
+} // namespace quasar
+
+#endif // PROGRAM_BINARY_CACHE_H
@@ -0,0 +1,72 @@
+#ifndef QUALITY_GOVERNOR_H
+#define QUALITY_GOVERNOR_H
+
+#include <cstdint>
+
+namespace quasar {
+
+// Picks a streaming quality level from the CPU, GPU and decode times of each frame and the number of missed
+// display refreshes, against the frame budget (the display period). Level 0 is full quality; the app maps
+// levels to its knobs (surfel size, stream frame rate, ...).
+//
+// Steps down after a short run of frames over budget, or at once on repeated missed frames, and steps up only
+// after a long run with headroom. Changes are followed by a cooldown so the level doesn't oscillate.
+class QualityGovernor {
+public:
+    struct Params {
+        uint32_t numLevels = 4;
+        // Fractions of the frame budget
+        float stepDownThreshold = 0.9f;
+        float stepUpThreshold = 0.65f;
+        // Consecutive frames over/under the thresholds needed to change level
+        uint32_t stepDownFrames = 15;
+        uint32_t stepUpFrames = 180;
+        // Missed frames within stepDownFrames that step down without waiting for the full run
+        uint32_t maxMissedFrames = 3;
+        // Frames to wait after a change before changing again
+        uint32_t cooldownFrames = 90;
+        // Weight of the newest sample in the smoothed times
+        float smoothing = 0.1f;
+    } params;
+
+    struct Sample {
+        double cpuTimeMs = 0.0;
+        // Negative if there is no new GPU result this frame; the smoothed GPU time is kept as is
+        double gpuTimeMs = -1.0;
+        double decodeTimeMs = 0.0;
+        uint32_t missedFrames = 0;
+    };
+
+    struct Stats {
+        double smoothedCPUTimeMs = 0.0;
+        double smoothedGPUTimeMs = 0.0;
+        double smoothedDecodeTimeMs = 0.0;
+        // Slowest of the smoothed times over the budget
+        double load = 0.0;
+        uint64_t missedFrames = 0;
+        uint64_t stepDowns = 0;
+        uint64_t stepUps = 0;
+    } stats;
+
+    QualityGovernor() = default;
+    QualityGovernor(const Params &params) : params(params) {}
+
+    uint32_t getLevel() const { return level; }
+
+    // Feeds the measurements of one frame. Returns true if the level changed.
+    bool update(const Sample &sample, double frameBudgetMs);
+
+private:
+    uint32_t level = 0;
+    uint32_t framesSinceChange = 0;
+    uint32_t overBudgetFrames = 0;
+    uint32_t headroomFrames = 0;
+    uint32_t recentMissedFrames = 0;
+    uint32_t missedWindowFrames = 0;
+    bool hasSample = false;
+    bool hasGPUSample = false;
+};
+
+} // namespace quasar
+
+#endif // QUALITY_GOVERNOR_H
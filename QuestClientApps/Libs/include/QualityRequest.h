@@ -0,0 +1,52 @@
+#ifndef QUALITY_REQUEST_H
+#define QUALITY_REQUEST_H
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+namespace quasar {
+
+// Message the client sends the server to change the quality of the streams it receives.
+// This header has no GL or network dependencies so a server (or a local stand-in) can parse the requests.
+
+#pragma pack(push, 1)
+struct QualityRequest {
+    static constexpr uint32_t MAGIC = 0x31525151; // "QQR1"
+
+    uint32_t magic = MAGIC;
+    // Increases with every request; the server only applies the newest one
+    uint32_t sequence = 0;
+    // Governor level the request was made for, 0 is full quality
+    uint32_t level = 0;
+    uint32_t videoWidth = 0;
+    uint32_t videoHeight = 0;
+    // Depth stream is videoSize / depthFactor
+    uint32_t depthFactor = 0;
+    // Frames per second the server should stream at, 0 leaves it unchanged
+    float frameRate = 0.0f;
+
+    void serialize(std::vector<char> &data) const {
+        data.resize(sizeof(QualityRequest));
+        std::memcpy(data.data(), this, sizeof(QualityRequest));
+    }
+
+    // Returns false if data doesn't hold a request
+    bool deserialize(const std::vector<char> &data) {
+        QualityRequest request;
+        if (data.size() < sizeof(QualityRequest)) {
+            return false;
+        }
+        std::memcpy(&request, data.data(), sizeof(QualityRequest));
+        if (request.magic != MAGIC) {
+            return false;
+        }
+        *this = request;
+        return true;
+    }
+};
+#pragma pack(pop)
+
+} // namespace quasar
+
+#endif // QUALITY_REQUEST_H
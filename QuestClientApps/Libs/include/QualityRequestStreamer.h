@@ -0,0 +1,33 @@
+#ifndef QUALITY_REQUEST_STREAMER_H
+#define QUALITY_REQUEST_STREAMER_H
+
+#include <string>
+#include <vector>
+
+#include <DataStreamerTCP.h>
+
+#include <QualityRequest.h>
+
+namespace quasar {
+
+// Sends QualityRequests to the server. Requests are only sent when the quality changes, so this uses
+// its own reliable channel next to the pose stream rather than the pose packets.
+class QualityRequestStreamer {
+public:
+    QualityRequestStreamer(const std::string &receiverURL);
+    ~QualityRequestStreamer() = default;
+
+    // Fills in the sequence number and sends the request
+    void send(QualityRequest request);
+
+    uint32_t getNumRequestsSent() const { return sequence; }
+
+private:
+    DataStreamerTCP streamer;
+    uint32_t sequence = 0;
+    std::vector<char> data;
+};
+
+} // namespace quasar
+
+#endif // QUALITY_REQUEST_STREAMER_H
@@ -0,0 +1,89 @@
+#ifndef RENDER_QUEUE_H
+#define RENDER_QUEUE_H
+
+#include <vector>
+
+#include <Scene.h>
+#include <Cameras/Camera.h>
+#include <Cameras/VRCamera.h>
+#include <Primitives/Mesh.h>
+#include <Primitives/Model.h>
+#include <RenderStats.h>
+
+#include <MeshLOD.h>
+
+namespace quasar {
+
+// Flattens the visible nodes of a scene (including the nodes inside models) into a list of mesh draws,
+// and submits them sorted by shader, material and mesh so consecutive draws share as much state as possible.
+//
+// A draw binds its material (program, textures, lights and per-mesh uniforms) only when the mesh or material
+// differs from the previous draw; repeats of the same mesh with the same material (e.g. instanced props in a
+// GLB) only update the model matrix. They are still separate draw calls: QUASAR's material shaders read the
+// model matrix from a uniform, so they can't be drawn with glDrawElementsInstanced.
+//
+// Subtrees with draw flags the queue doesn't reproduce (wireframe, points and lines) are not queued; the
+// renderer draws them with its per-node path after the queue (getPassthroughNodes()).
+class RenderQueue {
+public:
+    // What draw() actually submitted in the last frame
+    struct Stats {
+        uint32_t drawCalls = 0;
+        uint32_t shaderChanges = 0;
+        // Full material binds (the draws that started a new mesh or material)
+        uint32_t materialBinds = 0;
+        // Draws that only updated the model matrix
+        uint32_t transformOnlyDraws = 0;
+        uint32_t passthroughNodes = 0;
+        // What the same draws would have cost in scene graph order, without sorting (counted by build())
+        uint32_t unsortedShaderChanges = 0;
+        uint32_t unsortedMaterialBinds = 0;
+    } stats;
+
+    struct PassthroughNode {
+        Node* node;
+        glm::mat4 parentTransform;
+        const Material* overrideMaterial;
+    };
+
+    // If set, every mesh is swapped for the level of detail that fits its projected size.
+    MeshLOD* meshLOD = nullptr;
+
+    RenderQueue() = default;
+    ~RenderQueue() = default;
+
+    void build(const Scene &scene, const Camera &camera);
+    RenderStats draw(const Scene &scene, const Camera &camera);
+
+    const std::vector<PassthroughNode> &getPassthroughNodes() const { return passthroughNodes; }
+
+private:
+    struct DrawItem {
+        Mesh* mesh;
+        const Material* material;
+        const Material* overrideMaterial;
+        const Shader* shader;
+        glm::mat4 model;
+        bool frustumCulled;
+        // Position in scene graph order, so sorting keeps it within a group
+        uint32_t order;
+    };
+    // Reused across frames to avoid reallocating
+    std::vector<DrawItem> drawItems;
+    std::vector<PassthroughNode> passthroughNodes;
+
+    glm::vec3 eyePosition{0.0f};
+    float projectionScale = 1.0f;
+
+    void addNode(Node* node, const glm::mat4 &parentTransform, const Material* overrideMaterial);
+    void addEntity(Entity* entity, const Node* node, const glm::mat4 &model, const Material* overrideMaterial);
+
+    // Whether draw() can skip binding b's material after drawing a
+    static bool sharesBinding(const DrawItem &a, const DrawItem &b) {
+        return a.mesh == b.mesh && a.material == b.material && a.overrideMaterial == b.overrideMaterial;
+    }
+};
+
+} // namespace quasar
+
+#endif // RENDER_QUEUE_H
@@ -0,0 +1,106 @@
+#ifndef RESOURCE_LOADER_H
+#define RESOURCE_LOADER_H
+
+#include <deque>
+#include <mutex>
+#include <unordered_map>
+#include <thread>
+#include <functional>
+#include <condition_variable>
+
+#include <EGL/egl.h>
+#include <gfxwrapper_opengl.h>
+
+#include <Primitives/Model.h>
+
+#include <VertexLayout.h>
+
+namespace quasar {
+
+// Loads resources on a worker thread that has its own GL context, shared with the render context,
+// so the frame loop keeps running while models and textures load and upload.
+//
+// Each job's load function runs on the worker with the upload context current. A fence is inserted after it,
+// and once the GPU has passed the fence the job's onReady function runs on the render thread (from update()),
+// which is where the results get attached to the scene.
+//
+// Buffers, textures and programs are shared between the contexts; vertex arrays and framebuffers are not.
+// Meshes created on the worker have to be adopted (adoptModel, adoptMeshes) before the render context draws them.
+class ResourceLoader {
+public:
+    struct Stats {
+        uint64_t jobsLoaded = 0;
+        uint64_t jobsReady = 0;
+        double lastLoadTimeMs = 0.0;
+    };
+
+    ResourceLoader(EGLDisplay display, EGLConfig config, EGLContext shareContext);
+    ~ResourceLoader();
+
+    ResourceLoader(const ResourceLoader&) = delete;
+    ResourceLoader& operator=(const ResourceLoader&) = delete;
+
+    bool isSupported() const { return context != EGL_NO_CONTEXT; }
+
+    // Queues a job. If the upload context couldn't be created, both functions run right away on the calling thread.
+    // Jobs queued after shutdown() are dropped.
+    void enqueue(std::function<void()> load, std::function<void()> onReady = nullptr);
+
+    // Runs onReady for the jobs whose GL work has completed. Call once per frame on the render thread.
+    void update();
+
+    // Drops the queued jobs and waits for the one loading to finish, so no job outlives what it captured.
+    // Call on the render thread before tearing down anything the jobs use. Safe to call more than once.
+    void shutdown();
+
+    // The mesh that replaced each adopted one
+    using AdoptedMeshes = std::unordered_map<const Mesh*, Mesh*>;
+
+    // Recreates meshes created on the worker on the calling (render) context and deletes the originals on the worker.
+    // The new meshes are filled from the originals' shared buffers with GPU copies, so nothing is read back, and take
+    // over their materials. Meshes not in layouts hold Vertex. Call from onReady.
+    AdoptedMeshes adoptMeshes(const std::vector<Mesh*> &meshes, const VertexLayouts &layouts = {});
+    // Adopts the meshes of a model loaded on the worker and puts the new ones in its nodes
+    AdoptedMeshes adoptModel(Model &model, const VertexLayouts &layouts = {});
+
+    // True if no job is queued, loading or waiting on its fence
+    bool isIdle();
+
+    Stats getStats();
+
+private:
+    struct Job {
+        std::function<void()> load;
+        std::function<void()> onReady;
+        GLsync fence = 0;
+    };
+
+    EGLDisplay display = EGL_NO_DISPLAY;
+    EGLContext context = EGL_NO_CONTEXT;
+    EGLSurface surface = EGL_NO_SURFACE;
+
+    // Set by the worker once it has tried to make the upload context current
+    enum class WorkerState {
+        STARTING,
+        RUNNING,
+        FAILED
+    };
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable cv;
+    WorkerState workerState = WorkerState::STARTING;
+    bool shouldStop = false;
+
+    std::deque<Job> queuedJobs;
+    std::deque<Job> loadedJobs;
+    bool loading = false;
+
+    Stats stats;
+
+    void run();
+};
+
+} // namespace quasar
+
+#endif // RESOURCE_LOADER_H
@@ -0,0 +1,104 @@
+#ifndef SHADOW_CACHE_H
+#define SHADOW_CACHE_H
+
+#include <memory>
+#include <vector>
+
+#include <Scene.h>
+#include <Shaders/Shader.h>
+
+namespace quasar {
+
+// Splits the directional light's shadow map into a cached static part and a per-frame dynamic part.
+//
+// The directional shadow map depends only on the light and the casters, not on the viewer. Static casters are
+// rendered once, when the light or static geometry changes (signalled with invalidate()), and the result is
+// copied aside. When a dynamic caster moves, only the dynamic casters are rendered and the cached static depth
+// is merged back in with a depth-only full screen pass. Dynamic casters are the nodes with an animation and
+// the movingNodes, with everything below them.
+//
+// QUASAR's shadow pass always draws the whole scene, so each pass hides the other set of casters through
+// Node::visible and restores it afterwards. Static meshes on the nodes above a dynamic caster are drawn in
+// both passes, which is harmless since the merge keeps the nearest depth.
+//
+// If the shadow map's depth attachment can't be copied (not a texture), the split is disabled and the whole
+// map is re-rendered whenever anything changes.
+class ShadowCache {
+public:
+    struct Stats {
+        uint64_t staticUpdates = 0;
+        uint64_t dynamicUpdates = 0;
+        uint64_t skipped = 0;
+    } stats;
+
+    // What has to be rendered into the shadow map this frame
+    struct Passes {
+        bool staticCasters = false;
+        bool dynamicCasters = false;
+    };
+
+    // Re-render the dynamic casters at most every N frames (1 = every frame they move)
+    uint32_t dynamicUpdateInterval = 1;
+
+    // Nodes that move without an animation (e.g. controllers), treated as dynamic casters
+    std::vector<const Node*> movingNodes;
+
+    ShadowCache() = default;
+    ~ShadowCache() = default;
+
+    // Call when static geometry is added, removed or moved.
+    void invalidate() { dirty = true; }
+
+    Passes plan(const Scene &scene);
+
+    // Hide one set of casters for the next shadow pass. restoreVisibility() undoes either.
+    void hideDynamicCasters();
+    void hideStaticCasters();
+    void restoreVisibility();
+
+    // With the shadow map's framebuffer bound: keep a copy of its depth after the static pass, and merge that
+    // copy into it after the dynamic pass. storeStaticMap() returns false (and disables the split) if the
+    // depth attachment can't be copied.
+    bool storeStaticMap();
+    void compositeStaticMap();
+
+    // Releases the GL objects. Call while the context is current.
+    void destroy();
+
+private:
+    bool dirty = true;
+    bool splitSupported = true;
+    uint32_t framesSinceDynamicUpdate = 0;
+
+    bool hasLight = false;
+    glm::vec3 lightDirection;
+    float lightDistance;
+    float lightOrthoBoxSize;
+
+    // Each dynamic caster with its ancestors, root first, so its world transform is recomputed
+    // every frame without walking the whole scene
+    std::vector<std::vector<const Node*>> dynamicCasters;
+    std::vector<const Node*> currPath;
+    std::vector<glm::mat4> dynamicCasterTransforms;
+    std::vector<glm::mat4> currTransforms;
+
+    // Subtrees holding only static casters, hidden for the dynamic pass
+    std::vector<const Node*> staticSubtrees;
+    // Nodes hidden for the current pass, to be made visible again
+    std::vector<Node*> hiddenNodes;
+
+    GLuint staticDepthTexture = 0;
+    GLint staticDepthWidth = 0;
+    GLint staticDepthHeight = 0;
+    GLint staticDepthFormat = 0;
+    std::unique_ptr<Shader> compositeShader;
+
+    void collectDynamicCasters(const Node* node);
+    void collectStaticSubtrees(const Scene &scene);
+    bool lightChanged(const Scene &scene);
+    void hide(const Node* node);
+};
+
+} // namespace quasar
+
+#endif // SHADOW_CACHE_H
@@ -0,0 +1,58 @@
+#ifndef STEREO_CAMERA_BUFFER_H
+#define STEREO_CAMERA_BUFFER_H
+
+#include <Cameras/VRCamera.h>
+
+#include <UniformBuffer.h>
+
+#define STEREO_CAMERA_BINDING_POINT 5
+
+namespace quasar {
+
+// Per-eye camera matrices as a std140 uniform block, for client shaders that declare:
+//
+//   layout(std140) uniform StereoCamera {
+//       mat4 view[2];
+//       mat4 projection[2];
+//       mat4 viewProjection[2];
+//   };
+//
+// Update it once per frame after the views are located; every pass that attaches it then reads the
+// same matrices from one buffer instead of setting them by name.
+struct StereoCameraBlock {
+    glm::mat4 view[2];
+    glm::mat4 projection[2];
+    glm::mat4 viewProjection[2];
+};
+
+class StereoCameraBuffer : public UniformBuffer<StereoCameraBlock> {
+public:
+    StereoCameraBuffer() : UniformBuffer<StereoCameraBlock>(STEREO_CAMERA_BINDING_POINT) {}
+
+    // The binding point is fixed, so shaders can be attached before any buffer exists
+    static void attach(const ShaderBase &shader) {
+        GLuint blockIndex = glGetUniformBlockIndex(shader.ID, "StereoCamera");
+        if (blockIndex != GL_INVALID_INDEX) {
+            glUniformBlockBinding(shader.ID, blockIndex, STEREO_CAMERA_BINDING_POINT);
+        }
+    }
+
+    void update(const VRCamera &cameras) {
+        const PerspectiveCamera* eyes[2] = { &cameras.left, &cameras.right };
+        for (int eye = 0; eye < 2; eye++) {
+            block.view[eye] = eyes[eye]->getViewMatrix();
+            block.projection[eye] = eyes[eye]->getProjectionMatrix();
+            block.viewProjection[eye] = block.projection[eye] * block.view[eye];
+        }
+        UniformBuffer<StereoCameraBlock>::update(block);
+    }
+
+    const StereoCameraBlock &getBlock() const { return block; }
+
+private:
+    StereoCameraBlock block{};
+};
+
+} // namespace quasar
+
+#endif // STEREO_CAMERA_BUFFER_H
@@ -0,0 +1,75 @@
+#ifndef STREAM_RECORDER_H
+#define STREAM_RECORDER_H
+
+#include <chrono>
+#include <deque>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+#include <condition_variable>
+
+#include <PoseStreamer.h>
+#include <Cameras/VRCamera.h>
+
+#include <StreamRecording.h>
+
+namespace quasar {
+
+// Records the streams a client receives, with their arrival times, into one file (see StreamRecording.h)
+// that StreamReplayer can play back without a server.
+//
+// Records are timestamped on the calling thread and written by a writer thread, so receiver threads
+// never wait on the file.
+class StreamRecorder {
+public:
+    struct Stats {
+        uint64_t records = 0;
+        uint64_t bytes = 0;
+    };
+
+    StreamRecorder(const std::string &path);
+    ~StreamRecorder();
+
+    StreamRecorder(const StreamRecorder&) = delete;
+    StreamRecorder& operator=(const StreamRecorder&) = delete;
+
+    bool isOpen() const { return file.is_open(); }
+
+    // Thread safe
+    void write(StreamChannel channel, const char* data, size_t size);
+    void write(StreamChannel channel, const std::vector<char> &data) { write(channel, data.data(), data.size()); }
+
+    // Records the pose a streamed frame was rendered for, once per pose id
+    void writePoseAck(pose_id_t poseID, const Pose &pose, double elapsedTimeMs);
+    // Records the head pose sent to the server
+    void writeSentPose(const VRCamera &camera);
+
+    Stats getStats();
+
+private:
+    struct Record {
+        StreamRecordHeader header;
+        std::vector<char> payload;
+    };
+
+    std::ofstream file;
+    std::chrono::steady_clock::time_point startTime;
+
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable cv;
+    bool shouldStop = false;
+    std::deque<Record> records;
+
+    std::unordered_set<pose_id_t> ackedPoses;
+
+    Stats stats;
+
+    void run();
+};
+
+} // namespace quasar
+
+#endif // STREAM_RECORDER_H
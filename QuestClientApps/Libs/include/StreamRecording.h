@@ -0,0 +1,61 @@
+#ifndef STREAM_RECORDING_H
+#define STREAM_RECORDING_H
+
+#include <cstdint>
+
+namespace quasar {
+
+// Container for recorded streaming sessions (StreamRecorder, StreamReplayer): a file header followed by
+// records in arrival order, each a record header and its payload.
+// This header has no GL or network dependencies so recordings can be inspected with host tools.
+
+enum class StreamChannel : uint8_t {
+    // Datagrams of the color stream, as received by VideoTexture
+    VIDEO = 0,
+    // Bytes of the raw BC4 depth stream, as received by BC4DepthVideoTexture (TCP, so chunks don't follow packets)
+    DEPTH_STREAM = 1,
+    // Whole packets of the temporal BC4 depth stream, as received by BC4DeltaDepthReceiver
+    DEPTH_PACKETS = 2,
+    // A streamed frame's pose id resolved to the pose it was rendered for: int64 pose id, double elapsed
+    // time in ms, then the Pose as laid out in memory (its size is in the file header)
+    POSE_ACK = 3,
+    // Head pose sent to the server: StreamSentPose
+    POSE_SENT = 4,
+
+    NUM_CHANNELS
+};
+
+#pragma pack(push, 1)
+struct StreamFileHeader {
+    static constexpr uint32_t MAGIC = 0x31525351; // "QSR1"
+    static constexpr uint32_t VERSION = 1;
+
+    uint32_t magic = MAGIC;
+    uint32_t version = VERSION;
+    // sizeof(Pose) of the build that recorded, POSE_ACK records can only be replayed by builds that match
+    uint32_t poseSize = 0;
+    uint32_t reserved = 0;
+};
+
+struct StreamRecordHeader {
+    // Larger than any record the recorder writes (datagrams and TCP reads are at most 64KB, depth packets
+    // a compressed frame), so a corrupt size is caught before it is allocated
+    static constexpr uint32_t MAX_SIZE = 64 * 1024 * 1024;
+
+    // Arrival time since the start of the recording
+    uint64_t timeUs = 0;
+    uint32_t size = 0;
+    StreamChannel channel = StreamChannel::VIDEO;
+    uint8_t reserved[3] = {0, 0, 0};
+};
+
+struct StreamSentPose {
+    // Column major view matrices of both eyes
+    float viewLeft[16];
+    float viewRight[16];
+};
+#pragma pack(pop)
+
+} // namespace quasar
+
+#endif // STREAM_RECORDING_H
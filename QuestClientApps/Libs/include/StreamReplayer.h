@@ -0,0 +1,97 @@
+#ifndef STREAM_REPLAYER_H
+#define STREAM_REPLAYER_H
+
+#include <array>
+#include <fstream>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+#include <PoseStreamer.h>
+
+#include <StreamRecording.h>
+
+namespace quasar {
+
+// Plays back a session recorded by StreamRecorder in place of the server.
+//
+// The replay clock only advances in update(), by the given delta time scaled by the replay speed, and every
+// record up to it is handed to its channel's sink on the calling thread. Driven by the frame loop's delta time,
+// a replay under the headless runtime's simulated clock hands the same records to the sinks on the same frames
+// on every run. What the app sees is not exactly repeatable: sinks that go through a StreamTap reach the
+// receiver's own thread and decoder, so a frame can become ready a frame earlier or later than on another run.
+class StreamReplayer {
+public:
+    struct Params {
+        // 2 replays twice as fast as recorded
+        float speed = 1.0f;
+        // Start over at the end of the recording
+        bool loop = false;
+    };
+
+    struct Stats {
+        uint64_t records = 0;
+        uint64_t bytes = 0;
+        uint32_t loops = 0;
+    };
+
+    using Sink = std::function<void(const std::vector<char>&)>;
+
+    StreamReplayer(const std::string &path) : StreamReplayer(path, Params()) {}
+    StreamReplayer(const std::string &path, const Params &params);
+    ~StreamReplayer() = default;
+
+    StreamReplayer(const StreamReplayer&) = delete;
+    StreamReplayer& operator=(const StreamReplayer&) = delete;
+
+    bool isOpen() const { return file.is_open(); }
+
+    // Records of channels without a sink are skipped
+    void setSink(StreamChannel channel, Sink sink);
+
+    // Advances the replay clock by dt (seconds) times the replay speed and plays every record up to it
+    void update(double dt);
+
+    // True once every record has been played (never when looping)
+    bool isFinished() const { return finished; }
+
+    // Looks up the pose a streamed frame was rendered for. Replaces PoseStreamer::getPose(), since the poses
+    // were sent by the recording session. All pose acks are read up front, as a frame can arrive before its ack.
+    bool getPose(pose_id_t poseID, Pose* pose, double* elapsedTimeMs) const;
+
+    const Stats &getStats() const { return stats; }
+
+private:
+    struct PoseAck {
+        Pose pose;
+        double elapsedTimeMs;
+    };
+
+    Params params;
+    Stats stats;
+
+    std::ifstream file;
+    std::streampos firstRecord;
+    uint32_t recordedPoseSize = 0;
+
+    std::array<Sink, static_cast<size_t>(StreamChannel::NUM_CHANNELS)> sinks;
+    std::unordered_map<pose_id_t, PoseAck> poseAcks;
+
+    // Replay clock and the offset of the current loop, in microseconds
+    double timeUs = 0.0;
+    double loopOffsetUs = 0.0;
+
+    StreamRecordHeader nextHeader;
+    std::vector<char> nextPayload;
+    bool hasNext = false;
+    bool finished = false;
+
+    // Known channel, and a size its records can have
+    bool isValidHeader(const StreamRecordHeader &header) const;
+    bool readRecord(StreamRecordHeader &header, std::vector<char> &payload);
+    void readPoseAcks();
+};
+
+} // namespace quasar
+
+#endif // STREAM_REPLAYER_H
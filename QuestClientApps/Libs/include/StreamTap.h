@@ -0,0 +1,78 @@
+#ifndef STREAM_TAP_H
+#define STREAM_TAP_H
+
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <StreamRecorder.h>
+
+namespace quasar {
+
+// Stands in for the server in front of a QUASAR receiver that opens its own socket (VideoTexture,
+// BC4DepthVideoTexture), since those can't be handed data directly. The receiver is pointed at getLocalURL(),
+// on the loopback interface.
+//
+// Recording: relays the server's stream to the receiver and records it on the way.
+// Replay: the receiver gets whatever deliver() is handed (from StreamReplayer) and there is no server. Delivery is
+// as fast as deliver() is called; a receiver that falls behind a burst of UDP datagrams drops some, as it would
+// from a server.
+//
+// UDP taps are for streams the client listens for (the server sends to remoteURL's port), TCP taps for streams
+// the client connects to remoteURL for. Bytes are relayed as they come, so the stream's framing doesn't matter.
+class StreamTap {
+public:
+    enum class Protocol {
+        UDP,
+        TCP
+    };
+
+    // Records the stream of remoteURL into recorder
+    StreamTap(Protocol protocol, const std::string &remoteURL, StreamRecorder &recorder, StreamChannel channel);
+    // Replays into the receiver
+    StreamTap(Protocol protocol);
+    ~StreamTap();
+
+    StreamTap(const StreamTap&) = delete;
+    StreamTap& operator=(const StreamTap&) = delete;
+
+    // URL to create the receiver with. Call right before creating it: for UDP this frees the port for the receiver.
+    std::string getLocalURL();
+
+    // Replay: sends data to the receiver (queued until a TCP receiver has connected)
+    void deliver(const std::vector<char> &data);
+
+private:
+    Protocol protocol;
+    StreamRecorder* recorder = nullptr;
+    StreamChannel channel = StreamChannel::VIDEO;
+
+    std::string remoteHost;
+    uint16_t remotePort = 0;
+    uint16_t localPort = 0;
+
+    // UDP: bound to remotePort when recording, connected to the receiver when replaying. TCP: listens on localPort.
+    int socketFD = -1;
+    // UDP: holds localPort until the receiver is created
+    int reservedFD = -1;
+    bool warnedRefused = false;
+
+    std::thread thread;
+    std::atomic<bool> running = true;
+
+    std::mutex mutex;
+    std::deque<std::vector<char>> pending;
+
+    bool openSockets();
+    void runUDP();
+    void runTCP();
+    // Relays between the receiver and the server (recording) or sends pending data to the receiver (replay)
+    void serveTCP(int clientFD);
+};
+
+} // namespace quasar
+
+#endif // STREAM_TAP_H
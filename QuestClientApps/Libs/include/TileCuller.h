@@ -0,0 +1,71 @@
+#ifndef TILE_CULLER_H
+#define TILE_CULLER_H
+
+#include <Buffer.h>
+#include <Shaders/ComputeShader.h>
+#include <Primitives/Mesh.h>
+
+#include <UniformLocation.h>
+#include <StereoCameraBuffer.h>
+
+#define TILE_CULL_TRIANGLES_PER_TILE 256
+#define TILE_CULL_MAX_GROUPS_X 65535
+
+namespace quasar {
+
+// GPU culling for meshes generated on the GPU in grid order (MeshWarp grids).
+//
+// update() splits the generated index buffer into tiles of TILE_CULL_TRIANGLES_PER_TILE consecutive
+// triangles, keeps a copy of the indices and computes a bounding box per tile. Tiles follow index buffer
+// order only: the MeshWarp grid writes each cell's triangles at the cell's row-major position, so a tile
+// there is a strip of 128 cells along a grid row (wrapping onto the next row at most once). Meshes whose
+// triangles are appended in arbitrary order (e.g. MeshFromQuads' atomic appends) get tiles with loose
+// bounds that rarely cull.
+// cull() then rewrites the mesh's index buffer and indirect draw command with only the tiles that
+// are inside either eye's frustum. The mesh must be created with indirectDraw = true. cull() writes
+// in place, so a mesh that an earlier draw may still be reading has to be fenced first (see FencedRing).
+class TileCuller {
+public:
+    // vertexSize is in bytes; the position must be the first attribute of the vertex.
+    TileCuller(uint maxIndices, uint vertexSize);
+    ~TileCuller() = default;
+
+    // Call after the mesh has been (re)generated. numIndices < 0 takes the count from the mesh's draw command.
+    void update(const Mesh &mesh, int numIndices = -1);
+    // Call once per frame, after the camera buffer is updated and before drawing.
+    void cull(const Mesh &mesh, const StereoCameraBuffer &cameraBuffer, const glm::mat4 &model = glm::mat4(1.0f));
+
+    uint getNumTiles() const { return numTiles; }
+
+private:
+    struct Tile {
+        glm::vec4 aabbMin;
+        glm::vec4 aabbMax;
+    };
+
+    uint numTiles;
+    uint vertexStride;
+    glm::uvec2 numGroups;
+
+    Buffer sourceIndexBuffer;
+    Buffer tileBuffer;
+
+    ComputeShader tileBoundsShader;
+    ComputeShader tileCullShader;
+
+    // Resolved once in the constructor
+    struct {
+        UniformLocation numIndices;
+        UniformLocation numTiles;
+        UniformLocation vertexStride;
+    } boundsUniforms;
+    struct {
+        UniformLocation resetCommand;
+        UniformLocation numTiles;
+        UniformLocation model;
+    } cullUniforms;
+};
+
+} // namespace quasar
+
+#endif // TILE_CULLER_H
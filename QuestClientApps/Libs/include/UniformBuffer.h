@@ -0,0 +1,53 @@
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+#include <string>
+
+#include <Shaders/Shader.h>
+
+namespace quasar {
+
+// A uniform block backed by a single buffer. T must match the block's std140 layout
+// (use glm::mat4/glm::vec4 members, pad scalars to vec4). update() uploads the whole block with one call.
+template <typename T>
+class UniformBuffer {
+public:
+    UniformBuffer(GLuint bindingPoint) : bindingPoint(bindingPoint) {
+        glGenBuffers(1, &ID);
+        glBindBuffer(GL_UNIFORM_BUFFER, ID);
+        glBufferData(GL_UNIFORM_BUFFER, sizeof(T), nullptr, GL_DYNAMIC_DRAW);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+    ~UniformBuffer() {
+        glDeleteBuffers(1, &ID);
+    }
+
+    UniformBuffer(const UniformBuffer&) = delete;
+    UniformBuffer& operator=(const UniformBuffer&) = delete;
+
+    // Points the shader's uniform block at this buffer's binding point. Only needs to be done once per shader.
+    void attach(const ShaderBase &shader, const std::string &blockName) const {
+        GLuint blockIndex = glGetUniformBlockIndex(shader.ID, blockName.c_str());
+        if (blockIndex != GL_INVALID_INDEX) {
+            glUniformBlockBinding(shader.ID, blockIndex, bindingPoint);
+        }
+    }
+
+    void update(const T &data) {
+        glBindBuffer(GL_UNIFORM_BUFFER, ID);
+        glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(T), &data);
+        glBindBuffer(GL_UNIFORM_BUFFER, 0);
+    }
+
+    // Binds the buffer to its binding point. Other code may use the same point, so bind before each draw.
+    void bind() const {
+        glBindBufferBase(GL_UNIFORM_BUFFER, bindingPoint, ID);
+    }
+
+    GLuint ID = 0;
+    GLuint bindingPoint;
+};
+
+} // namespace quasar
+
+#endif // UNIFORM_BUFFER_H
@@ -0,0 +1,39 @@
+#ifndef UNIFORM_LOCATION_H
+#define UNIFORM_LOCATION_H
+
+#include <glm/glm.hpp>
+#include <glm/gtc/type_ptr.hpp>
+
+#include <Shaders/Shader.h>
+
+namespace quasar {
+
+// A uniform's location, looked up once after the shader is linked. The shader's set*(name, value) calls
+// look the name up on every call, which adds up for per-frame parameters across passes and eyes.
+// Like those calls, set() writes to the currently bound program, so bind the shader first.
+// Uniforms the compiler optimized out have location -1, which GL ignores.
+class UniformLocation {
+public:
+    UniformLocation() = default;
+    UniformLocation(const ShaderBase &shader, const char* name)
+        : location(glGetUniformLocation(shader.ID, name)) {}
+
+    void set(bool value) const { glUniform1i(location, static_cast<GLint>(value)); }
+    void set(int value) const { glUniform1i(location, value); }
+    void set(uint value) const { glUniform1ui(location, value); }
+    void set(float value) const { glUniform1f(location, value); }
+    void set(const glm::vec2 &value) const { glUniform2fv(location, 1, glm::value_ptr(value)); }
+    void set(const glm::vec3 &value) const { glUniform3fv(location, 1, glm::value_ptr(value)); }
+    void set(const glm::vec4 &value) const { glUniform4fv(location, 1, glm::value_ptr(value)); }
+    void set(const glm::mat3 &value) const { glUniformMatrix3fv(location, 1, GL_FALSE, glm::value_ptr(value)); }
+    void set(const glm::mat4 &value) const { glUniformMatrix4fv(location, 1, GL_FALSE, glm::value_ptr(value)); }
+    void set(const glm::ivec4* values, GLsizei count) const { glUniform4iv(location, count, glm::value_ptr(values[0])); }
+
+    bool isActive() const { return location >= 0; }
+
+    GLint location = -1;
+};
+
+} // namespace quasar
+
+#endif // UNIFORM_LOCATION_H
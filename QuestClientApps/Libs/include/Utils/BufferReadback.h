@@ -0,0 +1,42 @@
+#ifndef BUFFER_READBACK_H
+#define BUFFER_READBACK_H
+
+#include <cstring>
+
+#include <gfxwrapper_opengl.h>
+
+namespace quasar {
+
+// Load time helpers for GL buffers. readBuffer maps the buffer and stalls, so keep it out of frames.
+
+inline GLint64 getBufferSize(GLuint buffer) {
+    GLint64 size = 0;
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    glGetBufferParameteri64v(GL_COPY_READ_BUFFER, GL_BUFFER_SIZE, &size);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    return size;
+}
+
+// Copies on the GPU; nothing waits for it
+inline void copyBuffer(GLuint source, GLuint destination, GLint64 size) {
+    glBindBuffer(GL_COPY_READ_BUFFER, source);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, destination);
+    glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, size);
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    glBindBuffer(GL_COPY_WRITE_BUFFER, 0);
+}
+
+inline bool readBuffer(GLuint buffer, void* data, GLint64 size) {
+    glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+    const void* mapped = glMapBufferRange(GL_COPY_READ_BUFFER, 0, size, GL_MAP_READ_BIT);
+    if (mapped != nullptr) {
+        std::memcpy(data, mapped, size);
+        glUnmapBuffer(GL_COPY_READ_BUFFER);
+    }
+    glBindBuffer(GL_COPY_READ_BUFFER, 0);
+    return mapped != nullptr;
+}
+
+} // namespace quasar
+
+#endif // BUFFER_READBACK_H
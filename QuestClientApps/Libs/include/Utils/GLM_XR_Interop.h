@@ -68,6 +68,26 @@ glm::mat4 toGLM(const XrFovf& fov, GraphicsAPI_Type graphicsApi, float nearZ = 0
     return result;
 }
 
+inline XrPosef toXr(const glm::mat4 &transform) {
+    glm::quat orientation = glm::quat_cast(glm::mat3(transform));
+    glm::vec3 position = glm::vec3(transform[3]);
+
+    XrPosef pose;
+    pose.orientation = { orientation.x, orientation.y, orientation.z, orientation.w };
+    pose.position = { position.x, position.y, position.z };
+    return pose;
+}
+
+// Inverse of toGLM(XrFovf) for OpenGL style projection matrices.
+inline XrFovf toXrFov(const glm::mat4 &projection) {
+    const float tanAngleRight = (projection[2][0] + 1.0f) / projection[0][0];
+    const float tanAngleLeft = (projection[2][0] - 1.0f) / projection[0][0];
+    const float tanAngleUp = (projection[2][1] + 1.0f) / projection[1][1];
+    const float tanAngleDown = (projection[2][1] - 1.0f) / projection[1][1];
+
+    return { atanf(tanAngleLeft), atanf(tanAngleRight), atanf(tanAngleUp), atanf(tanAngleDown) };
+}
+
 } // namespace gxi
 
 } // namespace quasar
@@ -0,0 +1,22 @@
+#ifndef VERTEX_LAYOUT_H
+#define VERTEX_LAYOUT_H
+
+#include <vector>
+#include <unordered_map>
+
+#include <Primitives/Mesh.h>
+
+namespace quasar {
+
+// Size and attributes of a mesh's vertices. Mesh doesn't report its own, so code that recreates meshes
+// (ResourceLoader::adoptModel) is told the layout of meshes that don't hold Vertex.
+struct VertexLayout {
+    uint vertexSize = sizeof(Vertex);
+    std::vector<VertexInputAttribute> attributes = Vertex::getVertexInputAttributes();
+};
+
+using VertexLayouts = std::unordered_map<const Mesh*, VertexLayout>;
+
+} // namespace quasar
+
+#endif // VERTEX_LAYOUT_H
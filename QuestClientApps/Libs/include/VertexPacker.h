@@ -0,0 +1,127 @@
+#ifndef VERTEX_PACKER_H
+#define VERTEX_PACKER_H
+
+#include <memory>
+#include <cstddef>
+#include <vector>
+
+#include <Buffer.h>
+#include <Shaders/ComputeShader.h>
+#include <Primitives/Mesh.h>
+#include <Primitives/Model.h>
+
+#include <UniformLocation.h>
+#include <VertexLayout.h>
+
+#define VERTEX_PACKER_MAX_ATTRIBUTES 8
+
+namespace quasar {
+
+// Formats of the packed attributes. Normals and tangents are always snorm 10:10:10:2.
+struct PackedVertexFormat {
+    enum class Position : uint8_t {
+        HALF_FLOAT, // relative to the box center; keeps the same relative precision at any distance
+        SNORM16     // quantized over the box; uniform precision, for meshes with known bounds
+    };
+    enum class TexCoords : uint8_t {
+        UNORM16,    // for texture coordinates in [0, 1]
+        HALF_FLOAT  // for tiling texture coordinates
+    };
+
+    Position position = Position::HALF_FLOAT;
+    TexCoords texCoords = TexCoords::UNORM16;
+};
+
+// Byte offsets of each attribute in the unpacked vertex, -1 if the vertex doesn't have it.
+// Attributes of the vertex that aren't listed here are copied as they are.
+struct VertexSemantics {
+    int position = 0;
+    int color = -1;
+    int normal = -1;
+    int texCoords = -1;
+    int tangent = -1;
+
+    static VertexSemantics forVertex() {
+        return {
+            .position = static_cast<int>(offsetof(Vertex, position)),
+            .color = static_cast<int>(offsetof(Vertex, color)),
+            .normal = static_cast<int>(offsetof(Vertex, normal)),
+            .texCoords = static_cast<int>(offsetof(Vertex, texCoords)),
+            .tangent = static_cast<int>(offsetof(Vertex, tangent))
+        };
+    }
+};
+
+// Packs float vertices into a smaller layout with the same attribute locations, so existing shaders read
+// them unchanged (the GL converts normalized and half float attributes on fetch).
+//
+// Positions are stored relative to a box; the node drawing the packed mesh has to apply getDequantizeTransform().
+// With SNORM16 it scales by the half extents, and that scale ends up in the node's normal matrix too: for a flat
+// mesh one extent is ~0, and the inverse transpose blows up along it. Pass a cube to setBounds() for lit meshes.
+// Layouts are driven by the source's vertex attributes, so this works for Vertex, QuadVertex or any float vertex.
+class VertexPacker {
+public:
+    VertexPacker(uint sourceVertexSize, const std::vector<VertexInputAttribute> &sourceAttributes,
+                 const VertexSemantics &semantics, const PackedVertexFormat &format = {});
+    ~VertexPacker() = default;
+
+    // Size of a packed vertex in bytes, and its attributes for creating the packed mesh
+    uint getVertexSize() const { return packedStride * sizeof(uint32_t); }
+    const std::vector<VertexInputAttribute> &getAttributes() const { return packedAttributes; }
+
+    void setBounds(const glm::vec3 &center, const glm::vec3 &halfExtent);
+    glm::mat4 getDequantizeTransform() const;
+
+    // Packs on the CPU
+    void pack(const void* vertices, uint numVertices, void* packedVertices) const;
+    // Packs the first numVertices of source into the vertex buffer of packedMesh on the GPU
+    void pack(const Buffer &source, uint numVertices, const Mesh &packedMesh);
+
+    // Replaces every mesh of a loaded model with a packed copy (GLB import) and deletes the originals. Positions are
+    // quantized over each mesh's bounding cube, with the dequantization in a child node so the node hierarchy is
+    // untouched. The scale is uniform so normals transformed by the node stay correct.
+    // Returns the layout of every packed mesh, for ResourceLoader::adoptModel if this ran on its worker.
+    static VertexLayouts packModel(Model &model, const PackedVertexFormat &format = {});
+
+private:
+    enum class Op : int {
+        COPY = 0,
+        POSITION = 1,
+        DIRECTION = 2,
+        TEXCOORDS = 3,
+        COLOR = 4
+    };
+    struct Attribute {
+        Op op;
+        int sourceOffset; // in words
+        int packedOffset; // in words
+        int components;
+    };
+
+    PackedVertexFormat format;
+    uint sourceStride; // in words
+    uint packedStride; // in words
+    std::vector<Attribute> attributes;
+    std::vector<VertexInputAttribute> packedAttributes;
+
+    glm::vec3 boxCenter{0.0f};
+    glm::vec3 boxHalfExtent{1.0f};
+
+    // Created on first GPU use, along with its uniform locations
+    std::unique_ptr<ComputeShader> packShader;
+    struct {
+        UniformLocation numVertices;
+        UniformLocation sourceStride;
+        UniformLocation packedStride;
+        UniformLocation numOps;
+        UniformLocation ops;
+        UniformLocation positionSnorm16;
+        UniformLocation texCoordsHalfFloat;
+        UniformLocation boxCenter;
+        UniformLocation boxInvHalfExtent;
+    } packUniforms;
+};
+
+} // namespace quasar
+
+#endif // VERTEX_PACKER_H
@@ -0,0 +1,82 @@
+#include <new>
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+
+#include <AllocationTracker.h>
+
+using namespace quasar;
+
+#ifdef QUEST_CLIENT_TRACK_ALLOCATIONS
+
+static thread_local AllocationTracker::Counts threadCounts;
+static std::atomic<uint64_t> totalAllocations{0};
+static std::atomic<uint64_t> totalBytes{0};
+
+static void* trackedAlloc(std::size_t size, std::size_t alignment, bool throwOnFailure) {
+    threadCounts.allocations++;
+    threadCounts.bytes += size;
+    totalAllocations.fetch_add(1, std::memory_order_relaxed);
+    totalBytes.fetch_add(size, std::memory_order_relaxed);
+
+    if (size == 0) {
+        size = 1;
+    }
+    void* ptr = nullptr;
+    if (alignment <= alignof(std::max_align_t)) {
+        ptr = std::malloc(size);
+    }
+    else if (posix_memalign(&ptr, alignment, size) != 0) {
+        ptr = nullptr;
+    }
+    if (ptr == nullptr && throwOnFailure) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new(std::size_t size) { return trackedAlloc(size, 0, true); }
+void* operator new[](std::size_t size) { return trackedAlloc(size, 0, true); }
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept { return trackedAlloc(size, 0, false); }
+void* operator new[](std::size_t size, const std::nothrow_t&) noexcept { return trackedAlloc(size, 0, false); }
+void* operator new(std::size_t size, std::align_val_t alignment) { return trackedAlloc(size, static_cast<std::size_t>(alignment), true); }
+void* operator new[](std::size_t size, std::align_val_t alignment) { return trackedAlloc(size, static_cast<std::size_t>(alignment), true); }
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete[](void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, const std::nothrow_t&) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete(void* ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+void operator delete[](void* ptr, std::size_t, std::align_val_t) noexcept { std::free(ptr); }
+
+bool AllocationTracker::isEnabled() {
+    return true;
+}
+
+AllocationTracker::Counts AllocationTracker::getThreadCounts() {
+    return threadCounts;
+}
+
+AllocationTracker::Counts AllocationTracker::getTotalCounts() {
+    return { totalAllocations.load(std::memory_order_relaxed), totalBytes.load(std::memory_order_relaxed) };
+}
+
+#else
+
+bool AllocationTracker::isEnabled() {
+    return false;
+}
+
+AllocationTracker::Counts AllocationTracker::getThreadCounts() {
+    return {};
+}
+
+AllocationTracker::Counts AllocationTracker::getTotalCounts() {
+    return {};
+}
+
+#endif
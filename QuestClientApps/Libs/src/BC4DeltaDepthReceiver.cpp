@@ -0,0 +1,142 @@
+#include <spdlog/spdlog.h>
+
+#include <BC4DeltaDepthReceiver.h>
+
+using namespace quasar;
+
+BC4DeltaDepthReceiver::BC4DeltaDepthReceiver(const glm::uvec2 &size, const std::string &streamerURL, JobSystem &jobSystem,
+                                             StreamRecorder* recorder)
+        : width(size.x)
+        , height(size.y)
+        , bc4CompressedBuffer(GL_SHADER_STORAGE_BUFFER, (size.x / 8) * (size.y / 8), sizeof(BC4Block), nullptr, GL_DYNAMIC_DRAW)
+        , frameSize((size.x / 8) * (size.y / 8) * sizeof(BC4Block))
+        , recorder(recorder)
+        , decoder(frameSize)
+        , jobSystem(jobSystem) {
+    if (!streamerURL.empty()) {
+        connection = std::make_unique<Connection>(streamerURL, *this);
+    }
+}
+
+BC4DeltaDepthReceiver::~BC4DeltaDepthReceiver() {
+    // No packets arrive after this
+    connection.reset();
+
+    JobSystem::JobHandle pendingJob;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        running = false;
+        pendingJob = decodeJob;
+    }
+    // The job stops at its next packet
+    if (pendingJob) {
+        jobSystem.wait(pendingJob);
+    }
+}
+
+void BC4DeltaDepthReceiver::Connection::onDataReceived(const std::vector<char> &data) {
+    if (owner.recorder != nullptr) {
+        owner.recorder->write(StreamChannel::DEPTH_PACKETS, data);
+    }
+    owner.receive(data);
+}
+
+void BC4DeltaDepthReceiver::receive(const std::vector<char> &data) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (!running) {
+        return;
+    }
+
+    stats.framesReceived++;
+    // If the decoder falls behind, drop the backlog instead of growing without bound. The delta frames that
+    // follow no longer chain onto the last decoded frame, so the decoder skips them until the next key frame.
+    if (packets.size() >= maxQueuedPackets) {
+        spdlog::warn("BC4 depth decoder is falling behind, dropping {} queued packets", packets.size());
+        stats.framesDropped += packets.size();
+        packets.clear();
+    }
+    packets.push_back(data);
+
+    if (!decodeScheduled) {
+        decodeScheduled = true;
+        decodeJob = jobSystem.submit("BC4 depth decode", [this]() { decodePackets(); });
+    }
+}
+
+void BC4DeltaDepthReceiver::decodePackets() {
+    std::vector<uint8_t> frame;
+    while (true) {
+        std::vector<char> packet;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!running || packets.empty()) {
+                decodeScheduled = false;
+                break;
+            }
+            packet = std::move(packets.front());
+            packets.pop_front();
+
+            if (!freeFrames.empty()) {
+                frame = std::move(freeFrames.back());
+                freeFrames.pop_back();
+            }
+        }
+
+        int64_t poseID = -1;
+        BC4DeltaDecoder::Result result = decoder.decode(packet.data(), packet.size(), frame, &poseID);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        if (result != BC4DeltaDecoder::Result::OK || frame.size() != frameSize) {
+            stats.framesDropped++;
+            continue;
+        }
+
+        stats.framesDecoded++;
+        stats.compressionRatio = decoder.stats.compressionRatio();
+        stats.timeToDecodeMs = decoder.stats.lastTimeMs;
+
+        decodedFrames.push_back({ static_cast<pose_id_t>(poseID), std::move(frame) });
+        while (decodedFrames.size() > maxDecodedFrames) {
+            freeFrames.push_back(std::move(decodedFrames.front().blocks));
+            decodedFrames.pop_front();
+        }
+        frame = {};
+    }
+}
+
+pose_id_t BC4DeltaDepthReceiver::draw(pose_id_t poseID) {
+    std::lock_guard<std::mutex> lock(mutex);
+    if (decodedFrames.empty()) {
+        return lastPoseID;
+    }
+
+    // Prefer the frame rendered for the requested pose, so color and depth stay paired
+    auto frameIt = decodedFrames.end() - 1;
+    if (poseID != -1) {
+        for (auto it = decodedFrames.begin(); it != decodedFrames.end(); it++) {
+            if (it->poseID == poseID) {
+                frameIt = it;
+                break;
+            }
+        }
+    }
+
+    bc4CompressedBuffer.bind();
+    glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, frameSize, frameIt->blocks.data());
+    bc4CompressedBuffer.unbind();
+    lastPoseID = frameIt->poseID;
+
+    // Frames up to and including the uploaded one are no longer needed
+    auto end = frameIt + 1;
+    for (auto it = decodedFrames.begin(); it != end; it++) {
+        freeFrames.push_back(std::move(it->blocks));
+    }
+    decodedFrames.erase(decodedFrames.begin(), end);
+
+    return lastPoseID;
+}
+
+BC4DeltaDepthReceiver::Stats BC4DeltaDepthReceiver::getStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
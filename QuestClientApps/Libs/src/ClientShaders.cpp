@@ -0,0 +1,366 @@
+#include <ClientShaders.h>
+
+const char SHADER_CLIENT_TILE_BOUNDS_COMP[] = R"(
+layout(local_size_x = TRIANGLES_PER_TILE) in;
+
+struct Tile {
+    vec4 aabbMin; // w = number of triangles in the tile
+    vec4 aabbMax;
+};
+
+layout(std430, binding = 0) readonly buffer VertexBuffer {
+    float vertices[];
+};
+
+layout(std430, binding = 1) readonly buffer IndexBuffer {
+    uint indices[];
+};
+
+// DrawElementsIndirectCommand: count, instanceCount, firstIndex, baseVertex, baseInstance
+layout(std430, binding = 2) readonly buffer CommandBuffer {
+    uint command[];
+};
+
+layout(std430, binding = 3) writeonly buffer SourceIndexBuffer {
+    uint sourceIndices[];
+};
+
+layout(std430, binding = 4) writeonly buffer TileBuffer {
+    Tile tiles[];
+};
+
+uniform int numIndices; // < 0: take the index count from the draw command
+uniform int numTiles;
+uniform int vertexStride; // in floats, position is the first attribute
+
+shared uint tileMin[3];
+shared uint tileMax[3];
+
+// Maps a float to a uint with the same ordering, so bounds can be reduced with integer atomics
+uint floatToOrdered(float f) {
+    uint u = floatBitsToUint(f);
+    return ((u & 0x80000000u) != 0u) ? ~u : (u | 0x80000000u);
+}
+
+float orderedToFloat(uint u) {
+    return uintBitsToFloat(((u & 0x80000000u) != 0u) ? (u & 0x7FFFFFFFu) : ~u);
+}
+
+void main() {
+    uint tileIndex = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+    uint localIndex = gl_LocalInvocationID.x;
+    uint firstTriangle = tileIndex * uint(TRIANGLES_PER_TILE);
+    uint triangle = firstTriangle + localIndex;
+
+    uint indexCount = (numIndices < 0) ? command[0] : uint(numIndices);
+    uint numTriangles = indexCount / 3u;
+
+    if (localIndex == 0u) {
+        for (int i = 0; i < 3; i++) {
+            tileMin[i] = 0xFFFFFFFFu;
+            tileMax[i] = 0u;
+        }
+    }
+    barrier();
+
+    if (tileIndex < uint(numTiles) && triangle < numTriangles) {
+        for (uint i = 0u; i < 3u; i++) {
+            uint index = indices[3u * triangle + i];
+            sourceIndices[3u * triangle + i] = index;
+
+            uint base = index * uint(vertexStride);
+            vec3 position = vec3(vertices[base], vertices[base + 1u], vertices[base + 2u]);
+            for (int c = 0; c < 3; c++) {
+                atomicMin(tileMin[c], floatToOrdered(position[c]));
+                atomicMax(tileMax[c], floatToOrdered(position[c]));
+            }
+        }
+    }
+    barrier();
+
+    if (localIndex == 0u && tileIndex < uint(numTiles)) {
+        uint count = (firstTriangle < numTriangles) ? min(uint(TRIANGLES_PER_TILE), numTriangles - firstTriangle) : 0u;
+        vec3 aabbMin = vec3(orderedToFloat(tileMin[0]), orderedToFloat(tileMin[1]), orderedToFloat(tileMin[2]));
+        vec3 aabbMax = vec3(orderedToFloat(tileMax[0]), orderedToFloat(tileMax[1]), orderedToFloat(tileMax[2]));
+        tiles[tileIndex] = Tile(vec4(aabbMin, float(count)), vec4(aabbMax, 0.0));
+    }
+}
+)";
+const unsigned int SHADER_CLIENT_TILE_BOUNDS_COMP_len = sizeof(SHADER_CLIENT_TILE_BOUNDS_COMP) - 1;
+
+const char SHADER_CLIENT_TILE_CULL_COMP[] = R"(
+layout(local_size_x = TRIANGLES_PER_TILE) in;
+
+struct Tile {
+    vec4 aabbMin; // w = number of triangles in the tile
+    vec4 aabbMax;
+};
+
+layout(std430, binding = 0) readonly buffer SourceIndexBuffer {
+    uint sourceIndices[];
+};
+
+layout(std430, binding = 1) writeonly buffer IndexBuffer {
+    uint indices[];
+};
+
+// DrawElementsIndirectCommand: count, instanceCount, firstIndex, baseVertex, baseInstance
+layout(std430, binding = 2) buffer CommandBuffer {
+    uint command[];
+};
+
+layout(std430, binding = 3) readonly buffer TileBuffer {
+    Tile tiles[];
+};
+
+// StereoCameraBuffer
+layout(std140) uniform StereoCamera {
+    mat4 view[2];
+    mat4 projection[2];
+    mat4 viewProjection[2];
+};
+
+uniform bool resetCommand;
+uniform int numTiles;
+uniform mat4 model;
+
+shared bool tileVisible;
+shared uint tileTriangles;
+shared uint outputOffset;
+
+// True if every corner of the box is outside the same clip plane
+bool outsideFrustum(mat4 mvp, vec3 aabbMin, vec3 aabbMax) {
+    int outside[6] = int[6](0, 0, 0, 0, 0, 0);
+    for (int i = 0; i < 8; i++) {
+        vec3 corner = mix(aabbMin, aabbMax, vec3(float(i & 1), float((i >> 1) & 1), float((i >> 2) & 1)));
+        vec4 clip = mvp * vec4(corner, 1.0);
+        outside[0] += (clip.x < -clip.w) ? 1 : 0;
+        outside[1] += (clip.x >  clip.w) ? 1 : 0;
+        outside[2] += (clip.y < -clip.w) ? 1 : 0;
+        outside[3] += (clip.y >  clip.w) ? 1 : 0;
+        outside[4] += (clip.z < -clip.w) ? 1 : 0;
+        outside[5] += (clip.z >  clip.w) ? 1 : 0;
+    }
+    for (int p = 0; p < 6; p++) {
+        if (outside[p] == 8) return true;
+    }
+    return false;
+}
+
+void main() {
+    uint tileIndex = gl_WorkGroupID.y * gl_NumWorkGroups.x + gl_WorkGroupID.x;
+    uint localIndex = gl_LocalInvocationID.x;
+
+    if (localIndex == 0u) {
+        tileVisible = false;
+        tileTriangles = 0u;
+        outputOffset = 0u;
+
+        if (resetCommand) {
+            if (tileIndex == 0u) {
+                command[0] = 0u;
+                command[1] = 1u;
+                command[2] = 0u;
+                command[3] = 0u;
+                command[4] = 0u;
+            }
+        }
+        else if (tileIndex < uint(numTiles)) {
+            Tile tile = tiles[tileIndex];
+            uint count = uint(tile.aabbMin.w);
+            bool visible = !outsideFrustum(viewProjection[0] * model, tile.aabbMin.xyz, tile.aabbMax.xyz) ||
+                           !outsideFrustum(viewProjection[1] * model, tile.aabbMin.xyz, tile.aabbMax.xyz);
+            if (count > 0u && visible) {
+                tileVisible = true;
+                tileTriangles = count;
+                outputOffset = atomicAdd(command[0], 3u * count);
+            }
+        }
+    }
+    barrier();
+
+    if (tileVisible && localIndex < tileTriangles) {
+        uint src = 3u * (tileIndex * uint(TRIANGLES_PER_TILE) + localIndex);
+        uint dst = outputOffset + 3u * localIndex;
+        indices[dst + 0u] = sourceIndices[src + 0u];
+        indices[dst + 1u] = sourceIndices[src + 1u];
+        indices[dst + 2u] = sourceIndices[src + 2u];
+    }
+}
+)";
+const unsigned int SHADER_CLIENT_TILE_CULL_COMP_len = sizeof(SHADER_CLIENT_TILE_CULL_COMP) - 1;
+
+// Single pass stereo ATW. Both eyes are drawn in one draw call with GL_OVR_multiview; the per-view
+// matrices come from one uniform block indexed by gl_ViewID_OVR.
+const char SHADER_CLIENT_ATW_MULTIVIEW_VERT[] = R"(
+layout(num_views = 2) in;
+
+layout(location = 0) in vec3 aPos;
+layout(location = 1) in vec2 aTexCoords;
+
+out vec2 TexCoords;
+flat out uint ViewID;
+
+void main() {
+    TexCoords = aTexCoords;
+    ViewID = gl_ViewID_OVR;
+    gl_Position = vec4(aPos.xy, 0.0, 1.0);
+}
+)";
+const unsigned int SHADER_CLIENT_ATW_MULTIVIEW_VERT_len = sizeof(SHADER_CLIENT_ATW_MULTIVIEW_VERT) - 1;
+
+const char SHADER_CLIENT_ATW_MULTIVIEW_FRAG[] = R"(
+layout(std140) uniform ATWViews {
+    mat4 projectionInverse[2];
+    mat4 remoteFromLocal[2];     // rotation from the local view into the remote view
+    mat4 remoteProjection[2];
+    ivec4 flags;                 // x = atwEnabled
+};
+
+uniform sampler2D videoTexture; // left and right eye side by side
+
+in vec2 TexCoords;
+flat in uint ViewID;
+
+out vec4 FragColor;
+
+void main() {
+    int view = int(ViewID);
+
+    vec2 uv = TexCoords;
+    if (flags.x != 0) {
+        // Rotate the ray through this pixel into the remote view and find where the remote frame saw it
+        vec4 ray = projectionInverse[view] * vec4(TexCoords * 2.0 - 1.0, 1.0, 1.0);
+        vec3 remoteRay = mat3(remoteFromLocal[view]) * (ray.xyz / ray.w);
+        vec4 remoteClip = remoteProjection[view] * vec4(remoteRay, 1.0);
+        uv = (remoteClip.xy / remoteClip.w) * 0.5 + 0.5;
+
+        if (remoteClip.w <= 0.0 || any(lessThan(uv, vec2(0.0))) || any(greaterThan(uv, vec2(1.0)))) {
+            FragColor = vec4(0.0, 0.0, 0.0, 1.0);
+            return;
+        }
+    }
+
+    vec2 videoUV = vec2((uv.x + float(view)) * 0.5, uv.y);
+    FragColor = vec4(texture(videoTexture, videoUV).rgb, 1.0);
+}
+)";
+const unsigned int SHADER_CLIENT_ATW_MULTIVIEW_FRAG_len = sizeof(SHADER_CLIENT_ATW_MULTIVIEW_FRAG) - 1;
+
+const char SHADER_CLIENT_PACK_VERTICES_COMP[] = R"(
+layout(local_size_x = 256) in;
+
+#define OP_COPY 0
+#define OP_POSITION 1
+#define OP_DIRECTION 2
+#define OP_TEXCOORDS 3
+#define OP_COLOR 4
+
+#define MAX_OPS 8
+
+layout(std430, binding = 0) readonly buffer SourceVertexBuffer {
+    uint sourceWords[];
+};
+
+layout(std430, binding = 1) writeonly buffer PackedVertexBuffer {
+    uint packedWords[];
+};
+
+uniform int numVertices;
+uniform int sourceStride; // in words
+uniform int packedStride; // in words
+
+// One entry per attribute: op, source offset (words), packed offset (words), components
+uniform int numOps;
+uniform ivec4 ops[MAX_OPS];
+
+uniform bool positionSnorm16; // else half float
+uniform bool texCoordsHalfFloat; // else unorm16
+uniform vec3 boxCenter;
+uniform vec3 boxInvHalfExtent;
+
+float readFloat(uint base, int offset) {
+    return uintBitsToFloat(sourceWords[base + uint(offset)]);
+}
+
+// GL_INT_2_10_10_10_REV, normalized
+uint packSnorm1010102(vec4 v) {
+    ivec4 q = ivec4(round(clamp(v, -1.0, 1.0) * vec4(511.0, 511.0, 511.0, 1.0)));
+    return (uint(q.x) & 0x3FFu) | ((uint(q.y) & 0x3FFu) << 10) | ((uint(q.z) & 0x3FFu) << 20) | ((uint(q.w) & 0x3u) << 30);
+}
+
+void main() {
+    uint vertex = gl_GlobalInvocationID.y * (gl_NumWorkGroups.x * gl_WorkGroupSize.x) + gl_GlobalInvocationID.x;
+    if (vertex >= uint(numVertices)) {
+        return;
+    }
+
+    uint src = vertex * uint(sourceStride);
+    uint dst = vertex * uint(packedStride);
+
+    for (int i = 0; i < numOps; i++) {
+        int op = ops[i].x;
+        int srcOffset = ops[i].y;
+        uint dstOffset = dst + uint(ops[i].z);
+        int components = ops[i].w;
+
+        if (op == OP_POSITION) {
+            vec3 p = vec3(readFloat(src, srcOffset), readFloat(src, srcOffset + 1), readFloat(src, srcOffset + 2)) - boxCenter;
+            if (positionSnorm16) {
+                p *= boxInvHalfExtent;
+                packedWords[dstOffset] = packSnorm2x16(p.xy);
+                packedWords[dstOffset + 1u] = packSnorm2x16(vec2(p.z, 1.0));
+            }
+            else {
+                packedWords[dstOffset] = packHalf2x16(p.xy);
+                packedWords[dstOffset + 1u] = packHalf2x16(vec2(p.z, 1.0));
+            }
+        }
+        else if (op == OP_DIRECTION) {
+            vec4 d = vec4(readFloat(src, srcOffset), readFloat(src, srcOffset + 1), readFloat(src, srcOffset + 2), 0.0);
+            if (components > 3) {
+                d.w = sign(readFloat(src, srcOffset + 3));
+            }
+            float len = length(d.xyz);
+            d.xyz = (len > 0.0) ? d.xyz / len : d.xyz;
+            packedWords[dstOffset] = packSnorm1010102(d);
+        }
+        else if (op == OP_TEXCOORDS) {
+            vec2 uv = vec2(readFloat(src, srcOffset), readFloat(src, srcOffset + 1));
+            packedWords[dstOffset] = texCoordsHalfFloat ? packHalf2x16(uv) : packUnorm2x16(uv);
+        }
+        else if (op == OP_COLOR) {
+            vec4 c = vec4(readFloat(src, srcOffset), readFloat(src, srcOffset + 1), readFloat(src, srcOffset + 2), 1.0);
+            if (components > 3) {
+                c.a = readFloat(src, srcOffset + 3);
+            }
+            packedWords[dstOffset] = packUnorm4x8(c);
+        }
+        else {
+            for (int c = 0; c < components; c++) {
+                packedWords[dstOffset + uint(c)] = sourceWords[src + uint(srcOffset + c)];
+            }
+        }
+    }
+}
+)";
+const unsigned int SHADER_CLIENT_PACK_VERTICES_COMP_len = sizeof(SHADER_CLIENT_PACK_VERTICES_COMP) - 1;
+
+// Merges the cached static shadow depth into the shadow map. Drawn as one triangle covering the viewport,
+// with depth testing keeping the nearer of the static and dynamic depths.
+const char SHADER_CLIENT_SHADOW_COMPOSITE_VERT[] = R"(
+void main() {
+    vec2 position = vec2(float((gl_VertexID << 1) & 2), float(gl_VertexID & 2));
+    gl_Position = vec4(position * 2.0 - 1.0, 0.0, 1.0);
+}
+)";
+const unsigned int SHADER_CLIENT_SHADOW_COMPOSITE_VERT_len = sizeof(SHADER_CLIENT_SHADOW_COMPOSITE_VERT) - 1;
+
+const char SHADER_CLIENT_SHADOW_COMPOSITE_FRAG[] = R"(
+uniform highp sampler2D staticDepth;
+
+void main() {
+    gl_FragDepth = texelFetch(staticDepth, ivec2(gl_FragCoord.xy), 0).r;
+}
+)";
+const unsigned int SHADER_CLIENT_SHADOW_COMPOSITE_FRAG_len = sizeof(SHADER_CLIENT_SHADOW_COMPOSITE_FRAG) - 1;
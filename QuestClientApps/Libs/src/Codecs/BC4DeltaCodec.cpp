@@ -0,0 +1,149 @@
+#include <chrono>
+#include <cstring>
+
+#include <zstd.h>
+
+#include <Codecs/BC4DeltaCodec.h>
+
+using namespace quasar;
+
+namespace {
+
+double elapsedMillis(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+// dst = a ^ b, eight bytes at a time where possible.
+void xorFrames(const uint8_t* a, const uint8_t* b, uint8_t* dst, size_t size) {
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t wa, wb;
+        std::memcpy(&wa, a + i, sizeof(uint64_t));
+        std::memcpy(&wb, b + i, sizeof(uint64_t));
+        wa ^= wb;
+        std::memcpy(dst + i, &wa, sizeof(uint64_t));
+    }
+    for (; i < size; i++) {
+        dst[i] = a[i] ^ b[i];
+    }
+}
+
+} // namespace
+
+// BC4DeltaEncoder
+
+BC4DeltaEncoder::BC4DeltaEncoder(uint32_t keyFrameInterval, int compressionLevel)
+        : keyFrameInterval(keyFrameInterval)
+        , compressionLevel(compressionLevel)
+        , cctx(ZSTD_createCCtx()) {}
+
+BC4DeltaEncoder::~BC4DeltaEncoder() {
+    ZSTD_freeCCtx(cctx);
+}
+
+size_t BC4DeltaEncoder::encode(const void* frame, size_t frameSize, int64_t poseID, std::vector<char> &packet) {
+    auto startTime = std::chrono::steady_clock::now();
+
+    const uint8_t* frameBytes = static_cast<const uint8_t*>(frame);
+
+    bool keyFrame = keyFramePending || reference.size() != frameSize ||
+                    (keyFrameInterval > 0 && frameIndex % keyFrameInterval == 0);
+
+    const uint8_t* payload = frameBytes;
+    if (!keyFrame) {
+        residual.resize(frameSize);
+        xorFrames(frameBytes, reference.data(), residual.data(), frameSize);
+        payload = residual.data();
+    }
+
+    BC4DeltaFrameHeader header;
+    header.frameType = keyFrame ? BC4FrameType::KEY_FRAME : BC4FrameType::DELTA_FRAME;
+    header.frameIndex = frameIndex;
+    header.frameSize = static_cast<uint32_t>(frameSize);
+    header.poseID = poseID;
+
+    packet.resize(sizeof(BC4DeltaFrameHeader) + ZSTD_compressBound(frameSize));
+    size_t compressedSize = ZSTD_compressCCtx(cctx, packet.data() + sizeof(BC4DeltaFrameHeader), packet.size() - sizeof(BC4DeltaFrameHeader),
+                                              payload, frameSize, compressionLevel);
+    if (ZSTD_isError(compressedSize)) {
+        packet.clear();
+        return 0;
+    }
+    header.compressedSize = static_cast<uint32_t>(compressedSize);
+    std::memcpy(packet.data(), &header, sizeof(BC4DeltaFrameHeader));
+    packet.resize(sizeof(BC4DeltaFrameHeader) + compressedSize);
+
+    reference.assign(frameBytes, frameBytes + frameSize);
+    keyFramePending = false;
+    frameIndex++;
+
+    stats.framesCoded++;
+    stats.keyFrames += keyFrame ? 1 : 0;
+    stats.rawBytes += frameSize;
+    stats.codedBytes += packet.size();
+    stats.lastTimeMs = elapsedMillis(startTime);
+
+    return packet.size();
+}
+
+// BC4DeltaDecoder
+
+BC4DeltaDecoder::BC4DeltaDecoder(size_t expectedFrameSize)
+        : expectedFrameSize(expectedFrameSize)
+        , dctx(ZSTD_createDCtx()) {}
+
+BC4DeltaDecoder::~BC4DeltaDecoder() {
+    ZSTD_freeDCtx(dctx);
+}
+
+BC4DeltaDecoder::Result BC4DeltaDecoder::decode(const char* packet, size_t packetSize, std::vector<uint8_t> &frame, int64_t* poseID) {
+    auto startTime = std::chrono::steady_clock::now();
+
+    if (packetSize < sizeof(BC4DeltaFrameHeader)) {
+        return Result::CORRUPT;
+    }
+
+    BC4DeltaFrameHeader header;
+    std::memcpy(&header, packet, sizeof(BC4DeltaFrameHeader));
+    if (header.magic != BC4DeltaFrameHeader::MAGIC ||
+        packetSize < sizeof(BC4DeltaFrameHeader) + header.compressedSize ||
+        (expectedFrameSize != 0 && header.frameSize != expectedFrameSize)) {
+        return Result::CORRUPT;
+    }
+
+    bool keyFrame = header.frameType == BC4FrameType::KEY_FRAME;
+    if (!keyFrame) {
+        bool follows = hasReference && header.frameIndex == lastFrameIndex + 1 && reference.size() == header.frameSize;
+        if (!follows) {
+            hasReference = false;
+            return Result::WAITING_FOR_KEY_FRAME;
+        }
+    }
+
+    frame.resize(header.frameSize);
+    size_t decodedSize = ZSTD_decompressDCtx(dctx, frame.data(), frame.size(),
+                                             packet + sizeof(BC4DeltaFrameHeader), header.compressedSize);
+    if (ZSTD_isError(decodedSize) || decodedSize != header.frameSize) {
+        hasReference = false;
+        return Result::CORRUPT;
+    }
+
+    if (!keyFrame) {
+        xorFrames(frame.data(), reference.data(), frame.data(), frame.size());
+    }
+
+    reference = frame;
+    hasReference = true;
+    lastFrameIndex = header.frameIndex;
+    if (poseID != nullptr) {
+        *poseID = header.poseID;
+    }
+
+    stats.framesCoded++;
+    stats.keyFrames += keyFrame ? 1 : 0;
+    stats.rawBytes += header.frameSize;
+    stats.codedBytes += packetSize;
+    stats.lastTimeMs = elapsedMillis(startTime);
+
+    return Result::OK;
+}
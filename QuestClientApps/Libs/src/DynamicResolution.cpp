@@ -0,0 +1,47 @@
+#include <cmath>
+#include <algorithm>
+
+#include <DynamicResolution.h>
+
+using namespace quasar;
+
+bool DynamicResolution::update(double gpuTimeMs, double frameBudgetMs) {
+    if (!hasSample) {
+        stats.smoothedGPUTimeMs = gpuTimeMs;
+        hasSample = true;
+    }
+    else {
+        stats.smoothedGPUTimeMs += params.smoothing * (gpuTimeMs - stats.smoothedGPUTimeMs);
+    }
+
+    framesSinceChange++;
+    if (framesSinceChange < params.cooldownFrames || frameBudgetMs <= 0.0) {
+        return false;
+    }
+
+    float newScale = scale;
+    double load = stats.smoothedGPUTimeMs / frameBudgetMs;
+    if (load > params.scaleDownThreshold) {
+        // GPU time scales roughly with pixel count, i.e. with scale squared, so jump straight
+        // to the scale that should bring us back under the threshold
+        float target = scale * static_cast<float>(std::sqrt(params.scaleDownThreshold / load));
+        newScale = std::min(target, scale - params.scaleStep);
+    }
+    else if (load < params.scaleUpThreshold) {
+        newScale = scale + params.scaleStep;
+    }
+    newScale = std::clamp(newScale, params.minScale, params.maxScale);
+
+    if (std::abs(newScale - scale) < 1e-3f) {
+        return false;
+    }
+
+    if (newScale < scale) stats.scaleDowns++;
+    else stats.scaleUps++;
+
+    // Old samples were taken at the previous resolution
+    stats.smoothedGPUTimeMs *= (newScale * newScale) / (scale * scale);
+    scale = newScale;
+    framesSinceChange = 0;
+    return true;
+}
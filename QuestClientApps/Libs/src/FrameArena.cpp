@@ -0,0 +1,46 @@
+#include <algorithm>
+
+#include <FrameArena.h>
+
+using namespace quasar;
+
+FrameArena::FrameArena(size_t capacity) : block(new uint8_t[capacity]) {
+    stats.capacity = capacity;
+}
+
+void* FrameArena::allocate(size_t size, size_t alignment) {
+    uintptr_t base = reinterpret_cast<uintptr_t>(block.get());
+    uintptr_t aligned = (base + offset + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1);
+    size_t end = (aligned - base) + size;
+    if (end <= stats.capacity) {
+        offset = end;
+        stats.used = offset + overflowBytes;
+        return reinterpret_cast<void*>(aligned);
+    }
+
+    // Doesn't fit; serve it from the heap for this frame and grow the block on the next reset
+    stats.overflows++;
+    overflowBlocks.emplace_back(new uint8_t[size + alignment]);
+    overflowBytes += size + alignment;
+    stats.used = offset + overflowBytes;
+
+    uintptr_t overflowBase = reinterpret_cast<uintptr_t>(overflowBlocks.back().get());
+    return reinterpret_cast<void*>((overflowBase + alignment - 1) & ~(static_cast<uintptr_t>(alignment) - 1));
+}
+
+void FrameArena::reset() {
+    stats.highWater = std::max(stats.highWater, stats.used);
+
+    if (!overflowBlocks.empty()) {
+        overflowBlocks.clear();
+        overflowBytes = 0;
+
+        // Leave some headroom so a slightly bigger frame doesn't overflow again
+        size_t capacity = stats.highWater + stats.highWater / 2;
+        block.reset(new uint8_t[capacity]);
+        stats.capacity = capacity;
+    }
+
+    offset = 0;
+    stats.used = 0;
+}
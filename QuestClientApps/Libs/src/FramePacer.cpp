@@ -0,0 +1,117 @@
+#include <chrono>
+
+#include <spdlog/spdlog.h>
+
+#include <FramePacer.h>
+
+using namespace quasar;
+
+static double millisSince(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+FramePacer::FramePacer(XrSession session) : session(session) {}
+
+FramePacer::~FramePacer() {
+    stop();
+}
+
+void FramePacer::start() {
+    if (running) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        shouldStop = false;
+        canWait = true;
+        frameReady = false;
+        failed = false;
+    }
+    running = true;
+    thread = std::thread(&FramePacer::run, this);
+}
+
+void FramePacer::stop() {
+    if (!running) {
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        shouldStop = true;
+    }
+    cv.notify_all();
+
+    // If the thread is in xrWaitFrame, the previous frame has begun, so it returns within a display period
+    if (thread.joinable()) {
+        thread.join();
+    }
+    running = false;
+}
+
+bool FramePacer::acquireFrame(XrFrameState &frameState) {
+    auto start = std::chrono::steady_clock::now();
+
+    std::unique_lock<std::mutex> lock(mutex);
+    cv.wait(lock, [this] { return frameReady || shouldStop || failed; });
+    if (!frameReady) {
+        return false;
+    }
+
+    frameState = readyFrameState;
+    frameReady = false;
+    stats.timeBlockedMs = millisSince(start);
+    return true;
+}
+
+void FramePacer::frameBegun() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        canWait = true;
+    }
+    cv.notify_all();
+}
+
+FramePacer::Stats FramePacer::getStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+void FramePacer::run() {
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this] { return canWait || shouldStop; });
+            if (shouldStop) {
+                break;
+            }
+            canWait = false;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+
+        XrFrameState frameState{XR_TYPE_FRAME_STATE};
+        XrFrameWaitInfo frameWaitInfo{XR_TYPE_FRAME_WAIT_INFO};
+        XrResult result = xrWaitFrame(session, &frameWaitInfo, &frameState);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (!XR_SUCCEEDED(result)) {
+                spdlog::error("FramePacer: xrWaitFrame failed ({})", static_cast<int>(result));
+                failed = true;
+            }
+            else {
+                readyFrameState = frameState;
+                frameReady = true;
+                stats.framesWaited++;
+                stats.timeInWaitFrameMs = millisSince(start);
+            }
+        }
+        cv.notify_all();
+
+        if (!XR_SUCCEEDED(result)) {
+            break;
+        }
+    }
+}
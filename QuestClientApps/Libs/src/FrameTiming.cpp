@@ -0,0 +1,83 @@
+#include <algorithm>
+
+#include <FrameTiming.h>
+
+using namespace quasar;
+
+static double millisBetween(std::chrono::steady_clock::time_point start, std::chrono::steady_clock::time_point end) {
+    return std::chrono::duration<double, std::milli>(end - start).count();
+}
+
+void FrameTiming::Histogram::add(double ms) {
+    uint32_t bucket = static_cast<uint32_t>(std::max(ms, 0.0) / BUCKET_MS);
+    buckets[std::min(bucket, NUM_BUCKETS - 1)]++;
+    count++;
+    sum += ms;
+    max = std::max(max, ms);
+}
+
+double FrameTiming::Histogram::getPercentile(double p) const {
+    if (count == 0) {
+        return 0.0;
+    }
+
+    uint64_t target = static_cast<uint64_t>(std::clamp(p, 0.0, 1.0) * (count - 1)) + 1;
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < NUM_BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= target) {
+            // The overflow bucket has no upper edge
+            return (i == NUM_BUCKETS - 1) ? max : (i + 1) * BUCKET_MS;
+        }
+    }
+    return max;
+}
+
+void FrameTiming::beginWait() {
+    waitStart = Clock::now();
+}
+
+void FrameTiming::beginWork(int64_t predictedDisplayTime, int64_t displayPeriod) {
+    workStart = Clock::now();
+
+    current = {};
+    current.index = frameIndex++;
+    current.predictedDisplayTime = predictedDisplayTime;
+    current.displayPeriod = displayPeriod;
+    current.waitTimeMs = millisBetween(waitStart, workStart);
+
+    // Refreshes between the previous frame's display time and this one's got no new frame
+    deltaTime = 0.0;
+    if (lastPredictedDisplayTime != 0) {
+        int64_t gap = predictedDisplayTime - lastPredictedDisplayTime;
+        deltaTime = gap / 1e+9;
+        stats.displayIntervalMs.add(gap / 1e+6);
+        if (displayPeriod > 0 && gap > displayPeriod) {
+            current.missedFrames = static_cast<uint32_t>((gap + displayPeriod / 2) / displayPeriod - 1);
+        }
+    }
+    lastPredictedDisplayTime = predictedDisplayTime;
+}
+
+void FrameTiming::beginSubmit() {
+    submitStart = Clock::now();
+    current.workTimeMs = millisBetween(workStart, submitStart);
+}
+
+void FrameTiming::endFrame(bool rendered) {
+    current.submitTimeMs = millisBetween(submitStart, Clock::now());
+    current.rendered = rendered;
+    current.late = current.displayPeriod > 0 &&
+                   (current.workTimeMs + current.submitTimeMs) > current.displayPeriod / 1e+6;
+
+    stats.frames++;
+    stats.missedFrames += current.missedFrames;
+    if (current.late) {
+        stats.lateFrames++;
+    }
+    stats.waitTimeMs.add(current.waitTimeMs);
+    stats.workTimeMs.add(current.workTimeMs);
+    stats.submitTimeMs.add(current.submitTimeMs);
+
+    last = current;
+}
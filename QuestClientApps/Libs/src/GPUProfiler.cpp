@@ -0,0 +1,204 @@
+#include <cstring>
+#include <algorithm>
+
+#include <spdlog/spdlog.h>
+
+#include <GPUProfiler.h>
+
+#ifndef GL_QUERY_COUNTER_BITS_EXT
+#define GL_QUERY_COUNTER_BITS_EXT 0x8864
+#endif
+#ifndef GL_TIMESTAMP_EXT
+#define GL_TIMESTAMP_EXT 0x8E28
+#endif
+#ifndef GL_GPU_DISJOINT_EXT
+#define GL_GPU_DISJOINT_EXT 0x8FBB
+#endif
+
+using namespace quasar;
+
+GPUProfiler::GPUProfiler() {
+    const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+    if (extensions == nullptr || strstr(extensions, "GL_EXT_disjoint_timer_query") == nullptr) {
+        spdlog::warn("GL_EXT_disjoint_timer_query is not supported, GPU timings are unavailable");
+        return;
+    }
+
+    glQueryCounterEXT_ = (PFNGLQUERYCOUNTEREXTPROC_)eglGetProcAddress("glQueryCounterEXT");
+    glGetQueryObjectui64vEXT_ = (PFNGLGETQUERYOBJECTUI64VEXTPROC_)eglGetProcAddress("glGetQueryObjectui64vEXT");
+    if (glQueryCounterEXT_ == nullptr || glGetQueryObjectui64vEXT_ == nullptr) {
+        spdlog::warn("Failed to load the timer query functions, GPU timings are unavailable");
+        return;
+    }
+
+    // Timestamps are optional in the extension, a GPU without them reports 0 bits
+    GLint timestampBits = 0;
+    glGetQueryiv(GL_TIMESTAMP_EXT, GL_QUERY_COUNTER_BITS_EXT, &timestampBits);
+    if (timestampBits == 0) {
+        spdlog::warn("GPU timestamp queries are not supported, GPU timings are unavailable");
+        return;
+    }
+
+    supported = true;
+}
+
+GPUProfiler::~GPUProfiler() {
+    for (auto &scope : scopes) {
+        glDeleteQueries(static_cast<GLsizei>(scope->queries.size()), scope->queries.data());
+    }
+}
+
+int GPUProfiler::findScope(const char* name) const {
+    for (size_t i = 0; i < scopes.size(); i++) {
+        if (scopes[i]->name == name) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
+
+int GPUProfiler::beginScope(const char* name) {
+    if (!supported) {
+        return -1;
+    }
+
+    int scopeIndex = findScope(name);
+    if (scopeIndex == -1) {
+        auto scope = std::make_unique<ScopeData>();
+        scope->name = name;
+        glGenQueries(static_cast<GLsizei>(scope->queries.size()), scope->queries.data());
+        scopes.push_back(std::move(scope));
+        scopeIndex = static_cast<int>(scopes.size()) - 1;
+    }
+
+    ScopeData &scope = *scopes[scopeIndex];
+    // Skip this measurement if the scope is already open, or every query is still waiting to be read back
+    if (scope.active || scope.writeIndex - scope.readIndex >= GPU_PROFILER_NUM_FRAMES) {
+        return -1;
+    }
+
+    uint32_t slot = scope.writeIndex % GPU_PROFILER_NUM_FRAMES;
+    glQueryCounterEXT_(scope.queries[2 * slot], GL_TIMESTAMP_EXT);
+    scope.active = true;
+
+    return scopeIndex;
+}
+
+void GPUProfiler::endScope(int scopeIndex) {
+    if (scopeIndex < 0) {
+        return;
+    }
+
+    ScopeData &scope = *scopes[scopeIndex];
+    uint32_t slot = scope.writeIndex % GPU_PROFILER_NUM_FRAMES;
+    glQueryCounterEXT_(scope.queries[2 * slot + 1], GL_TIMESTAMP_EXT);
+    scope.writeIndex++;
+    scope.active = false;
+}
+
+void GPUProfiler::collect(FrameArena &arena) {
+    if (!supported) {
+        return;
+    }
+
+    struct Result {
+        ScopeData* scope;
+        double elapsedMs;
+    };
+    Result* results = arena.allocate<Result>(scopes.size() * GPU_PROFILER_NUM_FRAMES);
+    size_t numResults = 0;
+
+    for (auto &scopePtr : scopes) {
+        ScopeData &scope = *scopePtr;
+        while (scope.readIndex != scope.writeIndex) {
+            uint32_t slot = scope.readIndex % GPU_PROFILER_NUM_FRAMES;
+
+            // The end timestamp is written last, so once it is available both are
+            GLuint available = GL_FALSE;
+            glGetQueryObjectuiv(scope.queries[2 * slot + 1], GL_QUERY_RESULT_AVAILABLE, &available);
+            if (available == GL_FALSE) {
+                break;
+            }
+
+            GLuint64 startNs = 0, endNs = 0;
+            glGetQueryObjectui64vEXT_(scope.queries[2 * slot], GL_QUERY_RESULT, &startNs);
+            glGetQueryObjectui64vEXT_(scope.queries[2 * slot + 1], GL_QUERY_RESULT, &endNs);
+            scope.readIndex++;
+
+            if (endNs >= startNs) {
+                results[numResults++] = { &scope, static_cast<double>(endNs - startNs) / 1e6 };
+            }
+        }
+    }
+
+    // Checking the disjoint flag also clears it, and it covers every result read above
+    GLint disjoint = GL_FALSE;
+    glGetIntegerv(GL_GPU_DISJOINT_EXT, &disjoint);
+    if (disjoint != GL_FALSE) {
+        return;
+    }
+
+    for (size_t i = 0; i < numResults; i++) {
+        const Result &result = results[i];
+        ScopeData &scope = *result.scope;
+        scope.lastMs = result.elapsedMs;
+        scope.hasNewResult = true;
+
+        scope.samples[scope.nextSample] = result.elapsedMs;
+        scope.nextSample = (scope.nextSample + 1) % GPU_PROFILER_WINDOW_SIZE;
+        scope.numSamples = std::min(scope.numSamples + 1, static_cast<uint32_t>(GPU_PROFILER_WINDOW_SIZE));
+    }
+}
+
+bool GPUProfiler::getLatestMs(const char* name, double &elapsedMs) {
+    int scopeIndex = findScope(name);
+    if (scopeIndex == -1 || !scopes[scopeIndex]->hasNewResult) {
+        return false;
+    }
+
+    ScopeData &scope = *scopes[scopeIndex];
+    elapsedMs = scope.lastMs;
+    scope.hasNewResult = false;
+    return true;
+}
+
+GPUProfiler::ScopeStats GPUProfiler::computeStats(const ScopeData &scope) const {
+    ScopeStats stats;
+    stats.lastMs = scope.lastMs;
+    stats.numSamples = scope.numSamples;
+    if (scope.numSamples == 0) {
+        return stats;
+    }
+
+    double sum = 0.0;
+    stats.minMs = scope.samples[0];
+    stats.maxMs = scope.samples[0];
+    for (uint32_t i = 0; i < scope.numSamples; i++) {
+        sum += scope.samples[i];
+        stats.minMs = std::min(stats.minMs, scope.samples[i]);
+        stats.maxMs = std::max(stats.maxMs, scope.samples[i]);
+    }
+    stats.avgMs = sum / scope.numSamples;
+
+    return stats;
+}
+
+bool GPUProfiler::getStats(const char* name, ScopeStats &stats) const {
+    int scopeIndex = findScope(name);
+    if (scopeIndex == -1) {
+        return false;
+    }
+
+    stats = computeStats(*scopes[scopeIndex]);
+    return true;
+}
+
+void GPUProfiler::logStats() const {
+    for (const auto &scope : scopes) {
+        ScopeStats stats = computeStats(*scope);
+        if (stats.numSamples == 0) {
+            continue;
+        }
+        spdlog::info("GPU time ({}): {:.3f}ms avg, {:.3f}ms min, {:.3f}ms max", scope->name, stats.avgMs, stats.minMs, stats.maxMs);
+    }
+}
@@ -5,6 +5,7 @@
 // OpenXR Tutorial for Khronos Group
 
 #include <GraphicsAPI.h>
+#include <GPUProfiler.h>
 
 namespace quasar {
 
@@ -15,6 +16,8 @@ bool CheckGraphicsAPI_TypeIsValidForPlatform(GraphicsAPI_Type type) {
     return (type == OPENGL) || (type == VULKAN);
 #elif defined(XR_USE_PLATFORM_ANDROID) || defined(XR_USE_PLATFORM_XCB) || defined(XR_USE_PLATFORM_WAYLAND)
     return (type == OPENGL_ES) || (type == VULKAN);
+#elif defined(XR_USE_PLATFORM_EGL)
+    return (type == OPENGL_ES);
 #endif
     return false;
 }
@@ -56,6 +59,11 @@ const char *GetGraphicsAPIInstanceExtensionString(GraphicsAPI_Type type) {
 
 using namespace quasar;
 
+// Out of line so the members only need GPUProfiler to be complete here
+GraphicsAPI::GraphicsAPI(const Config &config) : OpenGLRenderer(config) {}
+
+GraphicsAPI::~GraphicsAPI() = default;
+
 int64_t GraphicsAPI::SelectColorSwapchainFormat(const std::vector<int64_t> &formats) {
     const std::vector<int64_t> &supportSwapchainFormats = GetSupportedColorSwapchainFormats();
 
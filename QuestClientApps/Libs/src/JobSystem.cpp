@@ -0,0 +1,255 @@
+#include <chrono>
+#include <fstream>
+#include <algorithm>
+
+#include <sched.h>
+#include <unistd.h>
+
+#include <spdlog/spdlog.h>
+
+#include <JobSystem.h>
+
+using namespace quasar;
+
+namespace {
+
+// The pool and worker index of the calling thread, if it is a worker
+thread_local const JobSystem* tlsJobSystem = nullptr;
+thread_local int tlsWorkerIndex = -1;
+
+uint64_t nowNs() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+} // namespace
+
+JobSystem::JobSystem(const Params &params) {
+    std::vector<int> cores;
+    CoreTopology topology = getCoreTopology();
+    if (params.affinity == CoreAffinity::BIG) {
+        cores = topology.bigCores;
+    }
+    else if (params.affinity == CoreAffinity::LITTLE) {
+        cores = topology.littleCores;
+    }
+    // An empty list means no pinning
+
+    uint32_t numCores = !cores.empty() ? static_cast<uint32_t>(cores.size()) : std::max(std::thread::hardware_concurrency(), 1u);
+    uint32_t numWorkers = params.numWorkers > 0 ? params.numWorkers : std::max(numCores, 2u) - 1;
+
+    for (uint32_t i = 0; i < numWorkers + 1; i++) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    for (uint32_t i = 0; i < numWorkers; i++) {
+        workers.emplace_back(&JobSystem::workerLoop, this, static_cast<int>(i), cores);
+    }
+
+    spdlog::info("Job system: {} workers on {} cores ({} big, {} little)",
+                 numWorkers, cores.empty() ? "all" : std::to_string(cores.size()),
+                 topology.bigCores.size(), topology.littleCores.size());
+}
+
+JobSystem::~JobSystem() {
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        shouldStop = true;
+    }
+    workAvailable.notify_all();
+    for (std::thread &worker : workers) {
+        worker.join();
+    }
+}
+
+JobSystem::JobHandle JobSystem::create(const char* name, std::function<void()> function, const JobHandle &parent) {
+    JobHandle job = std::make_shared<Job>();
+    job->name = name;
+    job->function = std::move(function);
+    job->parent = parent;
+    if (parent) {
+        parent->unfinished.fetch_add(1, std::memory_order_relaxed);
+    }
+    return job;
+}
+
+void JobSystem::run(const JobHandle &job) {
+    // Workers push to their own deque (good locality for jobs spawned by jobs), everyone else to the shared one
+    int workerIndex = currentWorker();
+    Queue &queue = *queues[workerIndex >= 0 ? workerIndex : workers.size()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.jobs.push_back(job);
+    }
+    queuedJobs.fetch_add(1, std::memory_order_release);
+
+    // Taking the lock orders this with a worker that is about to sleep
+    { std::lock_guard<std::mutex> lock(sleepMutex); }
+    workAvailable.notify_one();
+}
+
+void JobSystem::wait(const JobHandle &job) {
+    int workerIndex = currentWorker();
+    while (!isFinished(job)) {
+        if (runOneJob(workerIndex)) {
+            continue;
+        }
+
+        // Nothing to help with: sleep until a job finishes or more work shows up
+        numWaiters.fetch_add(1, std::memory_order_acq_rel);
+        {
+            std::unique_lock<std::mutex> lock(sleepMutex);
+            jobFinished.wait_for(lock, std::chrono::milliseconds(1), [&] {
+                return isFinished(job) || queuedJobs.load(std::memory_order_acquire) > 0;
+            });
+        }
+        numWaiters.fetch_sub(1, std::memory_order_acq_rel);
+    }
+}
+
+void JobSystem::parallelFor(const char* name, uint32_t count, uint32_t grainSize, const std::function<void(uint32_t, uint32_t)> &function) {
+    if (count == 0) {
+        return;
+    }
+    grainSize = std::max(grainSize, 1u);
+    if (count <= grainSize) {
+        function(0, count);
+        return;
+    }
+
+    JobHandle root = create(name, nullptr);
+    for (uint32_t begin = 0; begin < count; begin += grainSize) {
+        uint32_t end = std::min(begin + grainSize, count);
+        submit(name, [&function, begin, end]() { function(begin, end); }, root);
+    }
+    run(root);
+    wait(root);
+}
+
+JobSystem::CoreTopology JobSystem::getCoreTopology() {
+    CoreTopology topology;
+
+    long numCores = sysconf(_SC_NPROCESSORS_CONF);
+    std::vector<std::pair<int, long>> coreFrequencies;
+    for (int core = 0; core < numCores; core++) {
+        std::ifstream file("/sys/devices/system/cpu/cpu" + std::to_string(core) + "/cpufreq/cpuinfo_max_freq");
+        long maxFrequency = 0;
+        if (file >> maxFrequency) {
+            coreFrequencies.emplace_back(core, maxFrequency);
+        }
+    }
+    if (coreFrequencies.empty()) {
+        return topology;
+    }
+
+    long slowest = std::min_element(coreFrequencies.begin(), coreFrequencies.end(),
+                                    [](const auto &a, const auto &b) { return a.second < b.second; })->second;
+    long fastest = std::max_element(coreFrequencies.begin(), coreFrequencies.end(),
+                                    [](const auto &a, const auto &b) { return a.second < b.second; })->second;
+    for (const auto &[core, maxFrequency] : coreFrequencies) {
+        // Uniform cores are all big
+        if (maxFrequency == slowest && slowest != fastest) {
+            topology.littleCores.push_back(core);
+        }
+        else {
+            topology.bigCores.push_back(core);
+        }
+    }
+    return topology;
+}
+
+void JobSystem::workerLoop(int workerIndex, std::vector<int> cores) {
+    tlsJobSystem = this;
+    tlsWorkerIndex = workerIndex;
+
+    if (!cores.empty()) {
+        cpu_set_t cpuSet;
+        CPU_ZERO(&cpuSet);
+        for (int core : cores) {
+            CPU_SET(core, &cpuSet);
+        }
+        if (sched_setaffinity(0, sizeof(cpuSet), &cpuSet) != 0) {
+            spdlog::warn("Job system: failed to set the affinity of worker {}", workerIndex);
+        }
+    }
+
+    while (true) {
+        if (runOneJob(workerIndex)) {
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleepMutex);
+        workAvailable.wait(lock, [this] { return shouldStop || queuedJobs.load(std::memory_order_acquire) > 0; });
+        if (shouldStop) {
+            break;
+        }
+    }
+}
+
+JobSystem::JobHandle JobSystem::popJob(int workerIndex) {
+    const size_t numQueues = queues.size();
+    size_t ownIndex = workerIndex >= 0 ? static_cast<size_t>(workerIndex) : workers.size();
+
+    // Own deque first, newest job first
+    {
+        Queue &queue = *queues[ownIndex];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.jobs.empty()) {
+            JobHandle job = std::move(queue.jobs.back());
+            queue.jobs.pop_back();
+            return job;
+        }
+    }
+
+    // Then steal the oldest job of another queue (the shared one included)
+    for (size_t i = 1; i < numQueues; i++) {
+        Queue &queue = *queues[(ownIndex + i) % numQueues];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.jobs.empty()) {
+            JobHandle job = std::move(queue.jobs.front());
+            queue.jobs.pop_front();
+            return job;
+        }
+    }
+    return nullptr;
+}
+
+bool JobSystem::runOneJob(int workerIndex) {
+    if (queuedJobs.load(std::memory_order_acquire) == 0) {
+        return false;
+    }
+    JobHandle job = popJob(workerIndex);
+    if (!job) {
+        return false;
+    }
+    queuedJobs.fetch_sub(1, std::memory_order_acq_rel);
+    execute(job, workerIndex);
+    return true;
+}
+
+void JobSystem::execute(const JobHandle &job, int workerIndex) {
+    uint64_t startNs = traceCallback ? nowNs() : 0;
+    if (job->function) {
+        job->function();
+    }
+    if (traceCallback) {
+        traceCallback({ job->name, workerIndex, startNs, nowNs() });
+    }
+    finish(job.get());
+}
+
+void JobSystem::finish(Job* job) {
+    if (job->unfinished.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+        return;
+    }
+    if (job->parent) {
+        finish(job->parent.get());
+    }
+
+    if (numWaiters.load(std::memory_order_acquire) > 0) {
+        { std::lock_guard<std::mutex> lock(sleepMutex); }
+        jobFinished.notify_all();
+    }
+}
+
+int JobSystem::currentWorker() const {
+    return tlsJobSystem == this ? tlsWorkerIndex : -1;
+}
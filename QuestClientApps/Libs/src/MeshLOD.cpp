@@ -0,0 +1,421 @@
+#include <limits>
+#include <cstring>
+#include <cstddef>
+#include <fstream>
+#include <algorithm>
+#include <unordered_set>
+
+#include <spdlog/spdlog.h>
+
+#include <MeshLOD.h>
+#include <Utils/BufferReadback.h>
+
+using namespace quasar;
+
+namespace {
+
+constexpr uint32_t CACHE_MAGIC = 0x444F4C4D; // "MLOD"
+constexpr uint32_t CACHE_VERSION = 2;
+
+// Meshes in depth first order, so the cache lists them in the same order on every load
+void collectMeshes(const Node* node, std::vector<Mesh*> &meshes, std::unordered_set<const Mesh*> &seen) {
+    if (node->entity != nullptr) {
+        if (node->entity->getType() == EntityType::MODEL) {
+            collectMeshes(&static_cast<Model*>(node->entity)->rootNode, meshes, seen);
+        }
+        else if (node->entity->getType() == EntityType::MESH) {
+            Mesh* mesh = static_cast<Mesh*>(node->entity);
+            if (seen.insert(mesh).second) {
+                meshes.push_back(mesh);
+            }
+        }
+    }
+    for (const Node* child : node->children) {
+        collectMeshes(child, meshes, seen);
+    }
+}
+
+// FNV-1a over 64 bit words (bytewise for the tail), fast enough to run over every mesh on load
+uint64_t hashBytes(const void* data, size_t size, uint64_t hash = 0xcbf29ce484222325ull) {
+    constexpr uint64_t prime = 0x100000001b3ull;
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    size_t i = 0;
+    for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+        uint64_t word;
+        std::memcpy(&word, bytes + i, sizeof(uint64_t));
+        hash = (hash ^ word) * prime;
+    }
+    for (; i < size; i++) {
+        hash = (hash ^ bytes[i]) * prime;
+    }
+    return hash;
+}
+
+template <typename T>
+void writeValue(std::ofstream &file, const T &value) {
+    file.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+template <typename T>
+bool readValue(std::ifstream &file, T &value) {
+    return static_cast<bool>(file.read(reinterpret_cast<char*>(&value), sizeof(T)));
+}
+
+} // namespace
+
+MeshLOD::~MeshLOD() {
+    for (auto &[mesh, levels] : meshLevels) {
+        for (Level &level : levels.levels) {
+            // The material belongs to the source mesh
+            if (level.mesh != nullptr) {
+                level.mesh->material = nullptr;
+            }
+            delete level.mesh;
+        }
+    }
+}
+
+void MeshLOD::generate(Model &model, const std::string &cachePath, JobSystem* jobSystem) {
+    std::vector<Mesh*> meshes;
+    std::unordered_set<const Mesh*> seen;
+    collectMeshes(&model.rootNode, meshes, seen);
+
+    struct SourceMesh {
+        std::vector<uint8_t> vertices;
+        std::vector<uint32_t> indices;
+        MeshLevels* levels;
+    };
+    std::vector<SourceMesh> sources;
+
+    // Read back on the GL thread first; map entries don't move, so the jobs can fill them in afterwards.
+    // The cache is checked against a hash of this data, so it is read back even if the cache is used.
+    for (Mesh* mesh : meshes) {
+        GLint64 verticesSize = getBufferSize(mesh->vertexBuffer.ID);
+        GLint64 indicesSize = getBufferSize(mesh->indexBuffer.ID);
+
+        // Every mesh gets an entry, so the cache can be checked against the whole model
+        MeshLevels &levels = meshLevels[mesh];
+        levels.numSourceVertices = static_cast<uint32_t>(verticesSize / sizeof(Vertex));
+        levels.numSourceIndices = static_cast<uint32_t>(indicesSize / sizeof(uint32_t));
+
+        // Non-indexed and small meshes are left alone
+        if (indicesSize == 0 || verticesSize % sizeof(Vertex) != 0 || levels.numSourceIndices / 3 < params.minTriangles) {
+            continue;
+        }
+
+        SourceMesh source;
+        source.vertices.resize(verticesSize);
+        source.indices.resize(levels.numSourceIndices);
+        source.levels = &levels;
+        if (!readBuffer(mesh->vertexBuffer.ID, source.vertices.data(), verticesSize) ||
+            !readBuffer(mesh->indexBuffer.ID, source.indices.data(), indicesSize)) {
+            spdlog::warn("Failed to read back mesh data, skipping mesh LODs");
+            continue;
+        }
+        levels.contentHash = hashBytes(source.indices.data(), indicesSize, hashBytes(source.vertices.data(), verticesSize));
+        sources.push_back(std::move(source));
+    }
+
+    if (!cachePath.empty() && loadCache(cachePath, meshes)) {
+        spdlog::info("Loaded mesh LODs from {}", cachePath);
+    }
+    else {
+        auto buildRange = [&](uint32_t begin, uint32_t end) {
+            for (uint32_t i = begin; i < end; i++) {
+                buildLevels(sources[i].vertices, sources[i].indices, sizeof(Vertex), *sources[i].levels);
+                sources[i].vertices = {};
+                sources[i].indices = {};
+            }
+        };
+        if (jobSystem != nullptr) {
+            jobSystem->parallelFor("MeshLOD build", static_cast<uint32_t>(sources.size()), 1, buildRange);
+        }
+        else {
+            buildRange(0, static_cast<uint32_t>(sources.size()));
+        }
+
+        if (!cachePath.empty()) {
+            writeCache(cachePath, meshes);
+        }
+    }
+
+    uint32_t numLevels = 0;
+    for (Mesh* mesh : meshes) {
+        auto it = meshLevels.find(mesh);
+        if (it != meshLevels.end()) {
+            createMeshes(mesh, it->second);
+            numLevels += static_cast<uint32_t>(it->second.levels.size());
+        }
+    }
+    spdlog::info("Created {} LOD levels for {} meshes", numLevels, meshes.size());
+}
+
+void MeshLOD::buildLevels(const std::vector<uint8_t> &vertices, const std::vector<uint32_t> &indices, uint32_t vertexSize, MeshLevels &levels) const {
+    const uint32_t numVertices = static_cast<uint32_t>(vertices.size() / vertexSize);
+    auto position = [&](uint32_t i) {
+        glm::vec3 p;
+        std::memcpy(&p, vertices.data() + i * vertexSize + offsetof(Vertex, position), sizeof(glm::vec3));
+        return p;
+    };
+
+    glm::vec3 boundsMin(std::numeric_limits<float>::max());
+    glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
+    for (uint32_t i = 0; i < numVertices; i++) {
+        boundsMin = glm::min(boundsMin, position(i));
+        boundsMax = glm::max(boundsMax, position(i));
+    }
+    levels.center = 0.5f * (boundsMin + boundsMax);
+    levels.radius = 0.0f;
+    for (uint32_t i = 0; i < numVertices; i++) {
+        levels.radius = glm::max(levels.radius, glm::length(position(i) - levels.center));
+    }
+
+    glm::vec3 extent = boundsMax - boundsMin;
+    float longestAxis = glm::max(extent.x, glm::max(extent.y, extent.z));
+    if (longestAxis <= 0.0f) {
+        return;
+    }
+
+    struct Cell {
+        glm::vec3 sum{0.0f};
+        uint32_t count = 0;
+        uint32_t representative = 0;
+        float bestDistance = std::numeric_limits<float>::max();
+    };
+    std::unordered_map<uint64_t, Cell> cells;
+    std::vector<uint64_t> vertexCells(numVertices);
+    std::vector<uint32_t> remap(numVertices);
+    std::vector<uint32_t> compacted(numVertices);
+
+    uint32_t prevTriangles = static_cast<uint32_t>(indices.size() / 3);
+    for (uint32_t resolution = params.gridResolution;
+         resolution >= 2 && levels.levels.size() < std::min(params.numLevels, MESH_LOD_MAX_LEVELS - 1u);
+         resolution /= 2) {
+        float cellSize = longestAxis / resolution;
+        glm::uvec3 dims = glm::max(glm::uvec3(glm::ceil(extent / cellSize)), glm::uvec3(1));
+
+        // Each cell keeps the vertex closest to the average of the vertices in it
+        cells.clear();
+        for (uint32_t i = 0; i < numVertices; i++) {
+            glm::uvec3 cell = glm::min(glm::uvec3((position(i) - boundsMin) / cellSize), dims - 1u);
+            vertexCells[i] = cell.x + static_cast<uint64_t>(dims.x) * (cell.y + static_cast<uint64_t>(dims.y) * cell.z);
+            Cell &c = cells[vertexCells[i]];
+            c.sum += position(i);
+            c.count++;
+        }
+        for (uint32_t i = 0; i < numVertices; i++) {
+            Cell &c = cells[vertexCells[i]];
+            float distance = glm::length(position(i) - c.sum / static_cast<float>(c.count));
+            if (distance < c.bestDistance) {
+                c.bestDistance = distance;
+                c.representative = i;
+            }
+        }
+        for (uint32_t i = 0; i < numVertices; i++) {
+            remap[i] = cells[vertexCells[i]].representative;
+        }
+
+        // Drop the triangles that collapsed, and only keep the vertices still in use
+        Level level;
+        std::fill(compacted.begin(), compacted.end(), UINT32_MAX);
+        uint32_t numLevelVertices = 0;
+        for (size_t t = 0; t + 2 < indices.size(); t += 3) {
+            uint32_t a = remap[indices[t]], b = remap[indices[t + 1]], c = remap[indices[t + 2]];
+            if (a == b || b == c || a == c) {
+                continue;
+            }
+            for (uint32_t v : { a, b, c }) {
+                if (compacted[v] == UINT32_MAX) {
+                    compacted[v] = numLevelVertices++;
+                    level.vertices.insert(level.vertices.end(), vertices.begin() + v * vertexSize, vertices.begin() + (v + 1) * vertexSize);
+                }
+                level.indices.push_back(compacted[v]);
+            }
+        }
+
+        uint32_t numTriangles = static_cast<uint32_t>(level.indices.size() / 3);
+        if (numTriangles == 0) {
+            break;
+        }
+        // Not enough of a reduction yet, try a coarser grid
+        if (numTriangles > params.maxTriangleRatio * prevTriangles) {
+            continue;
+        }
+        prevTriangles = numTriangles;
+        levels.levels.push_back(std::move(level));
+    }
+}
+
+void MeshLOD::createMeshes(Mesh* source, MeshLevels &levels) {
+    for (Level &level : levels.levels) {
+        // Levels draw with the source's material but don't own it (see the destructor)
+        level.mesh = new Mesh({
+            .verticesData = level.vertices.data(),
+            .verticesSize = static_cast<uint32_t>(level.vertices.size() / sizeof(Vertex)),
+            .indicesData = level.indices.data(),
+            .indicesSize = static_cast<uint32_t>(level.indices.size()),
+            .material = source->material
+        });
+
+        // The GPU has its own copy now
+        level.numIndices = static_cast<uint32_t>(level.indices.size());
+        level.vertices = {};
+        level.indices = {};
+    }
+}
+
+std::vector<Mesh*> MeshLOD::getLevelMeshes() const {
+    std::vector<Mesh*> meshes;
+    for (const auto &[mesh, levels] : meshLevels) {
+        for (const Level &level : levels.levels) {
+            if (level.mesh != nullptr) {
+                meshes.push_back(level.mesh);
+            }
+        }
+    }
+    return meshes;
+}
+
+void MeshLOD::remapMeshes(const std::unordered_map<const Mesh*, Mesh*> &adoptedMeshes) {
+    auto remap = [&](const Mesh* mesh) {
+        auto it = adoptedMeshes.find(mesh);
+        return (it != adoptedMeshes.end()) ? it->second : const_cast<Mesh*>(mesh);
+    };
+
+    // Levels are looked up by the mesh the node draws, which is the adopted source now
+    std::unordered_map<const Mesh*, MeshLevels> remapped;
+    for (auto &[mesh, levels] : meshLevels) {
+        for (Level &level : levels.levels) {
+            level.mesh = remap(level.mesh);
+        }
+        remapped.emplace(remap(mesh), std::move(levels));
+    }
+    meshLevels = std::move(remapped);
+}
+
+Mesh* MeshLOD::select(Mesh* mesh, const glm::mat4 &model, const glm::vec3 &eyePosition, float projectionScale) {
+    auto it = meshLevels.find(mesh);
+    if (it == meshLevels.end()) {
+        return mesh;
+    }
+    const MeshLevels &levels = it->second;
+
+    uint32_t levelIndex = 0;
+    if (!levels.levels.empty()) {
+        glm::vec3 center = glm::vec3(model * glm::vec4(levels.center, 1.0f));
+        float scale = glm::max(glm::length(glm::vec3(model[0])), glm::max(glm::length(glm::vec3(model[1])), glm::length(glm::vec3(model[2]))));
+        float radius = levels.radius * scale;
+        float distance = glm::length(center - eyePosition);
+
+        // Inside the bounding sphere the mesh covers the whole view
+        if (distance > radius) {
+            float screenSize = radius * projectionScale / distance;
+            while (levelIndex < levels.levels.size() && screenSize < params.screenSizes[levelIndex]) {
+                levelIndex++;
+            }
+        }
+    }
+
+    Mesh* selected = (levelIndex == 0) ? mesh : levels.levels[levelIndex - 1].mesh;
+
+    stats.draws[levelIndex]++;
+    stats.fullTriangles += levels.numSourceIndices / 3;
+    stats.drawnTriangles += ((levelIndex == 0) ? levels.numSourceIndices : levels.levels[levelIndex - 1].numIndices) / 3;
+
+    return selected;
+}
+
+bool MeshLOD::loadCache(const std::string &cachePath, const std::vector<Mesh*> &meshes) {
+    std::ifstream file(cachePath, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+
+    uint32_t magic = 0, version = 0, numMeshes = 0;
+    uint64_t paramsHash = 0;
+    if (!readValue(file, magic) || !readValue(file, version) || !readValue(file, paramsHash) || !readValue(file, numMeshes) ||
+        magic != CACHE_MAGIC || version != CACHE_VERSION || paramsHash != hashParams() || numMeshes != meshes.size()) {
+        spdlog::warn("Mesh LOD cache {} is stale, regenerating", cachePath);
+        return false;
+    }
+
+    std::unordered_map<const Mesh*, MeshLevels> loaded;
+    for (Mesh* mesh : meshes) {
+        MeshLevels levels;
+        uint32_t numLevels = 0;
+        if (!readValue(file, levels.numSourceVertices) || !readValue(file, levels.numSourceIndices) || !readValue(file, levels.contentHash) ||
+            !readValue(file, levels.center) || !readValue(file, levels.radius) || !readValue(file, numLevels)) {
+            return false;
+        }
+
+        // The cache has to describe this exact model, down to the vertex and index data
+        const MeshLevels &current = meshLevels.at(mesh);
+        if (levels.numSourceVertices != current.numSourceVertices ||
+            levels.numSourceIndices != current.numSourceIndices ||
+            levels.contentHash != current.contentHash ||
+            numLevels > MESH_LOD_MAX_LEVELS - 1) {
+            spdlog::warn("Mesh LOD cache {} does not match the model, regenerating", cachePath);
+            return false;
+        }
+
+        levels.levels.resize(numLevels);
+        for (Level &level : levels.levels) {
+            uint32_t numVertices = 0, numIndices = 0;
+            if (!readValue(file, numVertices) || !readValue(file, numIndices) ||
+                numVertices > levels.numSourceVertices || numIndices > levels.numSourceIndices) {
+                return false;
+            }
+            level.vertices.resize(numVertices * sizeof(Vertex));
+            level.indices.resize(numIndices);
+            if (!file.read(reinterpret_cast<char*>(level.vertices.data()), level.vertices.size()) ||
+                !file.read(reinterpret_cast<char*>(level.indices.data()), level.indices.size() * sizeof(uint32_t))) {
+                return false;
+            }
+        }
+
+        loaded[mesh] = std::move(levels);
+    }
+
+    for (auto &[mesh, levels] : loaded) {
+        meshLevels[mesh] = std::move(levels);
+    }
+    return true;
+}
+
+void MeshLOD::writeCache(const std::string &cachePath, const std::vector<Mesh*> &meshes) const {
+    std::ofstream file(cachePath, std::ios::binary | std::ios::trunc);
+    if (!file.is_open()) {
+        spdlog::warn("Failed to write mesh LOD cache to {}", cachePath);
+        return;
+    }
+
+    writeValue(file, CACHE_MAGIC);
+    writeValue(file, CACHE_VERSION);
+    writeValue(file, hashParams());
+    writeValue(file, static_cast<uint32_t>(meshes.size()));
+
+    for (Mesh* mesh : meshes) {
+        const MeshLevels &levels = meshLevels.at(mesh);
+
+        writeValue(file, levels.numSourceVertices);
+        writeValue(file, levels.numSourceIndices);
+        writeValue(file, levels.contentHash);
+        writeValue(file, levels.center);
+        writeValue(file, levels.radius);
+        writeValue(file, static_cast<uint32_t>(levels.levels.size()));
+        for (const Level &level : levels.levels) {
+            writeValue(file, static_cast<uint32_t>(level.vertices.size() / sizeof(Vertex)));
+            writeValue(file, static_cast<uint32_t>(level.indices.size()));
+            file.write(reinterpret_cast<const char*>(level.vertices.data()), level.vertices.size());
+            file.write(reinterpret_cast<const char*>(level.indices.data()), level.indices.size() * sizeof(uint32_t));
+        }
+    }
+}
+
+uint64_t MeshLOD::hashParams() const {
+    // Everything that changes the generated levels; screenSizes only affect selection
+    uint64_t hash = hashBytes(&params.numLevels, sizeof(params.numLevels));
+    hash = hashBytes(&params.gridResolution, sizeof(params.gridResolution), hash);
+    hash = hashBytes(&params.minTriangles, sizeof(params.minTriangles), hash);
+    return hashBytes(&params.maxTriangleRatio, sizeof(params.maxTriangleRatio), hash);
+}
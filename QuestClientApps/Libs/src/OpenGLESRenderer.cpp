@@ -3,6 +3,7 @@
 #include <Primitives/Model.h>
 
 #include <OpenGLESRenderer.h>
+#include <GPUProfiler.h>
 
 #include <Utils/DebugOutput.h>
 #include <Utils/OpenXRDebugUtils.h>
@@ -15,10 +16,18 @@ PROC GetExtension(const char *functionName) { return wglGetProcAddress(functionN
 void (*GetExtension(const char *functionName))() { return NULL; }
 #elif defined(OS_LINUX_XCB) || defined(OS_LINUX_XLIB) || defined(OS_LINUX_XCB_GLX)
 void (*GetExtension(const char *functionName))() { return glXGetProcAddress((const GLubyte *)functionName); }
-#elif defined(OS_ANDROID) || defined(OS_LINUX_WAYLAND)
+#elif defined(OS_ANDROID) || defined(OS_LINUX_WAYLAND) || defined(QUEST_CLIENT_HEADLESS)
 void (*GetExtension(const char *functionName))() { return eglGetProcAddress(functionName); }
 #endif
 
+#if defined(QUEST_CLIENT_HEADLESS)
+#ifndef EGL_PLATFORM_SURFACELESS_MESA
+#define EGL_PLATFORM_SURFACELESS_MESA 0x31DD
+#endif
+
+PFNGLFRAMEBUFFERTEXTUREMULTIVIEWOVRPROC glFramebufferTextureMultiviewOVR_ = nullptr;
+#endif
+
 using namespace quasar;
 
 OpenGLESRenderer::OpenGLESRenderer(const Config &config, XrInstance m_xrInstance, XrSystemId systemId) : GraphicsAPI(config) {
@@ -26,6 +35,11 @@ OpenGLESRenderer::OpenGLESRenderer(const Config &config, XrInstance m_xrInstance
     XrGraphicsRequirementsOpenGLESKHR graphicsRequirements{XR_TYPE_GRAPHICS_REQUIREMENTS_OPENGL_ES_KHR};
     OPENXR_CHECK(xrGetOpenGLESGraphicsRequirementsKHR(m_xrInstance, systemId, &graphicsRequirements), "Failed to get Graphics Requirements for OpenGLES.");
 
+#if defined(QUEST_CLIENT_HEADLESS)
+    if (!createHeadlessContext()) {
+        std::cout << "ERROR: OPENGL ES: Failed to create headless Context." << std::endl;
+    }
+#else
     // https://github.com/KhronosGroup/OpenXR-SDK-Source/blob/f122f9f1fc729e2dc82e12c3ce73efa875182854/src/tests/hello_xr/graphicsplugin_opengles.cpp#L101-L119
     // Initialize the gl extensions. Note we have to open a window.
     ksDriverInstance driverInstance{};
@@ -36,6 +50,7 @@ OpenGLESRenderer::OpenGLESRenderer(const Config &config, XrInstance m_xrInstance
     if (!ksGpuWindow_Create(&window, &driverInstance, &queueInfo, 0, colorFormat, depthFormat, sampleCount, 640, 480, false)) {
         std::cout << "ERROR: OPENGL ES: Failed to create Context." << std::endl;
     }
+#endif
 
     GLint glMajorVersion = 0;
     GLint glMinorVersion = 0;
@@ -57,12 +72,78 @@ OpenGLESRenderer::OpenGLESRenderer(const Config &config, XrInstance m_xrInstance
         DEBUG_BREAK;
     }
 #endif
+
+    // Created once, now that the context is current, and reused by every full screen pass
+    outputFsQuad = std::make_unique<FullScreenQuad>();
+    gpuProfiler = std::make_unique<GPUProfiler>();
+#if defined(QUEST_CLIENT_HEADLESS)
+    resourceLoader = std::make_unique<ResourceLoader>(display, config, context);
+#else
+    resourceLoader = std::make_unique<ResourceLoader>(window.display, window.context.config, window.context.context);
+#endif
 }
 
 OpenGLESRenderer::~OpenGLESRenderer() {
+    outputFsQuad.reset();
+    shadowCache.destroy();
+    gpuProfiler.reset();
+    resourceLoader.reset();
+#if defined(QUEST_CLIENT_HEADLESS)
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    eglDestroyContext(display, context);
+    eglTerminate(display);
+#else
     ksGpuWindow_Destroy(&window);
+#endif
 }
 
+#if defined(QUEST_CLIENT_HEADLESS)
+bool OpenGLESRenderer::createHeadlessContext() {
+    // Mesa's surfaceless platform needs no window system; fall back to the default display elsewhere
+    auto eglGetPlatformDisplayEXT = (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+    display = (eglGetPlatformDisplayEXT != nullptr) ?
+        eglGetPlatformDisplayEXT(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr) :
+        eglGetDisplay(EGL_DEFAULT_DISPLAY);
+    EGLint majorVersion, minorVersion;
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, &majorVersion, &minorVersion)) {
+        return false;
+    }
+    eglBindAPI(EGL_OPENGL_ES_API);
+
+    const EGLint configAttribs[] = {
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_ES3_BIT,
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_NONE
+    };
+    EGLint numConfigs = 0;
+    if (!eglChooseConfig(display, configAttribs, &config, 1, &numConfigs) || numConfigs == 0) {
+        return false;
+    }
+
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_MAJOR_VERSION, 3,
+        EGL_CONTEXT_MINOR_VERSION, 2,
+        EGL_NONE
+    };
+    context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttribs);
+    // Everything renders into swapchain images, so the context never needs a surface (EGL_KHR_surfaceless_context)
+    if (context == EGL_NO_CONTEXT || !eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context)) {
+        return false;
+    }
+
+    glFramebufferTextureMultiviewOVR_ = (PFNGLFRAMEBUFFERTEXTUREMULTIVIEWOVRPROC)eglGetProcAddress("glFramebufferTextureMultiviewOVR");
+    return true;
+}
+
+void *OpenGLESRenderer::GetGraphicsBinding() {
+    graphicsBinding = {XR_TYPE_GRAPHICS_BINDING_EGL_MNDX};
+    graphicsBinding.getProcAddress = eglGetProcAddress;
+    graphicsBinding.display = display;
+    graphicsBinding.config = config;
+    graphicsBinding.context = context;
+    return &graphicsBinding;
+}
+#else
 void *OpenGLESRenderer::GetGraphicsBinding() {
     graphicsBinding = {XR_TYPE_GRAPHICS_BINDING_OPENGL_ES_ANDROID_KHR};
     graphicsBinding.display = window.display;
@@ -70,6 +151,7 @@ void *OpenGLESRenderer::GetGraphicsBinding() {
     graphicsBinding.context = window.context.context;
     return &graphicsBinding;
 }
+#endif
 
 XrSwapchainImageBaseHeader *OpenGLESRenderer::AllocateSwapchainImageData(XrSwapchain swapchain, SwapchainType type, uint32_t count) {
     swapchainImagesMap[swapchain].first = type;
@@ -176,12 +258,32 @@ RenderStats OpenGLESRenderer::drawObjects(const Scene &scene, const Camera &came
 
     RenderStats stats;
 
-    updateDirLightShadow(scene, camera);
+    if (!cacheShadows) {
+        GPUProfiler::Scope shadowScope(*gpuProfiler, "shadow");
+        updateDirLightShadow(scene, camera);
+    }
+    else {
+        updateCachedDirLightShadow(scene, camera);
+    }
     // point light shadows are not implemented yet
 
+    GPUProfiler::Scope sceneScope(*gpuProfiler, "scene");
+
     // draw all objects in the scene
     glViewport(0, 0, width, height); // restore viewport
-    stats += GraphicsAPI::drawScene(scene, camera, clearMask);
+    if (useRenderQueue) {
+        glClearColor(scene.backgroundColor.x, scene.backgroundColor.y, scene.backgroundColor.z, scene.backgroundColor.w);
+        glClear(clearMask);
+
+        renderQueue.build(scene, camera);
+        stats += renderQueue.draw(scene, camera);
+        for (const RenderQueue::PassthroughNode &passthrough : renderQueue.getPassthroughNodes()) {
+            stats += drawNode(scene, camera, passthrough.node, passthrough.parentTransform, true, passthrough.overrideMaterial);
+        }
+    }
+    else {
+        stats += GraphicsAPI::drawScene(scene, camera, clearMask);
+    }
 
     // draw lights for debugging
     stats += GraphicsAPI::drawLights(scene, camera);
@@ -189,9 +291,47 @@ RenderStats OpenGLESRenderer::drawObjects(const Scene &scene, const Camera &came
     // draw skybox
     stats += GraphicsAPI::drawSkyBox(scene, camera);
 
+    frameRenderStats += stats;
     return stats;
 }
 
+void OpenGLESRenderer::updateCachedDirLightShadow(const Scene &scene, const Camera &camera) {
+    ShadowCache::Passes passes = shadowCache.plan(scene);
+    if (!passes.staticCasters && !passes.dynamicCasters) {
+        return;
+    }
+
+    GPUProfiler::Scope shadowScope(*gpuProfiler, "shadow");
+    RenderTargetBase &shadowMap = scene.directionalLight->shadowMapRenderTarget;
+
+    if (passes.staticCasters) {
+        shadowCache.hideDynamicCasters();
+        updateDirLightShadow(scene, camera);
+        shadowCache.restoreVisibility();
+
+        if (passes.dynamicCasters) {
+            shadowMap.bind();
+            bool stored = shadowCache.storeStaticMap();
+            shadowMap.unbind();
+            if (!stored) {
+                // No cached copy to merge, so draw every caster in one pass
+                updateDirLightShadow(scene, camera);
+                return;
+            }
+        }
+    }
+
+    if (passes.dynamicCasters) {
+        shadowCache.hideStaticCasters();
+        updateDirLightShadow(scene, camera);
+        shadowCache.restoreVisibility();
+
+        shadowMap.bind();
+        shadowCache.compositeStaticMap();
+        shadowMap.unbind();
+    }
+}
+
 void OpenGLESRenderer::setScreenShaderUniforms(const Shader &screenShader) {
     // screenShader.setTexture("screenColor", gBuffer.colorBuffer, 0);
     // screenShader.setTexture("screenDepth", gBuffer.depthBuffer, 1);
@@ -200,19 +340,18 @@ void OpenGLESRenderer::setScreenShaderUniforms(const Shader &screenShader) {
 RenderStats OpenGLESRenderer::drawToScreen(const Shader &screenShader, const RenderTargetBase* overrideRenderTarget) {
     pipeline.apply();
 
-    FullScreenQuad outputFsQuad;
-
     beginRendering();
 
     glClearColor(1.0f, 1.0f, 1.0f, 1.0f);
     glClear(GL_COLOR_BUFFER_BIT);
 
     screenShader.bind();
-    RenderStats stats = outputFsQuad.draw();
+    RenderStats stats = outputFsQuad->draw();
     screenShader.unbind();
 
     endRendering();
 
+    frameRenderStats += stats;
     return stats;
 }
 
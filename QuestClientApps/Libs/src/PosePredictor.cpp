@@ -0,0 +1,125 @@
+#include <algorithm>
+
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <PosePredictor.h>
+
+using namespace quasar;
+
+static float angleBetween(const glm::quat &a, const glm::quat &b) {
+    float d = glm::min(glm::abs(glm::dot(a, b)), 1.0f);
+    return 2.0f * glm::acos(d);
+}
+
+PosePredictor::HeadPose PosePredictor::getHeadPose(const VRCamera &cameras) {
+    // The eyes share an orientation; the head sits between them
+    glm::mat4 worldFromLeft = glm::inverse(cameras.left.getViewMatrix());
+    glm::mat4 worldFromRight = glm::inverse(cameras.right.getViewMatrix());
+
+    HeadPose pose;
+    pose.position = 0.5f * (glm::vec3(worldFromLeft[3]) + glm::vec3(worldFromRight[3]));
+    pose.orientation = glm::normalize(glm::quat_cast(glm::mat3(worldFromLeft)));
+    return pose;
+}
+
+void PosePredictor::update(double now, const VRCamera &cameras) {
+    HeadPose pose = getHeadPose(cameras);
+
+    if (hasPose) {
+        double dt = now - lastTime;
+        if (dt <= 0.0) {
+            return;
+        }
+
+        glm::vec3 velocity = (pose.position - lastPose.position) / static_cast<float>(dt);
+
+        // Shortest rotation from the last orientation to this one, as axis * angle
+        glm::quat delta = pose.orientation * glm::inverse(lastPose.orientation);
+        if (delta.w < 0.0f) {
+            delta = -delta;
+        }
+        float angle = 2.0f * glm::acos(glm::min(delta.w, 1.0f));
+        glm::vec3 axis = glm::vec3(delta.x, delta.y, delta.z);
+        float axisLength = glm::length(axis);
+        glm::vec3 angular = (axisLength > 1e-6f) ? (axis / axisLength) * (angle / static_cast<float>(dt)) : glm::vec3(0.0f);
+
+        linearVelocity += params.velocitySmoothing * (velocity - linearVelocity);
+        angularVelocity += params.velocitySmoothing * (angular - angularVelocity);
+    }
+
+    // Score the predictions that were made for this time (or earlier)
+    while (pendingCount > 0 && pending[pendingStart].targetTime <= now) {
+        addErrorSample(pending[pendingStart], pose);
+        pendingStart = (pendingStart + 1) % POSE_PREDICTOR_MAX_PENDING;
+        pendingCount--;
+    }
+
+    hasPose = true;
+    lastTime = now;
+    lastPose = pose;
+}
+
+void PosePredictor::addLatencySample(double latencyMs) {
+    if (latencyMs <= 0.0) {
+        return;
+    }
+    if (!hasLatency) {
+        stats.latencyMs = latencyMs;
+        hasLatency = true;
+    }
+    else {
+        stats.latencyMs += params.latencySmoothing * (latencyMs - stats.latencyMs);
+    }
+}
+
+void PosePredictor::predict(const VRCamera &cameras, VRCamera &predictedCameras) {
+    predictedCameras.setProjectionMatrices({
+        cameras.left.getProjectionMatrix(),
+        cameras.right.getProjectionMatrix()
+    });
+
+    double horizonMs = std::min(stats.latencyMs, params.maxHorizonMs);
+    if (!hasPose || horizonMs <= 0.0) {
+        predictedCameras.setViewMatrices({
+            cameras.left.getViewMatrix(),
+            cameras.right.getViewMatrix()
+        });
+        return;
+    }
+    float horizon = static_cast<float>(horizonMs / 1e3);
+
+    HeadPose source = getHeadPose(cameras);
+    HeadPose predicted = source;
+    predicted.position += linearVelocity * horizon;
+    float angularSpeed = glm::length(angularVelocity);
+    if (angularSpeed > 1e-6f) {
+        predicted.orientation = glm::normalize(glm::angleAxis(angularSpeed * horizon, angularVelocity / angularSpeed) * source.orientation);
+    }
+
+    // Move both eyes rigidly with the head: worldFromEye' = delta * worldFromEye, so view' = view * inverse(delta)
+    glm::mat4 worldFromSource = glm::translate(glm::mat4(1.0f), source.position) * glm::mat4_cast(source.orientation);
+    glm::mat4 worldFromPredicted = glm::translate(glm::mat4(1.0f), predicted.position) * glm::mat4_cast(predicted.orientation);
+    glm::mat4 predictedFromWorld = worldFromSource * glm::inverse(worldFromPredicted);
+    predictedCameras.setViewMatrices({
+        cameras.left.getViewMatrix() * predictedFromWorld,
+        cameras.right.getViewMatrix() * predictedFromWorld
+    });
+
+    if (pendingCount == POSE_PREDICTOR_MAX_PENDING) {
+        // Nothing is consuming predictions; drop the oldest
+        pendingStart = (pendingStart + 1) % POSE_PREDICTOR_MAX_PENDING;
+        pendingCount--;
+    }
+    pending[(pendingStart + pendingCount) % POSE_PREDICTOR_MAX_PENDING] = { lastTime + horizonMs / 1e3, predicted, source };
+    pendingCount++;
+}
+
+void PosePredictor::addErrorSample(const Prediction &prediction, const HeadPose &actual) {
+    double n = static_cast<double>(++stats.numSamples);
+    auto addToMean = [n](double &mean, double value) { mean += (value - mean) / n; };
+
+    addToMean(stats.positionErrorMm, 1e3 * glm::length(prediction.predicted.position - actual.position));
+    addToMean(stats.rotationErrorDeg, glm::degrees(angleBetween(prediction.predicted.orientation, actual.orientation)));
+    addToMean(stats.unpredictedPositionErrorMm, 1e3 * glm::length(prediction.source.position - actual.position));
+    addToMean(stats.unpredictedRotationErrorDeg, glm::degrees(angleBetween(prediction.source.orientation, actual.orientation)));
+}
@@ -0,0 +1,426 @@
+#include <mutex>
+#include <chrono>
+#include <vector>
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+#include <unordered_map>
+#include <unordered_set>
+
+#include <dirent.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include <spdlog/spdlog.h>
+
+#include <EGL/egl.h>
+#include <gfxwrapper_opengl.h>
+
+#include <ProgramBinaryCache.h>
+
+using namespace quasar;
+
+#if defined(QUEST_CLIENT_PROGRAM_BINARY_CACHE)
+
+// The original GL functions, which the wrappers at the bottom of this file stand in for (-Wl,--wrap)
+extern "C" {
+void __real_glCompileShader(GLuint shader);
+void __real_glGetShaderiv(GLuint shader, GLenum pname, GLint* params);
+void __real_glDeleteShader(GLuint shader);
+void __real_glLinkProgram(GLuint program);
+}
+
+typedef void (GL_APIENTRYP PFN_glMaxShaderCompilerThreadsKHR)(GLuint count);
+
+static constexpr uint32_t CACHE_FILE_MAGIC = 0x31425051; // "QPB1"
+static constexpr GLsizei MAX_ATTACHED_SHADERS = 8;
+
+#pragma pack(push, 1)
+// Followed by numShaders shader hashes (uint64_t) and binarySize bytes of program binary
+struct CacheFileHeader {
+    uint32_t magic = CACHE_FILE_MAGIC;
+    uint32_t binaryFormat;
+    uint32_t binarySize;
+    uint32_t numShaders;
+    uint64_t driverHash;
+    uint64_t programKey;
+};
+#pragma pack(pop)
+
+enum class ShaderState {
+    COMPILED,
+    // Part of a cached program, so not compiled unless the binary is rejected
+    CACHED,
+    // Compiling on the driver's threads; the status is checked at link
+    COMPILING
+};
+
+struct ShaderInfo {
+    uint64_t hash;
+    ShaderState state;
+};
+
+static struct {
+    std::mutex mutex;
+    bool enabled = false;
+    bool initialized = false;
+    std::string directory;
+
+    bool binariesSupported = false;
+    bool parallelCompile = false;
+    uint64_t driverHash = 0;
+
+    // Hashes of the shaders in the cached programs
+    std::unordered_set<uint64_t> cachedShaders;
+    std::unordered_map<GLuint, ShaderInfo> shaders;
+
+    ProgramBinaryCache::Stats stats;
+} cache;
+
+// FNV-1a
+static uint64_t hashBytes(const void* data, size_t size, uint64_t hash = 0xcbf29ce484222325ull) {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+static uint64_t hashString(const GLubyte* string, uint64_t hash) {
+    return string ? hashBytes(string, std::strlen(reinterpret_cast<const char*>(string)), hash) : hash;
+}
+
+static std::string getCacheFilePath(uint64_t programKey) {
+    char name[32];
+    std::snprintf(name, sizeof(name), "/%016llx.bin", static_cast<unsigned long long>(programKey));
+    return cache.directory + name;
+}
+
+// Reads the headers of the cached programs, deleting the ones from another driver. Called with the mutex held.
+static void scanCacheDirectory() {
+    DIR* dir = opendir(cache.directory.c_str());
+    if (dir == nullptr) {
+        return;
+    }
+    while (dirent* entry = readdir(dir)) {
+        std::string name = entry->d_name;
+        if (name.size() < 4 || name.compare(name.size() - 4, 4, ".bin") != 0) {
+            continue;
+        }
+        std::string path = cache.directory + "/" + name;
+        FILE* file = std::fopen(path.c_str(), "rb");
+        if (file == nullptr) {
+            continue;
+        }
+        CacheFileHeader header;
+        std::vector<uint64_t> shaderHashes;
+        bool valid = std::fread(&header, sizeof(header), 1, file) == 1 &&
+                     header.magic == CACHE_FILE_MAGIC && header.driverHash == cache.driverHash &&
+                     header.numShaders <= MAX_ATTACHED_SHADERS;
+        if (valid) {
+            shaderHashes.resize(header.numShaders);
+            valid = std::fread(shaderHashes.data(), sizeof(uint64_t), header.numShaders, file) == header.numShaders;
+        }
+        std::fclose(file);
+
+        if (!valid) {
+            unlink(path.c_str());
+            continue;
+        }
+        cache.cachedShaders.insert(shaderHashes.begin(), shaderHashes.end());
+    }
+    closedir(dir);
+}
+
+// Needs a current context, so done on the first compile. Called with the mutex held.
+static void initialize() {
+    cache.initialized = true;
+
+    uint64_t hash = hashBytes(&CACHE_FILE_MAGIC, sizeof(CACHE_FILE_MAGIC));
+    hash = hashString(glGetString(GL_VENDOR), hash);
+    hash = hashString(glGetString(GL_RENDERER), hash);
+    cache.driverHash = hashString(glGetString(GL_VERSION), hash);
+
+    GLint numBinaryFormats = 0;
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &numBinaryFormats);
+    cache.binariesSupported = numBinaryFormats > 0;
+
+    const char* extensions = (const char*)glGetString(GL_EXTENSIONS);
+    if (extensions != nullptr && strstr(extensions, "GL_KHR_parallel_shader_compile") != nullptr) {
+        auto glMaxShaderCompilerThreadsKHR = (PFN_glMaxShaderCompilerThreadsKHR)eglGetProcAddress("glMaxShaderCompilerThreadsKHR");
+        if (glMaxShaderCompilerThreadsKHR != nullptr) {
+            // Let the driver pick the number of threads
+            glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+            cache.parallelCompile = true;
+        }
+    }
+
+    if (cache.binariesSupported) {
+        mkdir(cache.directory.c_str(), 0755);
+        scanCacheDirectory();
+    }
+    spdlog::info("ProgramBinaryCache: {} cached shaders, binaries {}, parallel compile {}",
+                 cache.cachedShaders.size(), cache.binariesSupported ? "on" : "off", cache.parallelCompile ? "on" : "off");
+}
+
+// The source includes the #version line and defines, so variants of a shader hash differently
+static uint64_t hashShader(GLuint shader) {
+    GLint type = 0;
+    GLint sourceLength = 0;
+    __real_glGetShaderiv(shader, GL_SHADER_TYPE, &type);
+    __real_glGetShaderiv(shader, GL_SHADER_SOURCE_LENGTH, &sourceLength);
+
+    std::vector<char> source(std::max(sourceLength, 1));
+    glGetShaderSource(shader, sourceLength, nullptr, source.data());
+
+    uint64_t hash = hashBytes(&type, sizeof(type), cache.driverHash);
+    return hashBytes(source.data(), std::max(sourceLength - 1, 0), hash);
+}
+
+enum class LoadResult {
+    MISSING,
+    LOADED,
+    REJECTED
+};
+
+static LoadResult loadBinary(GLuint program, uint64_t programKey) {
+    std::string path = getCacheFilePath(programKey);
+    FILE* file = std::fopen(path.c_str(), "rb");
+    if (file == nullptr) {
+        return LoadResult::MISSING;
+    }
+    CacheFileHeader header;
+    std::vector<char> binary;
+    bool valid = std::fread(&header, sizeof(header), 1, file) == 1 &&
+                 header.magic == CACHE_FILE_MAGIC && header.driverHash == cache.driverHash &&
+                 header.programKey == programKey && header.numShaders <= MAX_ATTACHED_SHADERS &&
+                 std::fseek(file, header.numShaders * sizeof(uint64_t), SEEK_CUR) == 0;
+    if (valid) {
+        binary.resize(header.binarySize);
+        valid = std::fread(binary.data(), 1, binary.size(), file) == binary.size();
+    }
+    std::fclose(file);
+
+    if (valid) {
+        glProgramBinary(program, header.binaryFormat, binary.data(), static_cast<GLsizei>(binary.size()));
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        valid = linked == GL_TRUE;
+    }
+    if (!valid) {
+        unlink(path.c_str());
+        return LoadResult::REJECTED;
+    }
+    return LoadResult::LOADED;
+}
+
+static void storeBinary(GLuint program, uint64_t programKey, const std::vector<uint64_t> &shaderHashes) {
+    GLint binarySize = 0;
+    glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &binarySize);
+    if (binarySize <= 0) {
+        return;
+    }
+    CacheFileHeader header;
+    std::vector<char> binary(binarySize);
+    GLenum binaryFormat = 0;
+    glGetProgramBinary(program, binarySize, nullptr, &binaryFormat, binary.data());
+    header.binaryFormat = binaryFormat;
+    header.binarySize = static_cast<uint32_t>(binarySize);
+    header.numShaders = static_cast<uint32_t>(shaderHashes.size());
+    header.driverHash = cache.driverHash;
+    header.programKey = programKey;
+
+    // Written under a temporary name, so an interrupted write never leaves a truncated entry
+    std::string path = getCacheFilePath(programKey);
+    std::string tempPath = path + ".tmp";
+    FILE* file = std::fopen(tempPath.c_str(), "wb");
+    if (file == nullptr) {
+        return;
+    }
+    bool written = std::fwrite(&header, sizeof(header), 1, file) == 1 &&
+                   std::fwrite(shaderHashes.data(), sizeof(uint64_t), shaderHashes.size(), file) == shaderHashes.size() &&
+                   std::fwrite(binary.data(), 1, binary.size(), file) == binary.size();
+    written = (std::fclose(file) == 0) && written;
+    if (!written || std::rename(tempPath.c_str(), path.c_str()) != 0) {
+        unlink(tempPath.c_str());
+    }
+}
+
+static void compileShader(GLuint shader) {
+    {
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        if (cache.enabled) {
+            if (!cache.initialized) {
+                initialize();
+            }
+            uint64_t hash = hashShader(shader);
+            if (cache.cachedShaders.count(hash) > 0) {
+                cache.shaders[shader] = { hash, ShaderState::CACHED };
+                return;
+            }
+            cache.shaders[shader] = { hash, cache.parallelCompile ? ShaderState::COMPILING : ShaderState::COMPILED };
+        }
+    }
+    __real_glCompileShader(shader);
+}
+
+static void getShaderiv(GLuint shader, GLenum pname, GLint* params) {
+    if (pname == GL_COMPILE_STATUS || pname == GL_INFO_LOG_LENGTH) {
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        auto it = cache.shaders.find(shader);
+        // Querying the status would wait for (or need) the compile, so report success and check at link
+        if (it != cache.shaders.end() && it->second.state != ShaderState::COMPILED) {
+            *params = (pname == GL_COMPILE_STATUS) ? GL_TRUE : 0;
+            return;
+        }
+    }
+    __real_glGetShaderiv(shader, pname, params);
+}
+
+static void deleteShader(GLuint shader) {
+    __real_glDeleteShader(shader);
+    // A shader attached to a program is only flagged for deletion, and shaders are usually deleted right after
+    // attaching, before the link. A cached shader that hasn't been compiled yet still has to be at link, so its
+    // state is kept while the name lives. A later shader that reuses the name replaces it when compiled.
+    if (glIsShader(shader) == GL_FALSE) {
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        cache.shaders.erase(shader);
+    }
+}
+
+static void logCompileErrors(GLuint shader) {
+    GLint compiled = GL_FALSE;
+    __real_glGetShaderiv(shader, GL_COMPILE_STATUS, &compiled);
+    if (compiled == GL_TRUE) {
+        return;
+    }
+    GLint logLength = 0;
+    __real_glGetShaderiv(shader, GL_INFO_LOG_LENGTH, &logLength);
+    std::vector<char> log(std::max(logLength, 1));
+    glGetShaderInfoLog(shader, static_cast<GLsizei>(log.size()), nullptr, log.data());
+    spdlog::error("Failed to compile shader {}: {}", shader, log.data());
+}
+
+static void linkProgram(GLuint program) {
+    {
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        if (!cache.enabled || !cache.initialized) {
+            __real_glLinkProgram(program);
+            return;
+        }
+    }
+    auto startTime = std::chrono::steady_clock::now();
+
+    GLuint attached[MAX_ATTACHED_SHADERS];
+    GLsizei numAttached = 0;
+    glGetAttachedShaders(program, MAX_ATTACHED_SHADERS, &numAttached, attached);
+
+    std::vector<uint64_t> shaderHashes;
+    std::vector<GLuint> deferredShaders;
+    {
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        for (GLsizei i = 0; i < numAttached; i++) {
+            auto it = cache.shaders.find(attached[i]);
+            if (it == cache.shaders.end()) {
+                // Compiled before the cache was enabled
+                it = cache.shaders.emplace(attached[i], ShaderInfo{ hashShader(attached[i]), ShaderState::COMPILED }).first;
+            }
+            shaderHashes.push_back(it->second.hash);
+            if (it->second.state != ShaderState::COMPILED) {
+                deferredShaders.push_back(attached[i]);
+            }
+        }
+    }
+    // Attachment order isn't defined, so sort before hashing
+    std::sort(shaderHashes.begin(), shaderHashes.end());
+    uint64_t programKey = hashBytes(shaderHashes.data(), shaderHashes.size() * sizeof(uint64_t), cache.driverHash);
+
+    LoadResult loadResult = cache.binariesSupported ? loadBinary(program, programKey) : LoadResult::MISSING;
+    if (loadResult != LoadResult::LOADED) {
+        // Compile the shaders the binary would have stood in for, then link as usual
+        std::vector<GLuint> pendingShaders;
+        {
+            std::lock_guard<std::mutex> lock(cache.mutex);
+            for (GLuint shader : deferredShaders) {
+                ShaderInfo &info = cache.shaders[shader];
+                if (info.state == ShaderState::CACHED) {
+                    pendingShaders.push_back(shader);
+                }
+                info.state = ShaderState::COMPILED;
+            }
+        }
+        for (GLuint shader : pendingShaders) {
+            __real_glCompileShader(shader);
+        }
+
+        if (cache.binariesSupported) {
+            glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+        }
+        __real_glLinkProgram(program);
+
+        GLint linked = GL_FALSE;
+        glGetProgramiv(program, GL_LINK_STATUS, &linked);
+        if (linked == GL_TRUE) {
+            if (cache.binariesSupported) {
+                storeBinary(program, programKey, shaderHashes);
+            }
+        }
+        else {
+            // Compile errors weren't reported when the shaders were compiled
+            for (GLuint shader : deferredShaders) {
+                logCompileErrors(shader);
+            }
+        }
+
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        if (linked == GL_TRUE && cache.binariesSupported) {
+            cache.cachedShaders.insert(shaderHashes.begin(), shaderHashes.end());
+        }
+        cache.stats.misses++;
+        cache.stats.rejected += (loadResult == LoadResult::REJECTED) ? 1 : 0;
+    }
+    else {
+        std::lock_guard<std::mutex> lock(cache.mutex);
+        cache.stats.hits++;
+    }
+
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    cache.stats.linkTimeMs += std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startTime).count();
+}
+
+extern "C" {
+void __wrap_glCompileShader(GLuint shader) { compileShader(shader); }
+void __wrap_glGetShaderiv(GLuint shader, GLenum pname, GLint* params) { getShaderiv(shader, pname, params); }
+void __wrap_glDeleteShader(GLuint shader) { deleteShader(shader); }
+void __wrap_glLinkProgram(GLuint program) { linkProgram(program); }
+}
+
+void ProgramBinaryCache::enable(const std::string &directory) {
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    cache.directory = directory;
+    cache.enabled = true;
+}
+
+bool ProgramBinaryCache::isEnabled() {
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    return cache.enabled;
+}
+
+ProgramBinaryCache::Stats ProgramBinaryCache::getStats() {
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    return cache.stats;
+}
+
+#else
+
+void ProgramBinaryCache::enable(const std::string &) {}
+
+bool ProgramBinaryCache::isEnabled() {
+    return false;
+}
+
+ProgramBinaryCache::Stats ProgramBinaryCache::getStats() {
+    return {};
+}
+
+#endif
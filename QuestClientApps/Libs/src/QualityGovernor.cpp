@@ -0,0 +1,87 @@
+#include <algorithm>
+
+#include <QualityGovernor.h>
+
+using namespace quasar;
+
+bool QualityGovernor::update(const Sample &sample, double frameBudgetMs) {
+    if (!hasSample) {
+        stats.smoothedCPUTimeMs = sample.cpuTimeMs;
+        stats.smoothedDecodeTimeMs = sample.decodeTimeMs;
+        hasSample = true;
+    }
+    else {
+        stats.smoothedCPUTimeMs += params.smoothing * (sample.cpuTimeMs - stats.smoothedCPUTimeMs);
+        stats.smoothedDecodeTimeMs += params.smoothing * (sample.decodeTimeMs - stats.smoothedDecodeTimeMs);
+    }
+    // GPU results arrive frames late and not on every frame; frames without one would pull the time toward 0
+    if (sample.gpuTimeMs >= 0.0) {
+        if (!hasGPUSample) {
+            stats.smoothedGPUTimeMs = sample.gpuTimeMs;
+            hasGPUSample = true;
+        }
+        else {
+            stats.smoothedGPUTimeMs += params.smoothing * (sample.gpuTimeMs - stats.smoothedGPUTimeMs);
+        }
+    }
+    stats.missedFrames += sample.missedFrames;
+
+    if (frameBudgetMs <= 0.0) {
+        return false;
+    }
+
+    // CPU, GPU and decode overlap across frames, so the slowest of them sets the frame rate
+    double slowestMs = std::max({ stats.smoothedCPUTimeMs, stats.smoothedGPUTimeMs, stats.smoothedDecodeTimeMs });
+    stats.load = slowestMs / frameBudgetMs;
+
+    framesSinceChange++;
+
+    // Missed frames are counted over windows of stepDownFrames, since a late frame is usually followed by on-time ones
+    if (++missedWindowFrames > params.stepDownFrames) {
+        missedWindowFrames = 0;
+        recentMissedFrames = 0;
+    }
+    recentMissedFrames += sample.missedFrames;
+
+    if (stats.load > params.stepDownThreshold || sample.missedFrames > 0) {
+        overBudgetFrames++;
+        headroomFrames = 0;
+    }
+    else if (stats.load < params.stepUpThreshold) {
+        headroomFrames++;
+        overBudgetFrames = 0;
+    }
+    else {
+        // Between the thresholds: stay at this level
+        overBudgetFrames = 0;
+        headroomFrames = 0;
+    }
+
+    if (framesSinceChange < params.cooldownFrames) {
+        return false;
+    }
+
+    uint32_t newLevel = level;
+    bool overBudget = overBudgetFrames >= params.stepDownFrames || recentMissedFrames >= params.maxMissedFrames;
+    if (overBudget && level + 1 < params.numLevels) {
+        newLevel = level + 1;
+    }
+    else if (headroomFrames >= params.stepUpFrames && level > 0) {
+        newLevel = level - 1;
+    }
+
+    if (newLevel == level) {
+        return false;
+    }
+
+    if (newLevel > level) stats.stepDowns++;
+    else stats.stepUps++;
+
+    level = newLevel;
+    framesSinceChange = 0;
+    overBudgetFrames = 0;
+    headroomFrames = 0;
+    recentMissedFrames = 0;
+    missedWindowFrames = 0;
+    return true;
+}
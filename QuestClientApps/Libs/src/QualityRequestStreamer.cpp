@@ -0,0 +1,17 @@
+#include <spdlog/spdlog.h>
+
+#include <QualityRequestStreamer.h>
+
+using namespace quasar;
+
+QualityRequestStreamer::QualityRequestStreamer(const std::string &receiverURL)
+        : streamer(receiverURL) {}
+
+void QualityRequestStreamer::send(QualityRequest request) {
+    request.sequence = ++sequence;
+    request.serialize(data);
+    streamer.send(data);
+
+    spdlog::info("Requested quality level {} ({}x{}, depth factor {}, {:.0f}fps)",
+                 request.level, request.videoWidth, request.videoHeight, request.depthFactor, request.frameRate);
+}
@@ -0,0 +1,140 @@
+#include <algorithm>
+
+#include <RenderQueue.h>
+#include <UniformLocation.h>
+
+using namespace quasar;
+
+void RenderQueue::build(const Scene &scene, const Camera &camera) {
+    if (meshLOD != nullptr) {
+        // Both eyes see (nearly) the same projected size, so select levels once from between the eyes
+        if (camera.isVR()) {
+            const VRCamera &vrCamera = static_cast<const VRCamera&>(camera);
+            eyePosition = 0.5f * (vrCamera.left.getPosition() + vrCamera.right.getPosition());
+            projectionScale = vrCamera.left.getProjectionMatrix()[1][1];
+        }
+        else {
+            const PerspectiveCamera &perspectiveCamera = static_cast<const PerspectiveCamera&>(camera);
+            eyePosition = perspectiveCamera.getPosition();
+            projectionScale = perspectiveCamera.getProjectionMatrix()[1][1];
+        }
+        meshLOD->resetStats();
+    }
+
+    drawItems.clear();
+    passthroughNodes.clear();
+    for (Node* child : scene.rootNode.children) {
+        addNode(child, glm::mat4(1.0f), nullptr);
+    }
+
+    // The items are still in scene graph order, which is what the sorted draw is compared against
+    stats.unsortedShaderChanges = 0;
+    stats.unsortedMaterialBinds = 0;
+    for (size_t i = 0; i < drawItems.size(); i++) {
+        const DrawItem* prev = (i > 0) ? &drawItems[i - 1] : nullptr;
+        if (prev == nullptr || drawItems[i].shader != prev->shader) stats.unsortedShaderChanges++;
+        if (prev == nullptr || !sharesBinding(*prev, drawItems[i])) stats.unsortedMaterialBinds++;
+    }
+
+    // Sort by shader first (most expensive to switch), then material (textures, uniforms), then mesh (vertex arrays).
+    // Ties keep scene graph order within a group, which keeps transparent objects in their authored order.
+    // (std::sort on the order key instead of std::stable_sort, which allocates a scratch buffer every call.)
+    std::sort(drawItems.begin(), drawItems.end(), [](const DrawItem &a, const DrawItem &b) {
+        if (a.shader != b.shader) return a.shader < b.shader;
+        if (a.material != b.material) return a.material < b.material;
+        if (a.mesh != b.mesh) return a.mesh < b.mesh;
+        return a.order < b.order;
+    });
+}
+
+void RenderQueue::addNode(Node* node, const glm::mat4 &parentTransform, const Material* overrideMaterial) {
+    if (!node->visible) {
+        return;
+    }
+
+    // Wireframe and point/line nodes keep the renderer's own handling of their flags, children included
+    if (node->wireframe || node->primativeType != GL_TRIANGLES) {
+        passthroughNodes.push_back({ node, parentTransform, overrideMaterial });
+        return;
+    }
+
+    glm::mat4 model = parentTransform * node->getTransformParentFromLocal();
+
+    // Overrides set on a parent node apply to the whole subtree
+    const Material* materialToUse = (overrideMaterial != nullptr) ? overrideMaterial : node->overrideMaterial;
+    if (node->entity != nullptr) {
+        addEntity(node->entity, node, model, materialToUse);
+    }
+
+    for (Node* child : node->children) {
+        addNode(child, model, materialToUse);
+    }
+}
+
+void RenderQueue::addEntity(Entity* entity, const Node* node, const glm::mat4 &model, const Material* overrideMaterial) {
+    if (entity->getType() == EntityType::MODEL) {
+        // Models carry their own node hierarchy; flatten it into the same list
+        Model* modelEntity = static_cast<Model*>(entity);
+        addNode(&modelEntity->rootNode, model, overrideMaterial);
+        return;
+    }
+    if (entity->getType() != EntityType::MESH) {
+        return;
+    }
+
+    Mesh* mesh = static_cast<Mesh*>(entity);
+    if (meshLOD != nullptr) {
+        mesh = meshLOD->select(mesh, model, eyePosition, projectionScale);
+    }
+    const Material* material = (overrideMaterial != nullptr) ? overrideMaterial : mesh->material;
+    if (material == nullptr) {
+        return;
+    }
+
+    drawItems.push_back({
+        .mesh = mesh,
+        .material = material,
+        .overrideMaterial = overrideMaterial,
+        .shader = material->getShader(),
+        .model = model,
+        .frustumCulled = node->frustumCulled,
+        .order = static_cast<uint32_t>(drawItems.size())
+    });
+}
+
+RenderStats RenderQueue::draw(const Scene &scene, const Camera &camera) {
+    RenderStats renderStats;
+    stats.drawCalls = 0;
+    stats.shaderChanges = 0;
+    stats.materialBinds = 0;
+    stats.transformOnlyDraws = 0;
+    stats.passthroughNodes = static_cast<uint32_t>(passthroughNodes.size());
+
+    const DrawItem* prev = nullptr;
+    UniformLocation modelLocation, normalMatrixLocation;
+    for (const DrawItem &item : drawItems) {
+        if (prev == nullptr || item.shader != prev->shader) {
+            stats.shaderChanges++;
+            modelLocation = UniformLocation(*item.shader, "model");
+            normalMatrixLocation = UniformLocation(*item.shader, "normalMatrix");
+        }
+
+        if (prev != nullptr && sharesBinding(*prev, item)) {
+            // The program, textures and mesh uniforms are still bound from the previous draw
+            modelLocation.set(item.model);
+            if (normalMatrixLocation.isActive()) {
+                normalMatrixLocation.set(glm::transpose(glm::inverse(glm::mat3(item.model))));
+            }
+            stats.transformOnlyDraws++;
+        }
+        else {
+            item.mesh->bindMaterial(scene, item.model, item.overrideMaterial);
+            stats.materialBinds++;
+        }
+
+        renderStats += item.mesh->draw(GL_TRIANGLES, camera, item.model, item.frustumCulled, item.overrideMaterial);
+        stats.drawCalls++;
+        prev = &item;
+    }
+    return renderStats;
+}
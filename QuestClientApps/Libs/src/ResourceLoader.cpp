@@ -0,0 +1,283 @@
+#include <chrono>
+
+#include <spdlog/spdlog.h>
+
+#include <ResourceLoader.h>
+#include <Utils/BufferReadback.h>
+
+using namespace quasar;
+
+namespace {
+
+void collectMeshNodes(Node* node, std::vector<Node*> &meshNodes) {
+    if (node->entity != nullptr && node->entity->getType() == EntityType::MESH) {
+        meshNodes.push_back(node);
+    }
+    for (Node* child : node->children) {
+        collectMeshNodes(child, meshNodes);
+    }
+}
+
+} // namespace
+
+ResourceLoader::ResourceLoader(EGLDisplay display, EGLConfig config, EGLContext shareContext) : display(display) {
+    const EGLint contextAttribs[] = {
+        EGL_CONTEXT_CLIENT_VERSION, 3,
+        EGL_NONE
+    };
+    context = eglCreateContext(display, config, shareContext, contextAttribs);
+    if (context == EGL_NO_CONTEXT) {
+        spdlog::warn("ResourceLoader: failed to create a shared context (0x{:x}), loading on the render thread", eglGetError());
+        return;
+    }
+
+    // The worker never draws, but not every driver takes a context without a surface
+    const EGLint surfaceAttribs[] = {
+        EGL_WIDTH, 16,
+        EGL_HEIGHT, 16,
+        EGL_NONE
+    };
+    surface = eglCreatePbufferSurface(display, config, surfaceAttribs);
+    if (surface == EGL_NO_SURFACE) {
+        spdlog::warn("ResourceLoader: failed to create a pbuffer surface (0x{:x}), loading on the render thread", eglGetError());
+        eglDestroyContext(display, context);
+        context = EGL_NO_CONTEXT;
+        return;
+    }
+
+    // Only report support once the worker has the context current, otherwise queued jobs would never run
+    thread = std::thread(&ResourceLoader::run, this);
+    WorkerState state;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait(lock, [this] { return workerState != WorkerState::STARTING; });
+        state = workerState;
+    }
+    if (state == WorkerState::FAILED) {
+        spdlog::warn("ResourceLoader: loading on the render thread");
+        thread.join();
+        eglDestroySurface(display, surface);
+        eglDestroyContext(display, context);
+        surface = EGL_NO_SURFACE;
+        context = EGL_NO_CONTEXT;
+    }
+}
+
+ResourceLoader::~ResourceLoader() {
+    if (!isSupported()) {
+        return;
+    }
+
+    shutdown();
+
+    eglDestroySurface(display, surface);
+    eglDestroyContext(display, context);
+}
+
+void ResourceLoader::shutdown() {
+    if (!isSupported()) {
+        return;
+    }
+
+    // Destroyed outside the lock, along with whatever the jobs captured
+    std::deque<Job> droppedJobs;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (shouldStop) {
+            return;
+        }
+        shouldStop = true;
+        droppedJobs.swap(queuedJobs);
+    }
+    cv.notify_all();
+    thread.join();
+
+    // Jobs that never became ready are dropped; the context going away releases their GL objects
+    for (Job &job : loadedJobs) {
+        if (job.fence != 0) {
+            glDeleteSync(job.fence);
+        }
+    }
+    loadedJobs.clear();
+}
+
+void ResourceLoader::enqueue(std::function<void()> load, std::function<void()> onReady) {
+    if (!isSupported()) {
+        if (load) load();
+        if (onReady) onReady();
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        if (shouldStop) {
+            return;
+        }
+        queuedJobs.push_back({ std::move(load), std::move(onReady) });
+    }
+    cv.notify_one();
+}
+
+void ResourceLoader::update() {
+    while (true) {
+        Job job;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (loadedJobs.empty()) {
+                break;
+            }
+
+            // Jobs complete in order, so only the oldest fence needs checking
+            GLenum status = glClientWaitSync(loadedJobs.front().fence, 0, 0);
+            if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED) {
+                break;
+            }
+            job = std::move(loadedJobs.front());
+            loadedJobs.pop_front();
+            stats.jobsReady++;
+        }
+
+        glDeleteSync(job.fence);
+        if (job.onReady) {
+            job.onReady();
+        }
+    }
+}
+
+ResourceLoader::AdoptedMeshes ResourceLoader::adoptMeshes(const std::vector<Mesh*> &meshes, const VertexLayouts &layouts) {
+    AdoptedMeshes adoptedMeshes;
+
+    // Without the worker everything was created on this context already
+    if (!isSupported()) {
+        for (Mesh* mesh : meshes) {
+            adoptedMeshes.emplace(mesh, mesh);
+        }
+        return adoptedMeshes;
+    }
+
+    std::vector<Mesh*> originals;
+    for (Mesh* mesh : meshes) {
+        if (adoptedMeshes.count(mesh) != 0) {
+            continue;
+        }
+
+        auto layoutIt = layouts.find(mesh);
+        const VertexLayout layout = (layoutIt != layouts.end()) ? layoutIt->second : VertexLayout{};
+
+        // The new mesh's buffers are allocated empty and filled on the GPU from the originals'
+        GLint64 verticesSize = getBufferSize(mesh->vertexBuffer.ID);
+        GLint64 indicesSize = getBufferSize(mesh->indexBuffer.ID);
+        Mesh* adoptedMesh = new Mesh({
+            .verticesData = nullptr,
+            .verticesSize = static_cast<uint>(verticesSize / layout.vertexSize),
+            .indicesData = nullptr,
+            .indicesSize = static_cast<uint>(indicesSize / sizeof(uint32_t)),
+            .vertexSize = layout.vertexSize,
+            .attributes = layout.attributes,
+            .material = mesh->material
+        });
+        copyBuffer(mesh->vertexBuffer.ID, adoptedMesh->vertexBuffer.ID, verticesSize);
+        if (indicesSize > 0) {
+            copyBuffer(mesh->indexBuffer.ID, adoptedMesh->indexBuffer.ID, indicesSize);
+        }
+
+        // The material belongs to the adopted mesh now, so deleting the original doesn't free it
+        mesh->material = nullptr;
+
+        adoptedMeshes.emplace(mesh, adoptedMesh);
+        originals.push_back(mesh);
+    }
+
+    if (originals.empty()) {
+        return adoptedMeshes;
+    }
+
+    // The originals' vertex arrays only exist on the upload context, so they have to be deleted there,
+    // once the render context has copied out of their buffers
+    GLsync copied = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    glFlush();
+    enqueue([originals, copied]() {
+        while (glClientWaitSync(copied, 0, 1'000'000'000) == GL_TIMEOUT_EXPIRED) {}
+        glDeleteSync(copied);
+        for (Mesh* mesh : originals) {
+            delete mesh;
+        }
+    });
+
+    return adoptedMeshes;
+}
+
+ResourceLoader::AdoptedMeshes ResourceLoader::adoptModel(Model &model, const VertexLayouts &layouts) {
+    std::vector<Node*> meshNodes;
+    collectMeshNodes(&model.rootNode, meshNodes);
+
+    std::vector<Mesh*> meshes;
+    meshes.reserve(meshNodes.size());
+    for (Node* node : meshNodes) {
+        meshes.push_back(static_cast<Mesh*>(node->entity));
+    }
+
+    AdoptedMeshes adoptedMeshes = adoptMeshes(meshes, layouts);
+    for (Node* node : meshNodes) {
+        node->entity = adoptedMeshes.at(static_cast<Mesh*>(node->entity));
+    }
+    return adoptedMeshes;
+}
+
+bool ResourceLoader::isIdle() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return queuedJobs.empty() && loadedJobs.empty() && !loading;
+}
+
+ResourceLoader::Stats ResourceLoader::getStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+void ResourceLoader::run() {
+    bool current = eglMakeCurrent(display, surface, surface, context);
+    if (!current) {
+        spdlog::error("ResourceLoader: failed to make the upload context current (0x{:x})", eglGetError());
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        workerState = current ? WorkerState::RUNNING : WorkerState::FAILED;
+    }
+    cv.notify_all();
+    if (!current) {
+        return;
+    }
+
+    while (true) {
+        Job job;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this] { return shouldStop || !queuedJobs.empty(); });
+            if (shouldStop) {
+                break;
+            }
+            job = std::move(queuedJobs.front());
+            queuedJobs.pop_front();
+            loading = true;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        if (job.load) {
+            job.load();
+        }
+
+        // The render context may only use the results once the GPU has executed the uploads
+        job.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+        glFlush();
+
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stats.jobsLoaded++;
+            stats.lastLoadTimeMs = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start).count();
+            loadedJobs.push_back(std::move(job));
+            loading = false;
+        }
+    }
+
+    eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+}
@@ -0,0 +1,266 @@
+#include <algorithm>
+#include <unordered_set>
+
+#include <spdlog/spdlog.h>
+
+#include <Primitives/Model.h>
+
+#include <ShadowCache.h>
+#include <ClientShaders.h>
+
+using namespace quasar;
+
+ShadowCache::Passes ShadowCache::plan(const Scene &scene) {
+    framesSinceDynamicUpdate++;
+
+    if (lightChanged(scene)) {
+        dirty = true;
+    }
+
+    Passes passes;
+    if (!hasLight) {
+        stats.skipped++;
+        return passes;
+    }
+
+    // The sets of casters only change along with the scene graph
+    if (dirty) {
+        dynamicCasters.clear();
+        for (const Node* child : scene.rootNode.children) {
+            collectDynamicCasters(child);
+        }
+        collectStaticSubtrees(scene);
+        dynamicCasterTransforms.clear();
+    }
+
+    bool casterMoved = false;
+    if (!dynamicCasters.empty()) {
+        // World transforms, so a caster also counts as moved when one of its parents moves
+        currTransforms.clear();
+        for (const std::vector<const Node*> &path : dynamicCasters) {
+            glm::mat4 model(1.0f);
+            for (const Node* node : path) {
+                model = model * node->getTransformParentFromLocal();
+            }
+            currTransforms.push_back(model);
+        }
+        casterMoved = currTransforms != dynamicCasterTransforms;
+    }
+
+    bool dynamicUpdate = casterMoved && framesSinceDynamicUpdate >= dynamicUpdateInterval;
+    if (splitSupported) {
+        // A static pass leaves the dynamic casters out, so they are always drawn after it
+        passes.staticCasters = dirty;
+        passes.dynamicCasters = !dynamicCasters.empty() && (dirty || dynamicUpdate);
+    }
+    else {
+        passes.staticCasters = dirty || dynamicUpdate;
+    }
+
+    if (!passes.staticCasters && !passes.dynamicCasters) {
+        stats.skipped++;
+        return passes;
+    }
+
+    if (passes.staticCasters) {
+        stats.staticUpdates++;
+    }
+    if (passes.dynamicCasters) {
+        stats.dynamicUpdates++;
+    }
+    std::swap(dynamicCasterTransforms, currTransforms);
+    dirty = false;
+    framesSinceDynamicUpdate = 0;
+    return passes;
+}
+
+void ShadowCache::hideDynamicCasters() {
+    if (!splitSupported) {
+        return;
+    }
+    for (const std::vector<const Node*> &path : dynamicCasters) {
+        hide(path.back());
+    }
+}
+
+void ShadowCache::hideStaticCasters() {
+    for (const Node* node : staticSubtrees) {
+        hide(node);
+    }
+}
+
+void ShadowCache::restoreVisibility() {
+    for (Node* node : hiddenNodes) {
+        node->visible = true;
+    }
+    hiddenNodes.clear();
+}
+
+bool ShadowCache::storeStaticMap() {
+    GLint attachmentType = GL_NONE;
+    glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_TYPE, &attachmentType);
+    if (attachmentType != GL_TEXTURE) {
+        spdlog::warn("Shadow map depth is not a texture, re-rendering the whole shadow map when casters move");
+        splitSupported = false;
+        return false;
+    }
+
+    GLint shadowDepthTexture = 0;
+    glGetFramebufferAttachmentParameteriv(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_FRAMEBUFFER_ATTACHMENT_OBJECT_NAME, &shadowDepthTexture);
+
+    GLint width = 0, height = 0, format = 0;
+    glBindTexture(GL_TEXTURE_2D, shadowDepthTexture);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_WIDTH, &width);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_HEIGHT, &height);
+    glGetTexLevelParameteriv(GL_TEXTURE_2D, 0, GL_TEXTURE_INTERNAL_FORMAT, &format);
+
+    if (staticDepthTexture == 0 || width != staticDepthWidth || height != staticDepthHeight || format != staticDepthFormat) {
+        glDeleteTextures(1, &staticDepthTexture);
+        glGenTextures(1, &staticDepthTexture);
+        glBindTexture(GL_TEXTURE_2D, staticDepthTexture);
+        glTexStorage2D(GL_TEXTURE_2D, 1, format, width, height);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        staticDepthWidth = width;
+        staticDepthHeight = height;
+        staticDepthFormat = format;
+    }
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glCopyImageSubData(shadowDepthTexture, GL_TEXTURE_2D, 0, 0, 0, 0,
+                       staticDepthTexture, GL_TEXTURE_2D, 0, 0, 0, 0,
+                       width, height, 1);
+    return true;
+}
+
+void ShadowCache::compositeStaticMap() {
+    if (compositeShader == nullptr) {
+        compositeShader.reset(new Shader({
+            .vertexCodeData = SHADER_CLIENT_SHADOW_COMPOSITE_VERT,
+            .vertexCodeSize = SHADER_CLIENT_SHADOW_COMPOSITE_VERT_len,
+            .fragmentCodeData = SHADER_CLIENT_SHADOW_COMPOSITE_FRAG,
+            .fragmentCodeSize = SHADER_CLIENT_SHADOW_COMPOSITE_FRAG_len
+        }));
+        compositeShader->bind();
+        compositeShader->setInt("staticDepth", 0);
+    }
+
+    GLboolean depthTest = glIsEnabled(GL_DEPTH_TEST);
+    GLboolean cullFace = glIsEnabled(GL_CULL_FACE);
+    GLboolean depthMask;
+    glGetBooleanv(GL_DEPTH_WRITEMASK, &depthMask);
+    GLint depthFunc;
+    glGetIntegerv(GL_DEPTH_FUNC, &depthFunc);
+
+    // Depth only: a fragment from the static map is kept where it's nearer than the dynamic casters
+    glViewport(0, 0, staticDepthWidth, staticDepthHeight);
+    glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+    glEnable(GL_DEPTH_TEST);
+    glDepthFunc(GL_LESS);
+    glDepthMask(GL_TRUE);
+    glDisable(GL_CULL_FACE);
+
+    compositeShader->bind();
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D, staticDepthTexture);
+    glBindVertexArray(0);
+    glDrawArrays(GL_TRIANGLES, 0, 3);
+    glBindTexture(GL_TEXTURE_2D, 0);
+
+    glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+    glDepthFunc(depthFunc);
+    glDepthMask(depthMask);
+    if (!depthTest) {
+        glDisable(GL_DEPTH_TEST);
+    }
+    if (cullFace) {
+        glEnable(GL_CULL_FACE);
+    }
+}
+
+void ShadowCache::destroy() {
+    compositeShader.reset();
+    if (staticDepthTexture != 0) {
+        glDeleteTextures(1, &staticDepthTexture);
+        staticDepthTexture = 0;
+    }
+}
+
+bool ShadowCache::lightChanged(const Scene &scene) {
+    const DirectionalLight* light = scene.directionalLight;
+    if (light == nullptr) {
+        bool changed = hasLight;
+        hasLight = false;
+        return changed;
+    }
+
+    bool changed = !hasLight ||
+                   light->direction != lightDirection ||
+                   light->distance != lightDistance ||
+                   light->orthoBoxSize != lightOrthoBoxSize;
+
+    hasLight = true;
+    lightDirection = light->direction;
+    lightDistance = light->distance;
+    lightOrthoBoxSize = light->orthoBoxSize;
+    return changed;
+}
+
+void ShadowCache::collectDynamicCasters(const Node* node) {
+    currPath.push_back(node);
+    if (node->animation != nullptr || std::find(movingNodes.begin(), movingNodes.end(), node) != movingNodes.end()) {
+        dynamicCasters.push_back(currPath);
+    }
+    if (node->entity != nullptr && node->entity->getType() == EntityType::MODEL) {
+        collectDynamicCasters(&static_cast<const Model*>(node->entity)->rootNode);
+    }
+    for (const Node* child : node->children) {
+        collectDynamicCasters(child);
+    }
+    currPath.pop_back();
+}
+
+void ShadowCache::collectStaticSubtrees(const Scene &scene) {
+    // Everything below a dynamic caster is dynamic. Above one, the nodes on its path stay visible
+    // and their other children are static subtrees.
+    std::unordered_set<const Node*> casters;
+    for (const std::vector<const Node*> &path : dynamicCasters) {
+        casters.insert(path.back());
+    }
+    std::unordered_set<const Node*> ancestors;
+    for (const std::vector<const Node*> &path : dynamicCasters) {
+        for (const Node* node : path) {
+            if (casters.count(node) != 0) {
+                break;
+            }
+            ancestors.insert(node);
+        }
+    }
+
+    staticSubtrees.clear();
+    auto addStaticSubtree = [&](const Node* node) {
+        if (casters.count(node) == 0 && ancestors.count(node) == 0) {
+            staticSubtrees.push_back(node);
+        }
+    };
+    for (const Node* child : scene.rootNode.children) {
+        addStaticSubtree(child);
+    }
+    for (const Node* node : ancestors) {
+        if (node->entity != nullptr && node->entity->getType() == EntityType::MODEL) {
+            addStaticSubtree(&static_cast<const Model*>(node->entity)->rootNode);
+        }
+        for (const Node* child : node->children) {
+            addStaticSubtree(child);
+        }
+    }
+}
+
+void ShadowCache::hide(const Node* node) {
+    // The scene is const to the renderer, but visibility is restored before the frame goes on
+    Node* hiddenNode = const_cast<Node*>(node);
+    if (hiddenNode->visible) {
+        hiddenNode->visible = false;
+        hiddenNodes.push_back(hiddenNode);
+    }
+}
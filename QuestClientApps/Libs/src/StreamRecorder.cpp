@@ -0,0 +1,107 @@
+#include <cstring>
+#include <type_traits>
+
+#include <spdlog/spdlog.h>
+
+#include <glm/gtc/type_ptr.hpp>
+
+#include <StreamRecorder.h>
+
+using namespace quasar;
+
+StreamRecorder::StreamRecorder(const std::string &path)
+        : file(path, std::ios::binary | std::ios::trunc)
+        , startTime(std::chrono::steady_clock::now()) {
+    if (!file.is_open()) {
+        spdlog::error("StreamRecorder: failed to open {}", path);
+        return;
+    }
+
+    StreamFileHeader header;
+    header.poseSize = sizeof(Pose);
+    file.write(reinterpret_cast<const char*>(&header), sizeof(header));
+
+    thread = std::thread(&StreamRecorder::run, this);
+    spdlog::info("Recording streams to {}", path);
+}
+
+StreamRecorder::~StreamRecorder() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        shouldStop = true;
+    }
+    cv.notify_one();
+    // The writer drains the queue before exiting
+    if (thread.joinable()) {
+        thread.join();
+    }
+}
+
+void StreamRecorder::write(StreamChannel channel, const char* data, size_t size) {
+    if (!isOpen()) {
+        return;
+    }
+
+    Record record;
+    record.header.timeUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - startTime).count();
+    record.header.size = static_cast<uint32_t>(size);
+    record.header.channel = channel;
+    record.payload.assign(data, data + size);
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stats.records++;
+        stats.bytes += sizeof(StreamRecordHeader) + size;
+        records.push_back(std::move(record));
+    }
+    cv.notify_one();
+}
+
+void StreamRecorder::writePoseAck(pose_id_t poseID, const Pose &pose, double elapsedTimeMs) {
+    static_assert(std::is_trivially_copyable_v<Pose>, "POSE_ACK records store the Pose as laid out in memory");
+
+    // Apps look up the same pose every frame until a new one arrives
+    if (!ackedPoses.insert(poseID).second) {
+        return;
+    }
+
+    int64_t id = poseID;
+    char data[sizeof(id) + sizeof(elapsedTimeMs) + sizeof(Pose)];
+    std::memcpy(data, &id, sizeof(id));
+    std::memcpy(data + sizeof(id), &elapsedTimeMs, sizeof(elapsedTimeMs));
+    std::memcpy(data + sizeof(id) + sizeof(elapsedTimeMs), &pose, sizeof(Pose));
+    write(StreamChannel::POSE_ACK, data, sizeof(data));
+}
+
+void StreamRecorder::writeSentPose(const VRCamera &camera) {
+    StreamSentPose sentPose;
+    std::memcpy(sentPose.viewLeft, glm::value_ptr(camera.left.getViewMatrix()), sizeof(sentPose.viewLeft));
+    std::memcpy(sentPose.viewRight, glm::value_ptr(camera.right.getViewMatrix()), sizeof(sentPose.viewRight));
+    write(StreamChannel::POSE_SENT, reinterpret_cast<const char*>(&sentPose), sizeof(sentPose));
+}
+
+StreamRecorder::Stats StreamRecorder::getStats() {
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+void StreamRecorder::run() {
+    std::deque<Record> writing;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            cv.wait(lock, [this]() { return shouldStop || !records.empty(); });
+            if (records.empty() && shouldStop) {
+                break;
+            }
+            writing.swap(records);
+        }
+
+        for (const Record &record : writing) {
+            file.write(reinterpret_cast<const char*>(&record.header), sizeof(record.header));
+            file.write(record.payload.data(), record.payload.size());
+        }
+        writing.clear();
+    }
+    file.flush();
+}
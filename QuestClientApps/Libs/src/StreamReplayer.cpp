@@ -0,0 +1,130 @@
+#include <cstring>
+
+#include <spdlog/spdlog.h>
+
+#include <StreamReplayer.h>
+
+using namespace quasar;
+
+StreamReplayer::StreamReplayer(const std::string &path, const Params &params)
+        : params(params)
+        , file(path, std::ios::binary) {
+    if (!file.is_open()) {
+        spdlog::error("StreamReplayer: failed to open {}", path);
+        return;
+    }
+
+    StreamFileHeader header;
+    file.read(reinterpret_cast<char*>(&header), sizeof(header));
+    if (!file || header.magic != StreamFileHeader::MAGIC || header.version != StreamFileHeader::VERSION) {
+        spdlog::error("StreamReplayer: {} is not a stream recording (or from an unsupported version)", path);
+        file.close();
+        return;
+    }
+    firstRecord = file.tellg();
+    recordedPoseSize = header.poseSize;
+
+    if (header.poseSize == sizeof(Pose)) {
+        readPoseAcks();
+    }
+    else {
+        spdlog::warn("StreamReplayer: {} was recorded with a different Pose layout, frames won't resolve to poses", path);
+    }
+
+    hasNext = readRecord(nextHeader, nextPayload);
+    finished = !hasNext;
+    spdlog::info("Replaying streams from {} ({} poses)", path, poseAcks.size());
+}
+
+void StreamReplayer::setSink(StreamChannel channel, Sink sink) {
+    sinks[static_cast<size_t>(channel)] = std::move(sink);
+}
+
+void StreamReplayer::update(double dt) {
+    if (finished) {
+        return;
+    }
+
+    timeUs += dt * 1e+6 * params.speed;
+    while (hasNext && loopOffsetUs + nextHeader.timeUs <= timeUs) {
+        const Sink &sink = sinks[static_cast<size_t>(nextHeader.channel)];
+        if (sink) {
+            sink(nextPayload);
+        }
+        stats.records++;
+        stats.bytes += nextPayload.size();
+
+        uint64_t lastTimeUs = nextHeader.timeUs;
+        hasNext = readRecord(nextHeader, nextPayload);
+        if (!hasNext && params.loop) {
+            file.clear();
+            file.seekg(firstRecord);
+            loopOffsetUs += lastTimeUs;
+            stats.loops++;
+            hasNext = readRecord(nextHeader, nextPayload);
+        }
+    }
+    finished = !hasNext;
+}
+
+bool StreamReplayer::getPose(pose_id_t poseID, Pose* pose, double* elapsedTimeMs) const {
+    auto it = poseAcks.find(poseID);
+    if (it == poseAcks.end()) {
+        return false;
+    }
+    *pose = it->second.pose;
+    *elapsedTimeMs = it->second.elapsedTimeMs;
+    return true;
+}
+
+bool StreamReplayer::readRecord(StreamRecordHeader &header, std::vector<char> &payload) {
+    if (!file.read(reinterpret_cast<char*>(&header), sizeof(header))) {
+        return false;
+    }
+    if (!isValidHeader(header)) {
+        spdlog::error("StreamReplayer: invalid record ({} bytes on channel {}), ending the replay here",
+                      header.size, static_cast<int>(header.channel));
+        return false;
+    }
+    payload.resize(header.size);
+    // A recording cut off mid record (the app was killed) ends at the last whole one
+    return static_cast<bool>(file.read(payload.data(), header.size));
+}
+
+bool StreamReplayer::isValidHeader(const StreamRecordHeader &header) const {
+    switch (header.channel) {
+    case StreamChannel::VIDEO:
+    case StreamChannel::DEPTH_STREAM:
+    case StreamChannel::DEPTH_PACKETS:
+        return header.size <= StreamRecordHeader::MAX_SIZE;
+    case StreamChannel::POSE_ACK:
+        return header.size <= StreamRecordHeader::MAX_SIZE &&
+               header.size == sizeof(int64_t) + sizeof(double) + recordedPoseSize;
+    case StreamChannel::POSE_SENT:
+        return header.size == sizeof(StreamSentPose);
+    default:
+        return false;
+    }
+}
+
+void StreamReplayer::readPoseAcks() {
+    StreamRecordHeader header;
+    while (file.read(reinterpret_cast<char*>(&header), sizeof(header)) && isValidHeader(header)) {
+        if (header.channel != StreamChannel::POSE_ACK) {
+            file.seekg(header.size, std::ios::cur);
+            continue;
+        }
+
+        int64_t poseID;
+        PoseAck ack;
+        if (!file.read(reinterpret_cast<char*>(&poseID), sizeof(poseID)) ||
+            !file.read(reinterpret_cast<char*>(&ack.elapsedTimeMs), sizeof(ack.elapsedTimeMs)) ||
+            !file.read(reinterpret_cast<char*>(&ack.pose), sizeof(Pose))) {
+            break;
+        }
+        poseAcks.insert_or_assign(static_cast<pose_id_t>(poseID), ack);
+    }
+
+    file.clear();
+    file.seekg(firstRecord);
+}
@@ -0,0 +1,256 @@
+#include <cerrno>
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <spdlog/spdlog.h>
+
+#include <StreamTap.h>
+
+using namespace quasar;
+
+static constexpr int POLL_TIMEOUT_MS = 100;
+static constexpr size_t MAX_DATAGRAM_SIZE = 65536;
+// Largest payload of a UDP datagram over IPv4
+static constexpr size_t MAX_UDP_PAYLOAD = 65507;
+
+static sockaddr_in makeAddress(uint32_t host, uint16_t port) {
+    sockaddr_in address{};
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(host);
+    address.sin_port = htons(port);
+    return address;
+}
+
+static uint16_t getBoundPort(int fd) {
+    sockaddr_in address{};
+    socklen_t length = sizeof(address);
+    getsockname(fd, reinterpret_cast<sockaddr*>(&address), &length);
+    return ntohs(address.sin_port);
+}
+
+// Binds fd to a free port, for a receiver that binds its own socket. The port stays taken until fd is closed,
+// which is done right before the receiver is created (getLocalURL), so nothing else can take it in between.
+static uint16_t reserveUDPPort(int &fd) {
+    fd = socket(AF_INET, SOCK_DGRAM, 0);
+    sockaddr_in address = makeAddress(INADDR_ANY, 0);
+    if (fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+        return 0;
+    }
+    return getBoundPort(fd);
+}
+
+static bool sendAll(int fd, const char* data, size_t size) {
+    while (size > 0) {
+        ssize_t sent = send(fd, data, size, MSG_NOSIGNAL);
+        if (sent <= 0) {
+            return false;
+        }
+        data += sent;
+        size -= sent;
+    }
+    return true;
+}
+
+StreamTap::StreamTap(Protocol protocol, const std::string &remoteURL, StreamRecorder &recorder, StreamChannel channel)
+        : protocol(protocol)
+        , recorder(&recorder)
+        , channel(channel) {
+    size_t colon = remoteURL.rfind(':');
+    remoteHost = remoteURL.substr(0, colon);
+    remotePort = static_cast<uint16_t>(std::stoi(remoteURL.substr(colon + 1)));
+
+    if (openSockets()) {
+        thread = std::thread(protocol == Protocol::UDP ? &StreamTap::runUDP : &StreamTap::runTCP, this);
+    }
+}
+
+StreamTap::StreamTap(Protocol protocol)
+        : protocol(protocol) {
+    // Replaying UDP needs no thread, deliver() sends right away
+    if (openSockets() && protocol == Protocol::TCP) {
+        thread = std::thread(&StreamTap::runTCP, this);
+    }
+}
+
+StreamTap::~StreamTap() {
+    running = false;
+    if (thread.joinable()) {
+        thread.join();
+    }
+    if (socketFD >= 0) {
+        close(socketFD);
+    }
+    if (reservedFD >= 0) {
+        close(reservedFD);
+    }
+}
+
+std::string StreamTap::getLocalURL() {
+    if (protocol == Protocol::TCP) {
+        return "127.0.0.1:" + std::to_string(localPort);
+    }
+    // UDP receivers bind the port themselves, so it is let go here
+    if (reservedFD >= 0) {
+        close(reservedFD);
+        reservedFD = -1;
+    }
+    return "0.0.0.0:" + std::to_string(localPort);
+}
+
+void StreamTap::deliver(const std::vector<char> &data) {
+    if (protocol == Protocol::UDP) {
+        if (data.size() > MAX_UDP_PAYLOAD) {
+            spdlog::warn("StreamTap: dropping a {} byte record, larger than a datagram", data.size());
+            return;
+        }
+        // The socket is connected to the receiver, so a receiver that failed to bind shows up as a refused send
+        if (send(socketFD, data.data(), data.size(), 0) < 0 && errno == ECONNREFUSED && !warnedRefused) {
+            spdlog::warn("StreamTap: nothing is receiving on UDP port {}", localPort);
+            warnedRefused = true;
+        }
+        return;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    pending.push_back(data);
+}
+
+bool StreamTap::openSockets() {
+    if (protocol == Protocol::UDP) {
+        socketFD = socket(AF_INET, SOCK_DGRAM, 0);
+        localPort = reserveUDPPort(reservedFD);
+        if (localPort == 0) {
+            spdlog::error("StreamTap: failed to reserve a UDP port");
+            return false;
+        }
+        if (recorder == nullptr) {
+            sockaddr_in receiver = makeAddress(INADDR_LOOPBACK, localPort);
+            connect(socketFD, reinterpret_cast<sockaddr*>(&receiver), sizeof(receiver));
+        }
+        else {
+            // Take the port the server sends to
+            int reuse = 1;
+            setsockopt(socketFD, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+            sockaddr_in address = makeAddress(INADDR_ANY, remotePort);
+            if (bind(socketFD, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) {
+                spdlog::error("StreamTap: failed to bind UDP port {}", remotePort);
+                return false;
+            }
+        }
+    }
+    else {
+        socketFD = socket(AF_INET, SOCK_STREAM, 0);
+        sockaddr_in address = makeAddress(INADDR_LOOPBACK, 0);
+        if (bind(socketFD, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || listen(socketFD, 1) < 0) {
+            spdlog::error("StreamTap: failed to listen on the loopback interface");
+            return false;
+        }
+        localPort = getBoundPort(socketFD);
+    }
+    return socketFD >= 0;
+}
+
+void StreamTap::runUDP() {
+    std::vector<char> datagram(MAX_DATAGRAM_SIZE);
+    sockaddr_in receiver = makeAddress(INADDR_LOOPBACK, localPort);
+
+    pollfd fds = { socketFD, POLLIN, 0 };
+    while (running) {
+        if (poll(&fds, 1, POLL_TIMEOUT_MS) <= 0) {
+            continue;
+        }
+        ssize_t size = recv(socketFD, datagram.data(), datagram.size(), 0);
+        if (size <= 0) {
+            continue;
+        }
+        recorder->write(channel, datagram.data(), size);
+        sendto(socketFD, datagram.data(), size, 0, reinterpret_cast<sockaddr*>(&receiver), sizeof(receiver));
+    }
+}
+
+void StreamTap::runTCP() {
+    pollfd fds = { socketFD, POLLIN, 0 };
+    while (running) {
+        if (poll(&fds, 1, POLL_TIMEOUT_MS) <= 0) {
+            continue;
+        }
+        int clientFD = accept(socketFD, nullptr, nullptr);
+        if (clientFD < 0) {
+            continue;
+        }
+        // The receiver reconnects if the connection drops
+        serveTCP(clientFD);
+        close(clientFD);
+    }
+}
+
+void StreamTap::serveTCP(int clientFD) {
+    if (recorder == nullptr) {
+        pollfd fds = { clientFD, POLLIN, 0 };
+        char discard[256];
+        while (running) {
+            std::deque<std::vector<char>> sending;
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                sending.swap(pending);
+            }
+            for (const std::vector<char> &data : sending) {
+                if (!sendAll(clientFD, data.data(), data.size())) {
+                    return;
+                }
+            }
+
+            // Short timeout: deliver() has no way to wake this thread
+            if (poll(&fds, 1, 1) > 0 && recv(clientFD, discard, sizeof(discard), 0) <= 0) {
+                return;
+            }
+        }
+        return;
+    }
+
+    addrinfo hints{};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* serverAddress = nullptr;
+    if (getaddrinfo(remoteHost.c_str(), std::to_string(remotePort).c_str(), &hints, &serverAddress) != 0) {
+        spdlog::error("StreamTap: failed to resolve {}", remoteHost);
+        return;
+    }
+    int serverFD = socket(AF_INET, SOCK_STREAM, 0);
+    bool connected = connect(serverFD, serverAddress->ai_addr, serverAddress->ai_addrlen) == 0;
+    freeaddrinfo(serverAddress);
+    if (!connected) {
+        close(serverFD);
+        return;
+    }
+
+    std::vector<char> buffer(MAX_DATAGRAM_SIZE);
+    pollfd fds[2] = { { serverFD, POLLIN, 0 }, { clientFD, POLLIN, 0 } };
+    while (running) {
+        if (poll(fds, 2, POLL_TIMEOUT_MS) <= 0) {
+            continue;
+        }
+        if (fds[0].revents != 0) {
+            ssize_t size = recv(serverFD, buffer.data(), buffer.size(), 0);
+            if (size <= 0) {
+                break;
+            }
+            recorder->write(channel, buffer.data(), size);
+            if (!sendAll(clientFD, buffer.data(), size)) {
+                break;
+            }
+        }
+        if (fds[1].revents != 0) {
+            ssize_t size = recv(clientFD, buffer.data(), buffer.size(), 0);
+            if (size <= 0 || !sendAll(serverFD, buffer.data(), size)) {
+                break;
+            }
+        }
+    }
+    close(serverFD);
+}
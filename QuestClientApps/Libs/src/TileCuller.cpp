@@ -0,0 +1,84 @@
+#include <algorithm>
+
+#include <TileCuller.h>
+
+#include <ClientShaders.h>
+
+using namespace quasar;
+
+TileCuller::TileCuller(uint maxIndices, uint vertexSize)
+        : numTiles(((maxIndices / 3) + TILE_CULL_TRIANGLES_PER_TILE - 1) / TILE_CULL_TRIANGLES_PER_TILE)
+        , vertexStride(vertexSize / sizeof(float))
+        , sourceIndexBuffer(GL_SHADER_STORAGE_BUFFER, maxIndices, sizeof(GLuint), nullptr, GL_DYNAMIC_DRAW)
+        , tileBuffer(GL_SHADER_STORAGE_BUFFER, numTiles, sizeof(Tile), nullptr, GL_DYNAMIC_DRAW)
+        , tileBoundsShader({
+            .computeCodeData = SHADER_CLIENT_TILE_BOUNDS_COMP,
+            .computeCodeSize = SHADER_CLIENT_TILE_BOUNDS_COMP_len,
+            .defines = {
+                "#define TRIANGLES_PER_TILE " + std::to_string(TILE_CULL_TRIANGLES_PER_TILE)
+            }
+        })
+        , tileCullShader({
+            .computeCodeData = SHADER_CLIENT_TILE_CULL_COMP,
+            .computeCodeSize = SHADER_CLIENT_TILE_CULL_COMP_len,
+            .defines = {
+                "#define TRIANGLES_PER_TILE " + std::to_string(TILE_CULL_TRIANGLES_PER_TILE)
+            }
+        }) {
+    // Large meshes have more tiles than fit in one dispatch dimension
+    numGroups.x = std::min(std::max(numTiles, 1u), (uint)TILE_CULL_MAX_GROUPS_X);
+    numGroups.y = (numTiles + numGroups.x - 1) / numGroups.x;
+
+    boundsUniforms.numIndices = UniformLocation(tileBoundsShader, "numIndices");
+    boundsUniforms.numTiles = UniformLocation(tileBoundsShader, "numTiles");
+    boundsUniforms.vertexStride = UniformLocation(tileBoundsShader, "vertexStride");
+
+    cullUniforms.resetCommand = UniformLocation(tileCullShader, "resetCommand");
+    cullUniforms.numTiles = UniformLocation(tileCullShader, "numTiles");
+    cullUniforms.model = UniformLocation(tileCullShader, "model");
+    StereoCameraBuffer::attach(tileCullShader);
+}
+
+void TileCuller::update(const Mesh &mesh, int numIndices) {
+    tileBoundsShader.bind();
+    {
+        boundsUniforms.numIndices.set(numIndices);
+        boundsUniforms.numTiles.set(static_cast<int>(numTiles));
+        boundsUniforms.vertexStride.set(static_cast<int>(vertexStride));
+    }
+    {
+        tileBoundsShader.setBuffer(GL_SHADER_STORAGE_BUFFER, 0, mesh.vertexBuffer);
+        tileBoundsShader.setBuffer(GL_SHADER_STORAGE_BUFFER, 1, mesh.indexBuffer);
+        tileBoundsShader.setBuffer(GL_SHADER_STORAGE_BUFFER, 2, mesh.indirectBuffer);
+        tileBoundsShader.setBuffer(GL_SHADER_STORAGE_BUFFER, 3, sourceIndexBuffer);
+        tileBoundsShader.setBuffer(GL_SHADER_STORAGE_BUFFER, 4, tileBuffer);
+    }
+    // The generator's writes must be visible to storage buffer reads, not just to vertex fetch
+    tileBoundsShader.memoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+    tileBoundsShader.dispatch(numGroups.x, numGroups.y, 1);
+    tileBoundsShader.memoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void TileCuller::cull(const Mesh &mesh, const StereoCameraBuffer &cameraBuffer, const glm::mat4 &model) {
+    tileCullShader.bind();
+    {
+        cullUniforms.numTiles.set(static_cast<int>(numTiles));
+        cullUniforms.model.set(model);
+        cameraBuffer.bind();
+    }
+    {
+        tileCullShader.setBuffer(GL_SHADER_STORAGE_BUFFER, 0, sourceIndexBuffer);
+        tileCullShader.setBuffer(GL_SHADER_STORAGE_BUFFER, 1, mesh.indexBuffer);
+        tileCullShader.setBuffer(GL_SHADER_STORAGE_BUFFER, 2, mesh.indirectBuffer);
+        tileCullShader.setBuffer(GL_SHADER_STORAGE_BUFFER, 3, tileBuffer);
+    }
+
+    // Clear the draw command, then append the indices of every visible tile to it
+    cullUniforms.resetCommand.set(true);
+    tileCullShader.dispatch(1, 1, 1);
+    tileCullShader.memoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    cullUniforms.resetCommand.set(false);
+    tileCullShader.dispatch(numGroups.x, numGroups.y, 1);
+    tileCullShader.memoryBarrier(GL_ELEMENT_ARRAY_BARRIER_BIT | GL_COMMAND_BARRIER_BIT);
+}
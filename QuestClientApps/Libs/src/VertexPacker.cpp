@@ -0,0 +1,332 @@
+#include <cmath>
+#include <limits>
+#include <cstring>
+#include <algorithm>
+#include <unordered_map>
+
+#include <glm/packing.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include <spdlog/spdlog.h>
+
+#include <VertexPacker.h>
+#include <ClientShaders.h>
+#include <Utils/BufferReadback.h>
+
+#define PACK_THREADS_PER_GROUP 256
+#define PACK_MAX_GROUPS_X 65535
+
+using namespace quasar;
+
+namespace {
+
+// GL_INT_2_10_10_10_REV, normalized
+uint32_t packSnorm1010102(const glm::vec4 &v) {
+    glm::vec4 c = glm::clamp(v, -1.0f, 1.0f) * glm::vec4(511.0f, 511.0f, 511.0f, 1.0f);
+    glm::ivec4 q = glm::ivec4(glm::round(c));
+    return (uint32_t(q.x) & 0x3FFu) | ((uint32_t(q.y) & 0x3FFu) << 10) | ((uint32_t(q.z) & 0x3FFu) << 20) | ((uint32_t(q.w) & 0x3u) << 30);
+}
+
+void collectMeshNodes(Node* node, std::vector<Node*> &meshNodes) {
+    if (node->entity != nullptr && node->entity->getType() == EntityType::MESH) {
+        meshNodes.push_back(node);
+    }
+    for (Node* child : node->children) {
+        collectMeshNodes(child, meshNodes);
+    }
+}
+
+} // namespace
+
+VertexPacker::VertexPacker(uint sourceVertexSize, const std::vector<VertexInputAttribute> &sourceAttributes,
+                           const VertexSemantics &semantics, const PackedVertexFormat &format)
+        : format(format)
+        , sourceStride(sourceVertexSize / sizeof(uint32_t))
+        , packedStride(0) {
+    for (const VertexInputAttribute &sourceAttribute : sourceAttributes) {
+        int offset = static_cast<int>(sourceAttribute.offset);
+
+        Attribute attribute;
+        attribute.sourceOffset = offset / static_cast<int>(sizeof(uint32_t));
+        attribute.packedOffset = static_cast<int>(packedStride);
+        attribute.components = sourceAttribute.size;
+
+        VertexInputAttribute packedAttribute = sourceAttribute;
+        packedAttribute.offset = packedStride * sizeof(uint32_t);
+
+        if (offset == semantics.position) {
+            attribute.op = Op::POSITION;
+            bool snorm = format.position == PackedVertexFormat::Position::SNORM16;
+            packedAttribute.size = 3;
+            packedAttribute.type = snorm ? GL_SHORT : GL_HALF_FLOAT;
+            packedAttribute.normalized = snorm ? GL_TRUE : GL_FALSE;
+            packedStride += 2;
+        }
+        else if (offset == semantics.normal || offset == semantics.tangent) {
+            attribute.op = Op::DIRECTION;
+            packedAttribute.size = 4;
+            packedAttribute.type = GL_INT_2_10_10_10_REV;
+            packedAttribute.normalized = GL_TRUE;
+            packedStride += 1;
+        }
+        else if (offset == semantics.texCoords) {
+            attribute.op = Op::TEXCOORDS;
+            bool halfFloat = format.texCoords == PackedVertexFormat::TexCoords::HALF_FLOAT;
+            packedAttribute.size = 2;
+            packedAttribute.type = halfFloat ? GL_HALF_FLOAT : GL_UNSIGNED_SHORT;
+            packedAttribute.normalized = halfFloat ? GL_FALSE : GL_TRUE;
+            packedStride += 1;
+        }
+        else if (offset == semantics.color) {
+            attribute.op = Op::COLOR;
+            packedAttribute.size = 4;
+            packedAttribute.type = GL_UNSIGNED_BYTE;
+            packedAttribute.normalized = GL_TRUE;
+            packedStride += 1;
+        }
+        else {
+            // Everything else has 32 bit components and is copied as is
+            attribute.op = Op::COPY;
+            packedStride += sourceAttribute.size;
+        }
+
+        attributes.push_back(attribute);
+        packedAttributes.push_back(packedAttribute);
+    }
+
+    if (attributes.size() > VERTEX_PACKER_MAX_ATTRIBUTES) {
+        spdlog::error("VertexPacker supports at most {} attributes, got {}", VERTEX_PACKER_MAX_ATTRIBUTES, attributes.size());
+        attributes.resize(VERTEX_PACKER_MAX_ATTRIBUTES);
+        packedAttributes.resize(VERTEX_PACKER_MAX_ATTRIBUTES);
+    }
+}
+
+void VertexPacker::setBounds(const glm::vec3 &center, const glm::vec3 &halfExtent) {
+    boxCenter = center;
+    // Flat meshes have a zero extent along one axis
+    boxHalfExtent = glm::max(halfExtent, glm::vec3(1e-6f));
+}
+
+glm::mat4 VertexPacker::getDequantizeTransform() const {
+    glm::mat4 transform = glm::translate(glm::mat4(1.0f), boxCenter);
+    if (format.position == PackedVertexFormat::Position::SNORM16) {
+        transform = glm::scale(transform, boxHalfExtent);
+    }
+    return transform;
+}
+
+void VertexPacker::pack(const void* vertices, uint numVertices, void* packedVertices) const {
+    const uint32_t* source = static_cast<const uint32_t*>(vertices);
+    uint32_t* packed = static_cast<uint32_t*>(packedVertices);
+
+    auto readFloat = [](const uint32_t* word) {
+        float f;
+        std::memcpy(&f, word, sizeof(float));
+        return f;
+    };
+    auto readVec3 = [&](const uint32_t* word) {
+        return glm::vec3(readFloat(word), readFloat(word + 1), readFloat(word + 2));
+    };
+
+    for (uint v = 0; v < numVertices; v++) {
+        const uint32_t* src = source + v * sourceStride;
+        uint32_t* dst = packed + v * packedStride;
+
+        for (const Attribute &attribute : attributes) {
+            const uint32_t* in = src + attribute.sourceOffset;
+            uint32_t* out = dst + attribute.packedOffset;
+
+            switch (attribute.op) {
+            case Op::POSITION: {
+                glm::vec3 p = readVec3(in) - boxCenter;
+                if (format.position == PackedVertexFormat::Position::SNORM16) {
+                    p /= boxHalfExtent;
+                    out[0] = glm::packSnorm2x16(glm::vec2(p.x, p.y));
+                    out[1] = glm::packSnorm2x16(glm::vec2(p.z, 1.0f));
+                }
+                else {
+                    out[0] = glm::packHalf2x16(glm::vec2(p.x, p.y));
+                    out[1] = glm::packHalf2x16(glm::vec2(p.z, 1.0f));
+                }
+                break;
+            }
+            case Op::DIRECTION: {
+                glm::vec3 d = readVec3(in);
+                float length = glm::length(d);
+                d = (length > 0.0f) ? d / length : d;
+                float w = (attribute.components > 3) ? glm::sign(readFloat(in + 3)) : 0.0f;
+                out[0] = packSnorm1010102(glm::vec4(d, w));
+                break;
+            }
+            case Op::TEXCOORDS: {
+                glm::vec2 uv(readFloat(in), readFloat(in + 1));
+                out[0] = (format.texCoords == PackedVertexFormat::TexCoords::HALF_FLOAT) ? glm::packHalf2x16(uv) : glm::packUnorm2x16(uv);
+                break;
+            }
+            case Op::COLOR: {
+                glm::vec4 color(readVec3(in), (attribute.components > 3) ? readFloat(in + 3) : 1.0f);
+                out[0] = glm::packUnorm4x8(color);
+                break;
+            }
+            case Op::COPY:
+                std::memcpy(out, in, attribute.components * sizeof(uint32_t));
+                break;
+            }
+        }
+    }
+}
+
+void VertexPacker::pack(const Buffer &source, uint numVertices, const Mesh &packedMesh) {
+    if (packShader == nullptr) {
+        packShader.reset(new ComputeShader({
+            .computeCodeData = SHADER_CLIENT_PACK_VERTICES_COMP,
+            .computeCodeSize = SHADER_CLIENT_PACK_VERTICES_COMP_len
+        }));
+        packUniforms.numVertices = UniformLocation(*packShader, "numVertices");
+        packUniforms.sourceStride = UniformLocation(*packShader, "sourceStride");
+        packUniforms.packedStride = UniformLocation(*packShader, "packedStride");
+        packUniforms.numOps = UniformLocation(*packShader, "numOps");
+        packUniforms.ops = UniformLocation(*packShader, "ops");
+        packUniforms.positionSnorm16 = UniformLocation(*packShader, "positionSnorm16");
+        packUniforms.texCoordsHalfFloat = UniformLocation(*packShader, "texCoordsHalfFloat");
+        packUniforms.boxCenter = UniformLocation(*packShader, "boxCenter");
+        packUniforms.boxInvHalfExtent = UniformLocation(*packShader, "boxInvHalfExtent");
+    }
+
+    glm::ivec4 ops[VERTEX_PACKER_MAX_ATTRIBUTES];
+    for (size_t i = 0; i < attributes.size(); i++) {
+        ops[i] = glm::ivec4(static_cast<int>(attributes[i].op), attributes[i].sourceOffset, attributes[i].packedOffset, attributes[i].components);
+    }
+
+    packShader->bind();
+    {
+        packUniforms.numVertices.set(static_cast<int>(numVertices));
+        packUniforms.sourceStride.set(static_cast<int>(sourceStride));
+        packUniforms.packedStride.set(static_cast<int>(packedStride));
+        packUniforms.numOps.set(static_cast<int>(attributes.size()));
+        packUniforms.ops.set(ops, static_cast<GLsizei>(attributes.size()));
+
+        packUniforms.positionSnorm16.set(format.position == PackedVertexFormat::Position::SNORM16);
+        packUniforms.texCoordsHalfFloat.set(format.texCoords == PackedVertexFormat::TexCoords::HALF_FLOAT);
+        packUniforms.boxCenter.set(boxCenter);
+        packUniforms.boxInvHalfExtent.set(1.0f / boxHalfExtent);
+    }
+    {
+        packShader->setBuffer(GL_SHADER_STORAGE_BUFFER, 0, source);
+        packShader->setBuffer(GL_SHADER_STORAGE_BUFFER, 1, packedMesh.vertexBuffer);
+    }
+
+    // The generator's writes must be visible to storage buffer reads
+    packShader->memoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT);
+
+    uint numGroups = (numVertices + PACK_THREADS_PER_GROUP - 1) / PACK_THREADS_PER_GROUP;
+    uint numGroupsX = std::min(std::max(numGroups, 1u), (uint)PACK_MAX_GROUPS_X);
+    packShader->dispatch(numGroupsX, (numGroups + numGroupsX - 1) / numGroupsX, 1);
+    packShader->memoryBarrier(GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT);
+}
+
+VertexLayouts VertexPacker::packModel(Model &model, const PackedVertexFormat &format) {
+    std::vector<Node*> meshNodes;
+    collectMeshNodes(&model.rootNode, meshNodes);
+
+    struct PackedMesh {
+        Mesh* mesh;
+        glm::vec3 center;
+        glm::vec3 halfExtent;
+    };
+    // Meshes shared by several nodes are only packed once
+    std::unordered_map<Mesh*, PackedMesh> packedMeshes;
+    VertexLayouts layouts;
+
+    PackedVertexFormat meshFormat = format;
+    meshFormat.position = PackedVertexFormat::Position::SNORM16;
+
+    uint64_t sourceBytes = 0, packedBytes = 0;
+    std::vector<uint8_t> vertices, packedVertices;
+    std::vector<uint32_t> indices;
+    for (Node* node : meshNodes) {
+        Mesh* mesh = static_cast<Mesh*>(node->entity);
+
+        auto it = packedMeshes.find(mesh);
+        if (it == packedMeshes.end()) {
+            GLint64 verticesSize = getBufferSize(mesh->vertexBuffer.ID);
+            GLint64 indicesSize = getBufferSize(mesh->indexBuffer.ID);
+            if (verticesSize == 0 || verticesSize % sizeof(Vertex) != 0) {
+                continue;
+            }
+            uint numVertices = static_cast<uint>(verticesSize / sizeof(Vertex));
+
+            vertices.resize(verticesSize);
+            indices.resize(indicesSize / sizeof(uint32_t));
+            if (!readBuffer(mesh->vertexBuffer.ID, vertices.data(), verticesSize) ||
+                (indicesSize > 0 && !readBuffer(mesh->indexBuffer.ID, indices.data(), indicesSize))) {
+                spdlog::warn("Failed to read back mesh data, leaving mesh unpacked");
+                continue;
+            }
+
+            const Vertex* source = reinterpret_cast<const Vertex*>(vertices.data());
+            glm::vec3 boundsMin(std::numeric_limits<float>::max());
+            glm::vec3 boundsMax(std::numeric_limits<float>::lowest());
+            bool tiledTexCoords = false;
+            for (uint i = 0; i < numVertices; i++) {
+                boundsMin = glm::min(boundsMin, source[i].position);
+                boundsMax = glm::max(boundsMax, source[i].position);
+                tiledTexCoords |= glm::any(glm::lessThan(source[i].texCoords, glm::vec2(0.0f))) ||
+                                  glm::any(glm::greaterThan(source[i].texCoords, glm::vec2(1.0f)));
+            }
+
+            // unorm16 can't hold texture coordinates outside [0, 1]
+            if (tiledTexCoords) {
+                meshFormat.texCoords = PackedVertexFormat::TexCoords::HALF_FLOAT;
+            }
+            else {
+                meshFormat.texCoords = format.texCoords;
+            }
+
+            // The dequantization scale ends up in the node's normal matrix, which degenerates for flat meshes,
+            // so quantize over the bounding cube. Thin axes get the same absolute precision as the longest one
+            // instead of their own full range.
+            glm::vec3 halfExtent = 0.5f * (boundsMax - boundsMin);
+            float maxHalfExtent = std::max(halfExtent.x, std::max(halfExtent.y, halfExtent.z));
+
+            VertexPacker packer(sizeof(Vertex), Vertex::getVertexInputAttributes(), VertexSemantics::forVertex(), meshFormat);
+            packer.setBounds(0.5f * (boundsMin + boundsMax), glm::vec3(maxHalfExtent));
+            packedVertices.resize(numVertices * packer.getVertexSize());
+            packer.pack(vertices.data(), numVertices, packedVertices.data());
+
+            Mesh* packedMesh = new Mesh({
+                .verticesData = packedVertices.data(),
+                .verticesSize = numVertices,
+                .indicesData = indices.data(),
+                .indicesSize = static_cast<uint>(indices.size()),
+                .vertexSize = packer.getVertexSize(),
+                .attributes = packer.getAttributes(),
+                .material = mesh->material
+            });
+            it = packedMeshes.emplace(mesh, PackedMesh{ packedMesh, packer.boxCenter, packer.boxHalfExtent }).first;
+            layouts[packedMesh] = { packer.getVertexSize(), packer.getAttributes() };
+
+            sourceBytes += verticesSize;
+            packedBytes += packedVertices.size();
+        }
+
+        // The dequantization goes in a child node, so it doesn't apply to the node's children
+        const PackedMesh &packedMesh = it->second;
+        Node* meshNode = new Node(packedMesh.mesh);
+        meshNode->setPosition(packedMesh.center);
+        meshNode->setScale(packedMesh.halfExtent);
+        meshNode->frustumCulled = node->frustumCulled;
+        meshNode->primativeType = node->primativeType;
+        node->entity = nullptr;
+        node->addChildNode(meshNode);
+    }
+
+    // No node draws the source meshes anymore. The packed copies took over their materials.
+    for (auto &[mesh, packedMesh] : packedMeshes) {
+        mesh->material = nullptr;
+        delete mesh;
+    }
+
+    spdlog::info("Packed {} meshes, vertex data: {:.2f}MB -> {:.2f}MB", packedMeshes.size(), sourceBytes / 1e6, packedBytes / 1e6);
+    return layouts;
+}